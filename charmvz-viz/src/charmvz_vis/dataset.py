@@ -25,9 +25,13 @@ class TraceDataset:
     ----------
     trace_dir : str or Path
         Directory containing the Parquet files produced by the ``charmvz``
-        C++ pipeline. The eight core entity tables are required; the three
+        C++ pipeline. The eight core entity tables are required; those
         listed in ``_OPTIONAL_FILES`` are not, so output written by an older
-        build of the pipeline still loads.
+        build of the pipeline still loads. Tables written with
+        ``--partition-buckets`` are directories of ``pe_bucket=K`` parts
+        rather than single files, and ``--format arrow`` writes ``.arrow``
+        (Arrow IPC) files in place of ``.parquet``; every combination is read
+        the same way.
 
     Examples
     --------
@@ -60,6 +64,11 @@ class TraceDataset:
         "message_type": "message_type.parquet",
         "user_stat": "user_stat.parquet",
         "memory_sample": "memory_sample.parquet",
+        "message_delivery": "message_delivery.parquet",
+        "pe_comm_matrix": "pe_comm_matrix.parquet",
+        "ep_pe_summary": "ep_pe_summary.parquet",
+        "ep_comm_graph": "ep_comm_graph.parquet",
+        "time_profile": "time_profile.parquet",
     }
 
     def __init__(self, trace_dir: str | Path) -> None:
@@ -70,8 +79,7 @@ class TraceDataset:
         # Validate that required files exist
         missing = []
         for name, filename in self._FILES.items():
-            path = self.trace_dir / filename
-            if not path.exists():
+            if self._locate(filename) is None:
                 missing.append(filename)
         if missing:
             raise FileNotFoundError(
@@ -81,29 +89,79 @@ class TraceDataset:
         # Lazy caches (populated on first access)
         self._tables: dict[str, pl.LazyFrame] = {}
         self._pe_info: dict[str, int | tuple[int, int]] | None = None
+        self._time_bin_us: int | None = None
         self._ep_color_map: EPColorMap | None = None
 
+    def _locate(self, filename: str) -> Path | None:
+        """Where a table was written: its Parquet or Arrow IPC file, or the
+        directory of a partitioned dataset (``execution/`` for
+        ``execution.parquet``)."""
+        path = self.trace_dir / filename
+        for candidate in (path, path.with_suffix(".arrow"), path.with_suffix("")):
+            if candidate.exists():
+                return candidate
+        return None
+
+    @staticmethod
+    def _scan_path(path: Path) -> pl.LazyFrame:
+        """Lazy-scan a single file or a ``pe_bucket=K`` partitioned dataset.
+
+        The bucket is only ``pe_id % N``, a layout detail rather than data, so
+        it is dropped and both layouts yield the same columns. A filter on
+        ``pe_id`` still prunes whole parts through each part's statistics.
+
+        Arrow IPC files are memory-mapped: uncompressed, their buffers are used
+        straight from the page cache, so a reload costs no decode at all.
+        """
+        if not path.is_dir():
+            if path.suffix == ".arrow":
+                return pl.scan_ipc(path, memory_map=True)
+            return pl.scan_parquet(path)
+        if any(path.glob("*/*.arrow")):
+            return pl.scan_ipc(
+                path / "**" / "*.arrow", hive_partitioning=True, memory_map=True
+            ).drop("pe_bucket")
+        return pl.scan_parquet(
+            path / "**" / "*.parquet", hive_partitioning=True
+        ).drop("pe_bucket")
+
     def _scan(self, name: str) -> pl.LazyFrame:
-        """Lazy-scan a Parquet file, caching the LazyFrame."""
+        """Lazy-scan a table, caching the LazyFrame."""
         if name not in self._tables:
-            path = self.trace_dir / self._FILES[name]
-            self._tables[name] = pl.scan_parquet(path)
+            path = self._locate(self._FILES[name])
+            self._tables[name] = self._scan_path(path)
         return self._tables[name]
 
     def _scan_optional(self, name: str) -> pl.LazyFrame | None:
         """Lazy-scan an optional table, returning None when it was not written."""
         if name not in self._tables:
-            path = self.trace_dir / self._OPTIONAL_FILES[name]
-            if not path.exists():
+            path = self._locate(self._OPTIONAL_FILES[name])
+            if path is None:
                 return None
-            self._tables[name] = pl.scan_parquet(path)
+            self._tables[name] = self._scan_path(path)
         return self._tables[name]
 
+    def _schema_metadata(self, name: str) -> dict[bytes, bytes]:
+        """The Arrow schema metadata of a table that was written, read from
+        its file or, when it is partitioned, from its first part."""
+        import pyarrow as pa
+        import pyarrow.parquet as pq
+
+        path = self._locate(self._OPTIONAL_FILES.get(name) or self._FILES[name])
+        if path.is_dir():
+            parts = sorted(path.glob("*/*.arrow")) or sorted(path.glob("*/*.parquet"))
+            path = parts[0]
+        if path.suffix == ".arrow":
+            schema = pa.ipc.open_file(path).schema
+        else:
+            schema = pq.read_schema(path)
+        return schema.metadata or {}
+
     def has_table(self, name: str) -> bool:
         """Whether an optional table is present in this trace directory."""
         if name not in self._OPTIONAL_FILES:
             return name in self._FILES
-        return (self.trace_dir / self._OPTIONAL_FILES[name]).exists()
+        return self._locate(self._OPTIONAL_FILES[name]) is not None
 
     # ── Entity table accessors ───────────────────────────────────────────
 
@@ -209,6 +267,69 @@ class TraceDataset:
         """
         return self._scan_optional("memory_sample")
 
+    @property
+    def message_delivery(self) -> pl.LazyFrame | None:
+        """MessageDelivery table, or None when the pipeline did not write one.
+
+        One row per ``(message_id, dst_pe)``: every PE a broadcast or multicast
+        reached, where ``message`` keeps a single ``dst_pe``. A multicast
+        destination that never ran the message has null receive times.
+        """
+        return self._scan_optional("message_delivery")
+
+    @property
+    def pe_comm_matrix(self) -> pl.LazyFrame | None:
+        """PeCommMatrix table, or None when the pipeline did not write one.
+
+        One row per ``(src_pe, dst_pe)``, or per ``(src_pe, dst_pe,
+        bin_start_us)`` when the trace was converted with ``--time-bin-us``:
+        ``message_delivery`` pre-aggregated for PE-to-PE heatmaps.
+        """
+        return self._scan_optional("pe_comm_matrix")
+
+    @property
+    def ep_pe_summary(self) -> pl.LazyFrame | None:
+        """EpPeSummary table, or None when the pipeline did not write one.
+
+        One row per ``(pe_id, ep_id)``: the count, wall and CPU time totals and
+        extremes, queue wait and received bytes of that entry method's
+        executions on that PE. A few thousand rows to read instead of
+        ``execution`` for usage and entry-method profiles.
+        """
+        return self._scan_optional("ep_pe_summary")
+
+    @property
+    def ep_comm_graph(self) -> pl.LazyFrame | None:
+        """EpCommGraph table, or None when the pipeline did not write one.
+
+        One row per ``(sender_ep_id, receiver_ep_id)``: message count, bytes
+        and send-to-execution latency between two entry methods. A null
+        ``sender_ep_id`` collects sends made outside any execution; roll
+        latencies up through ``mean_latency_us * delivery_count``.
+        """
+        return self._scan_optional("ep_comm_graph")
+
+    @property
+    def time_profile(self) -> pl.LazyFrame | None:
+        """TimeProfile table, or None when the trace was converted without
+        ``--time-bin-us``.
+
+        Per PE and bin of ``time_profile_bin_us``: one row per entry method the
+        PE ran there with ``busy_us``, and one with a null ``ep_id`` and
+        ``idle_us``. Spans crossing a bin edge are split at it, so the bins sum
+        into any multiple of their width exactly.
+        """
+        return self._scan_optional("time_profile")
+
+    @property
+    def time_profile_bin_us(self) -> int | None:
+        """Bin width of ``time_profile`` in µs, from its ``time_bin_us`` schema
+        metadata, or None when the table was not written."""
+        if self._time_bin_us is None and self.has_table("time_profile"):
+            metadata = self._schema_metadata("time_profile")
+            self._time_bin_us = int(metadata[b"time_bin_us"])
+        return self._time_bin_us
+
     # ── Convenience metadata ─────────────────────────────────────────────
 
     def _load_pe_info(self) -> None:
@@ -12,7 +12,7 @@ from typing import TYPE_CHECKING, Literal, Sequence
 
 import polars as pl
 
-from .filters import apply_filters
+from .filters import apply_filters, apply_pe_filter
 
 if TYPE_CHECKING:
     from .dataset import TraceDataset
@@ -35,7 +35,7 @@ def compute_entry_spans(
         start_time_us, end_time_us, wall_duration_us,
         cpu_duration_us, queue_wait_us,
         src_pe, msg_len, recv_time_us, instance_id,
-        papi_delta_0..5
+        papi_delta_<i>, one per PAPI counter in the trace
     """
     exec_lf = apply_filters(
         ds.execution,
@@ -197,6 +197,110 @@ def bin_spans(
     return combined.drop(drop_cols)
 
 
+def precomputed_time_bins(
+    ds: TraceDataset,
+    bin_width_us: int,
+    time_range: tuple[int, int],
+    pes: Sequence[int] | None = None,
+) -> pl.LazyFrame | None:
+    """The pipeline's ``time_profile`` summed into bins of ``bin_width_us``, or
+    None when it cannot stand in for :func:`bin_spans`.
+
+    It can when the table was written, ``bin_width_us`` is a multiple of its
+    bin width, and ``time_range`` starts on one of its bin edges and ends on
+    one or at the end of the run, so no bin of the table straddles the range.
+
+    Returns
+    -------
+    LazyFrame with columns:
+        ``bin_start``, ``pe_id``, ``ep_id`` (null for idle time), ``time_us``
+    """
+    table_bin_us = ds.time_profile_bin_us
+    if not table_bin_us or bin_width_us % table_bin_us != 0:
+        return None
+    t_start, t_end = time_range
+    if t_start % table_bin_us != 0:
+        return None
+    if t_end % table_bin_us != 0 and t_end < ds.time_range_us[1]:
+        return None
+
+    return (
+        apply_pe_filter(ds.time_profile, pes)
+        .filter(
+            (pl.col("bin_start_us") >= t_start) & (pl.col("bin_start_us") < t_end)
+        )
+        .with_columns(
+            (
+                (pl.col("bin_start_us") - t_start) // bin_width_us * bin_width_us
+                + t_start
+            ).alias("bin_start"),
+        )
+        .group_by("bin_start", "pe_id", "ep_id")
+        .agg(pl.coalesce("busy_us", "idle_us").sum().alias("time_us"))
+    )
+
+
+def ep_time_by_bin(
+    ds: TraceDataset,
+    bin_width_us: int,
+    pes: Sequence[int] | None = None,
+    time_range: tuple[int, int] | None = None,
+) -> pl.LazyFrame:
+    """Busy time per entry method and time bin, summed over the selected PEs.
+
+    Read from ``time_profile`` when :func:`precomputed_time_bins` can, and
+    binned from ``execution`` otherwise; both give the same totals.
+
+    Returns
+    -------
+    LazyFrame with columns: ``bin_start``, ``ep_id``, ``ep_name``, ``total_us``
+    """
+    tr = time_range or ds.time_range_us
+    precomputed = precomputed_time_bins(ds, bin_width_us, tr, pes=pes)
+    if precomputed is None:
+        binned = bin_spans(compute_entry_spans(ds, pes=pes, time_range=tr), bin_width_us, tr)
+        time_col = "bin_contribution_us"
+    else:
+        names = ds.entry_method.select("ep_id", pl.col("name").alias("ep_name"))
+        binned = precomputed.filter(pl.col("ep_id").is_not_null()).join(
+            names, on="ep_id", how="left"
+        )
+        time_col = "time_us"
+    return binned.group_by("bin_start", "ep_id", "ep_name").agg(
+        pl.col(time_col).sum().alias("total_us")
+    )
+
+
+def idle_time_by_bin(
+    ds: TraceDataset,
+    bin_width_us: int,
+    pes: Sequence[int] | None = None,
+    time_range: tuple[int, int] | None = None,
+) -> pl.LazyFrame:
+    """Idle time per time bin, summed over the selected PEs.
+
+    Returns
+    -------
+    LazyFrame with columns: ``bin_start``, ``idle_us``
+    """
+    tr = time_range or ds.time_range_us
+    precomputed = precomputed_time_bins(ds, bin_width_us, tr, pes=pes)
+    if precomputed is None:
+        binned = bin_spans(
+            compute_idle_spans(ds, pes=pes, time_range=tr),
+            bin_width_us,
+            tr,
+            start_col="start_time_us",
+            end_col="end_time_us",
+            duration_col="duration_us",
+        )
+        time_col = "bin_contribution_us"
+    else:
+        binned = precomputed.filter(pl.col("ep_id").is_null())
+        time_col = "time_us"
+    return binned.group_by("bin_start").agg(pl.col(time_col).sum().alias("idle_us"))
+
+
 def _clipped_entry_spans(
     ds: TraceDataset,
     pes: Sequence[int] | None = None,
@@ -271,7 +375,10 @@ def pe_load_by_bin(
     pes: Sequence[int] | None = None,
     time_range: tuple[int, int] | None = None,
 ) -> pl.LazyFrame:
-    """Busy time per selected PE and time bin, including zero-load rows."""
+    """Busy time per selected PE and time bin, including zero-load rows.
+
+    Read from ``time_profile`` when :func:`precomputed_time_bins` can.
+    """
     if bin_width_us <= 0:
         raise ValueError("bin_width_us must be positive")
 
@@ -287,12 +394,20 @@ def pe_load_by_bin(
         {"bin_start": [t_start + i * bin_width_us for i in range(n_bins)]},
     )
 
-    spans = compute_entry_spans(ds, pes=pes, time_range=tr)
-    loads = (
-        bin_spans(spans, bin_width_us, tr)
-        .group_by("pe_id", "bin_start")
-        .agg(pl.col("bin_contribution_us").sum().alias("load_us"))
-    )
+    precomputed = precomputed_time_bins(ds, bin_width_us, tr, pes=pes)
+    if precomputed is None:
+        spans = compute_entry_spans(ds, pes=pes, time_range=tr)
+        loads = (
+            bin_spans(spans, bin_width_us, tr)
+            .group_by("pe_id", "bin_start")
+            .agg(pl.col("bin_contribution_us").sum().alias("load_us"))
+        )
+    else:
+        loads = (
+            precomputed.filter(pl.col("ep_id").is_not_null())
+            .group_by("pe_id", "bin_start")
+            .agg(pl.col("time_us").sum().alias("load_us"))
+        )
 
     return (
         pe_values.join(bins, how="cross")
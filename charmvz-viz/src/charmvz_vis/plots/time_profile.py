@@ -13,7 +13,7 @@ import numpy as np
 import polars as pl
 
 from ..colors import IDLE_COLOR, OTHER_COLOR
-from ..derived import bin_spans, compute_entry_spans, compute_idle_spans
+from ..derived import ep_time_by_bin, idle_time_by_bin
 
 if TYPE_CHECKING:
     from matplotlib.figure import Figure
@@ -34,6 +34,9 @@ def time_profile(
 ) -> Figure:
     """Create a Time Profile stacked area chart.
 
+    Sums the pipeline's ``time_profile`` table when the trace has one at a bin
+    width that divides ``bin_width_us``, and bins the executions otherwise.
+
     Parameters
     ----------
     ds : TraceDataset
@@ -53,14 +56,7 @@ def time_profile(
     n_pes = ds.num_pes if pes is None else len(list(pes))
 
     # ── Compute per-(bin, ep_id) busy time ───────────────────────────────
-    spans = compute_entry_spans(ds, pes=pes, time_range=tr)
-    binned = bin_spans(spans, bin_width_us, tr)
-
-    ep_bin_agg = (
-        binned.group_by("bin_start", "ep_id", "ep_name")
-        .agg(pl.col("bin_contribution_us").sum().alias("total_us"))
-        .collect()
-    )
+    ep_bin_agg = ep_time_by_bin(ds, bin_width_us, pes=pes, time_range=tr).collect()
 
     # ── Identify top-N EPs by total time ─────────────────────────────────
     ep_totals = (
@@ -97,18 +93,7 @@ def time_profile(
     # ── Idle time per bin ────────────────────────────────────────────────
     idle_row = np.zeros(len(bin_starts))
     if show_idle:
-        idles = compute_idle_spans(ds, pes=pes, time_range=tr)
-        idle_binned = bin_spans(
-            idles, bin_width_us, tr,
-            start_col="start_time_us",
-            end_col="end_time_us",
-            duration_col="duration_us",
-        )
-        idle_agg = (
-            idle_binned.group_by("bin_start")
-            .agg(pl.col("bin_contribution_us").sum().alias("idle_us"))
-            .collect()
-        )
+        idle_agg = idle_time_by_bin(ds, bin_width_us, pes=pes, time_range=tr).collect()
         for row in idle_agg.iter_rows(named=True):
             bin_idx = (row["bin_start"] - t_start) // bin_width_us
             if 0 <= bin_idx < len(bin_starts):
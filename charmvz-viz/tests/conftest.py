@@ -712,3 +712,62 @@ def instrumented_ds(instrumented_trace: Path):
     from charmvz_vis import TraceDataset
 
     return TraceDataset(instrumented_trace)
+
+
+# ── Precomputed time profile ─────────────────────────────────────────────────
+#
+# What ``--time-bin-us`` writes, rebuilt here by splitting each span at bin
+# edges the way the C++ binner does, so the viz's read of it can be checked
+# against binning the spans itself.
+
+PROFILE_BIN_US = 100_000
+
+
+def _profile_bins(totals: dict, key, start: int, end: int) -> None:
+    """Add the part of ``[start, end)`` in each bin to ``totals[(bin, key)]``."""
+    first = start // PROFILE_BIN_US
+    for b in range(first, -(-end // PROFILE_BIN_US)):
+        part = min(end, (b + 1) * PROFILE_BIN_US) - max(start, b * PROFILE_BIN_US)
+        totals[(b, key)] = totals.get((b, key), 0) + part
+
+
+@pytest.fixture
+def profiled_trace(tiny_trace: Path) -> Path:
+    """The tiny trace plus the time_profile table, in bins of PROFILE_BIN_US."""
+    execs = pq.read_table(tiny_trace / "execution.parquet").to_pylist()
+    idles = pq.read_table(tiny_trace / "idle_interval.parquet").to_pylist()
+
+    totals: dict = {}
+    for row in execs:
+        _profile_bins(
+            totals, (row["pe_id"], row["ep_id"]),
+            row["start_time_us"], row["end_time_us"],
+        )
+    for row in idles:
+        _profile_bins(
+            totals, (row["pe_id"], None), row["start_time_us"], row["end_time_us"]
+        )
+
+    rows = sorted(totals.items(), key=lambda kv: (kv[0][0], kv[0][1][0]))
+    schema = pa.schema(
+        [
+            ("bin_start_us", pa.int64()),
+            ("pe_id", pa.int32()),
+            ("ep_id", pa.int32()),
+            ("busy_us", pa.int64()),
+            ("idle_us", pa.int64()),
+        ],
+        metadata={"time_bin_us": str(PROFILE_BIN_US)},
+    )
+    _write_pq(
+        tiny_trace / "time_profile.parquet",
+        schema,
+        {
+            "bin_start_us": [b * PROFILE_BIN_US for (b, _), _ in rows],
+            "pe_id": [pe for (_, (pe, _)), _ in rows],
+            "ep_id": [ep for (_, (_, ep)), _ in rows],
+            "busy_us": [us if ep is not None else None for (_, (_, ep)), us in rows],
+            "idle_us": [us if ep is None else None for (_, (_, ep)), us in rows],
+        },
+    )
+    return tiny_trace
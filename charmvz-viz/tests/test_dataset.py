@@ -61,3 +61,86 @@ class TestTraceDataset:
         assert cm[0].startswith("#")
         assert cm[1].startswith("#")
         assert cm[2].startswith("#")
+
+
+def _partition(trace_dir, table: str, buckets: int) -> None:
+    """Rewrite one table in the ``--partition-buckets`` layout."""
+    import pyarrow.compute as pc
+    import pyarrow.parquet as pq
+
+    path = trace_dir / f"{table}.parquet"
+    data = pq.read_table(path)
+    path.unlink()
+    for bucket in range(buckets):
+        part_dir = trace_dir / table / f"pe_bucket={bucket}"
+        part_dir.mkdir(parents=True)
+        mask = pc.equal(pc.remainder(data["pe_id"], buckets), bucket)
+        pq.write_table(data.filter(mask), part_dir / "part-0.parquet")
+
+
+class TestPartitionedLayout:
+    """Tables written with ``--partition-buckets`` read like single files."""
+
+    def test_reads_partitioned_execution(self, tiny_trace) -> None:
+        expected = TraceDataset(tiny_trace).execution.collect()
+        _partition(tiny_trace, "execution", 3)
+
+        ds = TraceDataset(tiny_trace)
+        df = ds.execution.collect()
+        assert "pe_bucket" not in df.columns
+        assert df.columns == expected.columns
+        assert df.sort("pe_id", "start_time_us").equals(
+            expected.sort("pe_id", "start_time_us")
+        )
+
+    def test_reads_partitioned_idle_interval(self, tiny_trace) -> None:
+        _partition(tiny_trace, "idle_interval", 2)
+        ds = TraceDataset(tiny_trace)
+        assert len(ds.idle_interval.collect()) == 8
+
+
+class TestArrowIpcLayout:
+    """Tables written with ``--format arrow`` read like Parquet ones."""
+
+    def test_reads_arrow_ipc_execution(self, tiny_trace) -> None:
+        import pyarrow.feather as feather
+        import pyarrow.parquet as pq
+
+        expected = TraceDataset(tiny_trace).execution.collect()
+        path = tiny_trace / "execution.parquet"
+        feather.write_feather(
+            pq.read_table(path), tiny_trace / "execution.arrow",
+            compression="uncompressed",
+        )
+        path.unlink()
+
+        df = TraceDataset(tiny_trace).execution.collect()
+        assert df.equals(expected)
+
+
+class TestSummaryTables:
+    """The pre-aggregated tables load when written and are None otherwise."""
+
+    def test_absent_summaries_are_none(self, ds: TraceDataset) -> None:
+        assert ds.ep_pe_summary is None
+        assert ds.ep_comm_graph is None
+        assert not ds.has_table("ep_comm_graph")
+
+    def test_reads_ep_comm_graph(self, tiny_trace) -> None:
+        import pyarrow as pa
+        import pyarrow.parquet as pq
+
+        pq.write_table(
+            pa.table({
+                "sender_ep_id": pa.array([None, 1], pa.int32()),
+                "receiver_ep_id": pa.array([0, 2], pa.int32()),
+                "message_count": pa.array([1, 4], pa.int64()),
+            }),
+            tiny_trace / "ep_comm_graph.parquet",
+        )
+
+        ds = TraceDataset(tiny_trace)
+        assert ds.has_table("ep_comm_graph")
+        df = ds.ep_comm_graph.collect()
+        assert df["message_count"].sum() == 5
+        assert df["sender_ep_id"].null_count() == 1
@@ -10,7 +10,11 @@ from charmvz_vis.derived import (
     chare_duration_totals,
     chare_frequency_counts,
     cumulative_percent_imbalance_by_time,
+    ep_time_by_bin,
+    idle_time_by_bin,
+    pe_load_by_bin,
     percent_imbalance_by_bin,
+    precomputed_time_bins,
 )
 
 
@@ -138,3 +142,50 @@ class TestLoadImbalance:
         score = load_imbalance_score(ds)
         assert isinstance(score, float)
         assert score >= 0.0
+
+
+class TestPrecomputedTimeProfile:
+    """Summing time_profile gives what binning the spans does."""
+
+    RANGES = [None, (0, 2_000_000)]
+
+    @staticmethod
+    def _binned(ds: TraceDataset, time_range) -> tuple:
+        return (
+            pe_load_by_bin(ds, 500_000, time_range=time_range)
+            .collect()
+            .sort("pe_id", "bin_start"),
+            ep_time_by_bin(ds, 500_000, pes=[0, 2], time_range=time_range)
+            .collect()
+            .sort("bin_start", "ep_id"),
+            idle_time_by_bin(ds, 500_000, time_range=time_range)
+            .collect()
+            .sort("bin_start"),
+        )
+
+    def test_bin_width_from_metadata(self, profiled_trace) -> None:
+        ds = TraceDataset(profiled_trace)
+        assert ds.time_profile_bin_us == 100_000
+        assert ds.time_profile.collect().height > 0
+
+    def test_absent_without_time_bins(self, ds: TraceDataset) -> None:
+        assert ds.time_profile is None
+        assert ds.time_profile_bin_us is None
+        assert precomputed_time_bins(ds, 500_000, ds.time_range_us) is None
+
+    def test_falls_back_when_bins_do_not_line_up(self, profiled_trace) -> None:
+        ds = TraceDataset(profiled_trace)
+        assert precomputed_time_bins(ds, 500_000, ds.time_range_us) is not None
+        assert precomputed_time_bins(ds, 250_000, ds.time_range_us) is None
+        assert precomputed_time_bins(ds, 500_000, (50_000, 2_000_000)) is None
+        assert precomputed_time_bins(ds, 500_000, (0, 2_050_000)) is None
+
+    @pytest.mark.parametrize("time_range", RANGES)
+    def test_matches_binned_spans(self, profiled_trace, time_range) -> None:
+        precomputed = self._binned(TraceDataset(profiled_trace), time_range)
+        (profiled_trace / "time_profile.parquet").unlink()
+        from_spans = self._binned(TraceDataset(profiled_trace), time_range)
+
+        for fast, slow in zip(precomputed, from_spans):
+            assert fast.height > 0
+            assert fast.equals(slow.select(fast.columns))
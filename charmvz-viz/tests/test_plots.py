@@ -28,6 +28,13 @@ class TestTimePlotSmoke:
         assert isinstance(fig, plt.Figure)
         plt.close(fig)
 
+    def test_reads_precomputed_bins(self, profiled_trace) -> None:
+        from charmvz_vis.plots.time_profile import time_profile
+
+        fig = time_profile(TraceDataset(profiled_trace), bin_width_us=500_000)
+        assert isinstance(fig, plt.Figure)
+        plt.close(fig)
+
 
 class TestUsageProfileSmoke:
     """Smoke tests for usage_profile."""
@@ -1,177 +1,471 @@
 #pragma once
 #include "log_parser.h"
-#include "parquet_writer.h"
+#include "table_builder.h"
 #include "utils/log_entry.h"
-#include <arrow/api.h>
-#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// The Stage 2 tables, as TableBuilder row descriptors. Each descriptor lists
+// its columns in the order of the matching schema:: function.
 
 namespace charmvz::builders {
 
-const int ROW_GROUP_SIZE = 100000;
+// One matched BEGIN_PROCESSING/END_PROCESSING pair. The builder's group width
+// is the number of PAPI counters the .sts names; a counter the records did not
+// carry is null.
+struct ExecutionRecord {
+  const LogEntry &begin;
+  const LogEntry &end;
+  int32_t pe_id;
+  int64_t global_start_us;
+  int64_t instance_id;
+  // The step whose interval on the PE contains the start, if any.
+  std::optional<int32_t> step_id;
+};
+
+// One PAPI counter of one execution, for the long-format papi_sample table.
+// The counter column's dictionary is the .sts counter names by counter id, so
+// `named` is all a row needs to say about it.
+struct PapiSampleRecord {
+  int32_t pe_id;
+  int32_t event;
+  int32_t counter_id;
+  bool named;
+  uint64_t begin_value;
+  uint64_t end_value;
+};
 
-class ExecutionBuilder {
+// One BEGIN_IDLE/END_IDLE pair; the PE is the one the begin record names.
+struct IdleIntervalRecord {
+  const LogEntry &begin;
+  const LogEntry &end;
+  int64_t global_start_us;
+  std::optional<int32_t> step_id;
+};
+
+// The values of a dictionary-encoded name column and the code of each id.
+// Built once from an .sts table, so a row carries a four-byte code in place of
+// its own copy of the name, and every row group shares the one dictionary.
+class NameDictionary {
 public:
-  ExecutionBuilder(ParquetWriter &writer, std::shared_ptr<arrow::Schema> schema,
-                   int32_t total_papi_events);
-  void Append(const LogEntry &begin, const LogEntry &end, int32_t pe_id,
-              int64_t global_start_us, int64_t instance_id);
-  void Flush();
-  void TryFlush() {
-    if (pe_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+  // From an .sts id -> record map, coded in id order so the dictionary does
+  // not depend on the map's iteration order.
+  template <class Record>
+  explicit NameDictionary(const std::unordered_map<int32_t, Record> &records) {
+    std::vector<int32_t> ids;
+    ids.reserve(records.size());
+    for (const auto &entry : records)
+      ids.push_back(entry.first);
+    std::sort(ids.begin(), ids.end());
+    std::vector<std::string> names;
+    names.reserve(ids.size());
+    for (const int32_t id : ids) {
+      codes_.emplace(id, static_cast<int32_t>(names.size()));
+      names.push_back(records.at(id).name);
+    }
+    Build(names);
   }
 
-private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
-  int32_t total_papi_events_;
-
-  arrow::Int32Builder pe_id;
-  arrow::Int32Builder event;
-  arrow::Int64Builder instance_id;
-  arrow::Int32Builder ep_id;
-  arrow::Int32Builder src_pe;
-  arrow::Int32Builder msg_idx;
-  arrow::Int32Builder msg_len;
-  arrow::Int64Builder start_time_us;
-  arrow::Int64Builder recv_time_us;
-  arrow::Int64Builder start_cpu_us;
-  arrow::Int64Builder end_time_us;
-  arrow::Int64Builder end_cpu_us;
-  arrow::Int64Builder papi_begin_0;
-  arrow::Int64Builder papi_begin_1;
-  arrow::Int64Builder papi_begin_2;
-  arrow::Int64Builder papi_begin_3;
-  arrow::Int64Builder papi_begin_4;
-  arrow::Int64Builder papi_begin_5;
-  arrow::Int64Builder papi_end_0;
-  arrow::Int64Builder papi_end_1;
-  arrow::Int64Builder papi_end_2;
-  arrow::Int64Builder papi_end_3;
-  arrow::Int64Builder papi_end_4;
-  arrow::Int64Builder papi_end_5;
-  arrow::Int64Builder wall_duration_us;
-  arrow::Int64Builder cpu_duration_us;
-  arrow::Int64Builder queue_wait_us;
-  arrow::Int64Builder papi_delta_0;
-  arrow::Int64Builder papi_delta_1;
-  arrow::Int64Builder papi_delta_2;
-  arrow::Int64Builder papi_delta_3;
-  arrow::Int64Builder papi_delta_4;
-  arrow::Int64Builder papi_delta_5;
-};
-
-class IdleIntervalBuilder {
-public:
-  IdleIntervalBuilder(ParquetWriter &writer);
-  void Append(const LogEntry &begin, const LogEntry &end,
-              int64_t global_start_us);
-  void Flush();
-  void TryFlush() {
-    if (pe_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+  // From names indexed by id, as the .sts gives PAPI counters; an empty name
+  // is an unnamed id and gets no code.
+  explicit NameDictionary(const std::vector<std::string> &names) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (!names[i].empty())
+        codes_.emplace(static_cast<int32_t>(i), static_cast<int32_t>(i));
+    }
+    Build(names);
+  }
+
+  [[nodiscard]] auto code(int32_t id) const -> std::optional<DictionaryCode> {
+    auto it = codes_.find(id);
+    if (it == codes_.end())
+      return std::nullopt;
+    return DictionaryCode{it->second};
+  }
+
+  [[nodiscard]] auto values() const -> const std::shared_ptr<arrow::Array> & {
+    return values_;
   }
 
 private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
+  void Build(const std::vector<std::string> &names) {
+    arrow::StringBuilder builder;
+    PARQUET_THROW_NOT_OK(builder.AppendValues(names));
+    PARQUET_THROW_NOT_OK(builder.Finish(&values_));
+  }
 
-  arrow::Int32Builder pe_id;
-  arrow::Int64Builder start_time_us;
-  arrow::Int64Builder end_time_us;
-  arrow::Int64Builder duration_us;
+  std::unordered_map<int32_t, int32_t> codes_;
+  std::shared_ptr<arrow::Array> values_;
 };
 
-class ChareInstanceBuilder {
-public:
-  ChareInstanceBuilder(ParquetWriter &writer);
-  void Append(const ChareInstanceRecord &instance);
-  void Flush();
-  void TryFlush() {
-    if (instance_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+namespace detail {
+
+inline auto papi_value(const LogEntry &entry, size_t i)
+    -> std::optional<int64_t> {
+  if (i >= entry.papiValues.size())
+    return std::nullopt;
+  return static_cast<int64_t>(entry.papiValues[i]);
+}
+
+inline auto has_recv_time(const LogEntry &begin) -> bool {
+  return begin.irecvtime != std::numeric_limits<uint64_t>::max();
+}
+
+template <class T>
+auto present(bool has, const T &value) -> std::optional<T> {
+  return has ? std::optional<T>(value) : std::nullopt;
+}
+
+} // namespace detail
+
+template <> struct RowDescriptor<ExecutionRecord> {
+  using R = ExecutionRecord;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, [](const R &r) -> int32_t { return r.begin.event; },
+      [](const R &r) -> std::optional<int64_t> {
+        return detail::present(r.instance_id >= 0, r.instance_id);
+      },
+      [](const R &r) -> int32_t { return r.begin.eIdx; },
+      [](const R &r) -> int32_t { return r.begin.pe; },
+      [](const R &r) -> int32_t { return r.begin.mIdx; },
+      [](const R &r) -> int32_t { return r.begin.msglen; },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.begin.itime) - r.global_start_us;
+      },
+      [](const R &r) -> std::optional<int64_t> {
+        return detail::present(detail::has_recv_time(r.begin),
+                               static_cast<int64_t>(r.begin.irecvtime) -
+                                   r.global_start_us);
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.begin.icputime);
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.itime) - r.global_start_us;
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.icputime);
+      },
+      column_group([](const R &r, size_t i) {
+        return detail::papi_value(r.begin, i);
+      }),
+      column_group(
+          [](const R &r, size_t i) { return detail::papi_value(r.end, i); }),
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.itime) -
+               static_cast<int64_t>(r.begin.itime);
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.icputime) -
+               static_cast<int64_t>(r.begin.icputime);
+      },
+      [](const R &r) -> std::optional<int64_t> {
+        return detail::present(detail::has_recv_time(r.begin),
+                               static_cast<int64_t>(r.begin.itime) -
+                                   static_cast<int64_t>(r.begin.irecvtime));
+      },
+      column_group([](const R &r, size_t i) -> std::optional<int64_t> {
+        const auto begin = detail::papi_value(r.begin, i);
+        const auto end = detail::papi_value(r.end, i);
+        if (!begin || !end)
+          return std::nullopt;
+        return *end - *begin;
+      }),
+      &R::step_id,
+      [](const R &r) -> std::optional<int64_t> {
+        return detail::present(r.begin.pe >= 0,
+                               make_message_id(r.begin.pe, r.begin.event));
+      });
+};
+
+template <> struct RowDescriptor<PapiSampleRecord> {
+  using R = PapiSampleRecord;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::event, &R::counter_id,
+      [](const R &r) {
+        return detail::present(r.named, DictionaryCode{r.counter_id});
+      },
+      [](const R &r) -> int64_t { return static_cast<int64_t>(r.begin_value); },
+      [](const R &r) -> int64_t { return static_cast<int64_t>(r.end_value); },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end_value) -
+               static_cast<int64_t>(r.begin_value);
+      });
+};
+
+template <> struct RowDescriptor<IdleIntervalRecord> {
+  using R = IdleIntervalRecord;
+  static constexpr auto columns = std::make_tuple(
+      [](const R &r) -> int32_t { return r.begin.pe; },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.begin.itime) - r.global_start_us;
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.itime) - r.global_start_us;
+      },
+      [](const R &r) -> int64_t {
+        return static_cast<int64_t>(r.end.itime) -
+               static_cast<int64_t>(r.begin.itime);
+      },
+      &R::step_id);
+};
+
+template <> struct RowDescriptor<ChareInstanceRecord> {
+  using R = ChareInstanceRecord;
+  static constexpr auto columns =
+      std::make_tuple(&R::instance_id, &R::collection_id, &R::index_0,
+                      &R::index_1, &R::index_2, &R::index_3, &R::index_4,
+                      &R::index_5);
+};
+
+template <> struct RowDescriptor<UserEventOccurrence> {
+  using R = UserEventOccurrence;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::record_type,
+      [](const R &r) {
+        return detail::present(r.has_user_event_id, r.user_event_id);
+      },
+      [](const R &r) {
+        return detail::present(r.has_name, DictionaryCode{r.name_code});
+      },
+      [](const R &r) { return detail::present(r.has_event, r.event); },
+      [](const R &r) { return detail::present(r.has_nested_id, r.nested_id); },
+      &R::start_time_us,
+      [](const R &r) { return detail::present(r.has_end_time, r.end_time_us); },
+      [](const R &r) {
+        return detail::present(r.has_end_time,
+                               r.end_time_us - r.start_time_us);
+      },
+      [](const R &r) {
+        return detail::present(r.has_user_supplied_int, r.user_supplied_int);
+      },
+      [](const R &r) { return detail::present(r.has_note, r.note); });
+};
+
+template <> struct RowDescriptor<UserStatSample> {
+  using R = UserStatSample;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::stat_id,
+      [](const R &r) {
+        return detail::present(r.has_name, DictionaryCode{r.name_code});
+      },
+      &R::time_us, &R::stat_value,
+      [](const R &r) {
+        return detail::present(r.has_user_time, r.user_time_s);
+      });
+};
+
+template <> struct RowDescriptor<MemorySample> {
+  using R = MemorySample;
+  static constexpr auto columns =
+      std::make_tuple(&R::pe_id, &R::time_us, &R::bytes);
+};
+
+// One (pe_id, ep_id)'s executions, totalled as they stream past. A PAPI sum
+// stays null until an execution carries both ends of that counter.
+struct EpPeTotals {
+  int64_t count = 0;
+  int64_t total_wall_us = 0;
+  int64_t min_wall_us = std::numeric_limits<int64_t>::max();
+  int64_t max_wall_us = std::numeric_limits<int64_t>::min();
+  int64_t total_cpu_us = 0;
+  int64_t min_cpu_us = std::numeric_limits<int64_t>::max();
+  int64_t max_cpu_us = std::numeric_limits<int64_t>::min();
+  int64_t total_queue_wait_us = 0;
+  int64_t queue_wait_count = 0;
+  int64_t total_msg_bytes = 0;
+  std::vector<std::optional<int64_t>> papi_delta_sums;
+
+  void Add(const ExecutionRecord &r) {
+    const int64_t wall = static_cast<int64_t>(r.end.itime) -
+                         static_cast<int64_t>(r.begin.itime);
+    const int64_t cpu = static_cast<int64_t>(r.end.icputime) -
+                        static_cast<int64_t>(r.begin.icputime);
+    ++count;
+    total_wall_us += wall;
+    min_wall_us = std::min(min_wall_us, wall);
+    max_wall_us = std::max(max_wall_us, wall);
+    total_cpu_us += cpu;
+    min_cpu_us = std::min(min_cpu_us, cpu);
+    max_cpu_us = std::max(max_cpu_us, cpu);
+    if (detail::has_recv_time(r.begin)) {
+      total_queue_wait_us += static_cast<int64_t>(r.begin.itime) -
+                             static_cast<int64_t>(r.begin.irecvtime);
+      ++queue_wait_count;
+    }
+    total_msg_bytes += r.begin.msglen;
+    const size_t counters =
+        std::min(r.begin.papiValues.size(), r.end.papiValues.size());
+    if (papi_delta_sums.size() < counters)
+      papi_delta_sums.resize(counters);
+    for (size_t i = 0; i < counters; ++i) {
+      const auto delta = *detail::papi_value(r.end, i) -
+                         *detail::papi_value(r.begin, i);
+      papi_delta_sums[i] = papi_delta_sums[i].value_or(0) + delta;
+    }
   }
 
-private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
+  void Merge(const EpPeTotals &other) {
+    count += other.count;
+    total_wall_us += other.total_wall_us;
+    min_wall_us = std::min(min_wall_us, other.min_wall_us);
+    max_wall_us = std::max(max_wall_us, other.max_wall_us);
+    total_cpu_us += other.total_cpu_us;
+    min_cpu_us = std::min(min_cpu_us, other.min_cpu_us);
+    max_cpu_us = std::max(max_cpu_us, other.max_cpu_us);
+    total_queue_wait_us += other.total_queue_wait_us;
+    queue_wait_count += other.queue_wait_count;
+    total_msg_bytes += other.total_msg_bytes;
+    if (papi_delta_sums.size() < other.papi_delta_sums.size())
+      papi_delta_sums.resize(other.papi_delta_sums.size());
+    for (size_t i = 0; i < other.papi_delta_sums.size(); ++i) {
+      if (other.papi_delta_sums[i]) {
+        papi_delta_sums[i] =
+            papi_delta_sums[i].value_or(0) + *other.papi_delta_sums[i];
+      }
+    }
+  }
+};
 
-  arrow::Int64Builder instance_id;
-  arrow::Int32Builder collection_id;
-  arrow::Int32Builder index_0;
-  arrow::Int32Builder index_1;
-  arrow::Int32Builder index_2;
-  arrow::Int32Builder index_3;
-  arrow::Int32Builder index_4;
-  arrow::Int32Builder index_5;
+// One ep_pe_summary row. The builder's group width is the number of PAPI
+// counters the .sts names.
+struct EpPeSummaryRow {
+  int32_t pe_id;
+  int32_t ep_id;
+  const EpPeTotals &totals;
 };
 
-class UserEventBuilder {
+template <> struct RowDescriptor<EpPeSummaryRow> {
+  using R = EpPeSummaryRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::ep_id, [](const R &r) { return r.totals.count; },
+      [](const R &r) { return r.totals.total_wall_us; },
+      [](const R &r) { return r.totals.min_wall_us; },
+      [](const R &r) { return r.totals.max_wall_us; },
+      [](const R &r) { return r.totals.total_cpu_us; },
+      [](const R &r) { return r.totals.min_cpu_us; },
+      [](const R &r) { return r.totals.max_cpu_us; },
+      [](const R &r) { return r.totals.total_queue_wait_us; },
+      [](const R &r) { return r.totals.queue_wait_count; },
+      [](const R &r) { return r.totals.total_msg_bytes; },
+      column_group([](const R &r, size_t i) -> std::optional<int64_t> {
+        const auto &sums = r.totals.papi_delta_sums;
+        return i < sums.size() ? sums[i] : std::nullopt;
+      }));
+};
+
+// The per-(pe_id, ep_id) totals of one shard's executions, kept so the
+// profile views need not scan execution. Every PE's executions are parsed by
+// one shard, so shards merge without overlapping.
+class EpPeSummary {
 public:
-  UserEventBuilder(ParquetWriter &writer);
-  void Append(const UserEventOccurrence &occurrence);
-  void Flush();
-  void TryFlush() {
-    if (pe_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+  void Add(const ExecutionRecord &r) {
+    totals_[std::make_tuple(r.pe_id, static_cast<int32_t>(r.begin.eIdx))].Add(
+        r);
   }
 
-private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
-
-  arrow::Int32Builder pe_id;
-  arrow::Int32Builder record_type;
-  arrow::Int32Builder user_event_id;
-  arrow::StringBuilder name;
-  arrow::Int32Builder event;
-  arrow::Int32Builder nested_id;
-  arrow::Int64Builder start_time_us;
-  arrow::Int64Builder end_time_us;
-  arrow::Int64Builder duration_us;
-  arrow::Int32Builder user_supplied_int;
-  arrow::StringBuilder note;
-};
-
-class UserStatBuilder {
-public:
-  UserStatBuilder(ParquetWriter &writer);
-  void Append(const UserStatSample &sample);
-  void Flush();
-  void TryFlush() {
-    if (pe_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+  void Merge(const EpPeSummary &other) {
+    for (const auto &[key, totals] : other.totals_)
+      totals_[key].Merge(totals);
+  }
+
+  // Appends one row per (pe_id, ep_id), in that order.
+  void AppendTo(TableBuilder<EpPeSummaryRow> &builder) const {
+    std::vector<const Totals::value_type *> order;
+    order.reserve(totals_.size());
+    for (const auto &entry : totals_)
+      order.push_back(&entry);
+    std::sort(order.begin(), order.end(),
+              [](const auto *a, const auto *b) { return a->first < b->first; });
+    for (const auto *entry : order) {
+      builder.Append({std::get<0>(entry->first), std::get<1>(entry->first),
+                      entry->second});
+    }
   }
 
+  [[nodiscard]] auto size() const -> size_t { return totals_.size(); }
+
 private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
+  using Totals = std::unordered_map<std::tuple<int32_t, int32_t>, EpPeTotals,
+                                    TupleHash>;
+  Totals totals_;
+};
+
+// One time_profile row: a PE's time in one bin, busy in `ep_id` or, when
+// `ep_id` is kIdle, idle.
+struct TimeProfileRow {
+  static constexpr int32_t kIdle = -1;
+  int64_t bin_start_us;
+  int32_t pe_id;
+  int32_t ep_id;
+  int64_t us;
+};
 
-  arrow::Int32Builder pe_id;
-  arrow::Int32Builder stat_id;
-  arrow::StringBuilder name;
-  arrow::Int64Builder time_us;
-  arrow::DoubleBuilder stat_value;
-  arrow::DoubleBuilder user_time_s;
+template <> struct RowDescriptor<TimeProfileRow> {
+  using R = TimeProfileRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::bin_start_us, &R::pe_id,
+      [](const R &r) { return detail::present(r.ep_id != R::kIdle, r.ep_id); },
+      [](const R &r) { return detail::present(r.ep_id != R::kIdle, r.us); },
+      [](const R &r) { return detail::present(r.ep_id == R::kIdle, r.us); });
 };
 
-class MemorySampleBuilder {
+// One PE's busy time per entry method and idle time, per bin of `bin_us`.
+// A span is split at every bin edge it crosses, so each bin gets exactly the
+// part of it that falls inside.
+class TimeBinner {
 public:
-  MemorySampleBuilder(ParquetWriter &writer);
-  void Append(const MemorySample &sample);
-  void Flush();
-  void TryFlush() {
-    if (pe_id.length() >= ROW_GROUP_SIZE)
-      Flush();
+  explicit TimeBinner(int64_t bin_us) : bin_us_(bin_us) {}
+
+  void AddBusy(int32_t ep_id, int64_t start_us, int64_t end_us) {
+    Add(ep_id, start_us, end_us);
+  }
+  void AddIdle(int64_t start_us, int64_t end_us) {
+    Add(TimeProfileRow::kIdle, start_us, end_us);
+  }
+
+  // Appends the PE's bins in time order, its idle row ahead of its entry
+  // methods' within each, and starts over for the next PE.
+  void Drain(int32_t pe_id, TableBuilder<TimeProfileRow> &builder) {
+    for (const auto &[key, us] : totals_)
+      builder.Append({key.first * bin_us_, pe_id, key.second, us});
+    totals_.clear();
   }
 
 private:
-  ParquetWriter &writer_;
-  std::shared_ptr<arrow::Schema> schema_;
+  void Add(int32_t ep_id, int64_t start_us, int64_t end_us) {
+    // Floor division, so a span before the global start still lands in the
+    // bin that holds it.
+    int64_t bin = start_us / bin_us_;
+    if (start_us % bin_us_ < 0)
+      --bin;
+    for (; bin * bin_us_ < end_us; ++bin) {
+      const int64_t from = std::max(start_us, bin * bin_us_);
+      const int64_t to = std::min(end_us, (bin + 1) * bin_us_);
+      totals_[{bin, ep_id}] += to - from;
+    }
+  }
 
-  arrow::Int32Builder pe_id;
-  arrow::Int64Builder time_us;
-  arrow::Int64Builder bytes;
+  int64_t bin_us_;
+  // Keyed on (bin, ep_id); kIdle sorts first.
+  std::map<std::pair<int64_t, int32_t>, int64_t> totals_;
 };
 
+using ExecutionBuilder = TableBuilder<ExecutionRecord>;
+using PapiSampleBuilder = TableBuilder<PapiSampleRecord>;
+using IdleIntervalBuilder = TableBuilder<IdleIntervalRecord>;
+using ChareInstanceBuilder = TableBuilder<ChareInstanceRecord>;
+using UserEventBuilder = TableBuilder<UserEventOccurrence>;
+using UserStatBuilder = TableBuilder<UserStatSample>;
+using MemorySampleBuilder = TableBuilder<MemorySample>;
+using EpPeSummaryBuilder = TableBuilder<EpPeSummaryRow>;
+using TimeProfileBuilder = TableBuilder<TimeProfileRow>;
+
 } // namespace charmvz::builders
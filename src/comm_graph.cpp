@@ -0,0 +1,109 @@
+#include "comm_graph.h"
+#include <algorithm>
+#include <vector>
+
+namespace charmvz {
+
+void EpCommGraph::AppendTo(
+    const StsData &sts_data,
+    builders::TableBuilder<EpCommGraphRow> &builder) const {
+  auto collection_of = [&](int32_t ep_id) -> std::optional<int32_t> {
+    const auto it = sts_data.ep_map.find(ep_id);
+    if (it == sts_data.ep_map.end())
+      return std::nullopt;
+    return it->second.collection_id;
+  };
+  std::vector<const Totals::value_type *> order;
+  order.reserve(totals_.size());
+  for (const auto &entry : totals_)
+    order.push_back(&entry);
+  std::sort(order.begin(), order.end(),
+            [](const auto *a, const auto *b) { return a->first < b->first; });
+  for (const auto *entry : order) {
+    const auto [sender, receiver] = entry->first;
+    std::optional<int32_t> sender_ep;
+    std::optional<int32_t> sender_collection;
+    if (sender != kNoSender) {
+      sender_ep = sender;
+      sender_collection = collection_of(sender);
+    }
+    builder.Append({sender_ep, receiver, sender_collection,
+                    collection_of(receiver), entry->second});
+  }
+}
+
+auto PeCommMatrix::DensePes(int32_t total_pes, int32_t threads,
+                            int64_t bin_us) -> int32_t {
+  if (bin_us > 0 || total_pes <= 0)
+    return 0;
+  const int64_t cells = int64_t{total_pes} * total_pes;
+  if (cells * static_cast<int64_t>(sizeof(Cell)) * std::max(threads, 1) >
+      kDenseBytes)
+    return 0;
+  return total_pes;
+}
+
+PeCommMatrix::PeCommMatrix(int32_t dense_pes, int64_t bin_us)
+    : dense_pes_(dense_pes), bin_us_(bin_us),
+      dense_(static_cast<size_t>(int64_t{dense_pes} * dense_pes)) {}
+
+void PeCommMatrix::Add(int32_t src_pe, int32_t dst_pe, int64_t send_time_us,
+                       int32_t bytes, std::optional<int64_t> latency_us) {
+  Cell *cell = nullptr;
+  if (src_pe >= 0 && src_pe < dense_pes_ && dst_pe >= 0 &&
+      dst_pe < dense_pes_) {
+    cell = &dense_[static_cast<size_t>(int64_t{src_pe} * dense_pes_ + dst_pe)];
+  } else {
+    int64_t bin = 0;
+    if (bin_us_ > 0) {
+      // Floor division, as time_profile bins, for sends before the start.
+      bin = send_time_us / bin_us_;
+      if (send_time_us % bin_us_ < 0)
+        --bin;
+    }
+    cell = &sparse_[std::make_tuple(src_pe, dst_pe, bin)];
+  }
+  ++cell->count;
+  cell->bytes += bytes;
+  if (latency_us) {
+    cell->latency_us += *latency_us;
+    ++cell->latency_count;
+  }
+}
+
+void PeCommMatrix::Merge(const PeCommMatrix &other) {
+  for (size_t i = 0; i < dense_.size(); ++i)
+    dense_[i].Merge(other.dense_[i]);
+  for (const auto &[key, cell] : other.sparse_)
+    sparse_[key].Merge(cell);
+}
+
+auto PeCommMatrix::Rows() const -> std::vector<PeCommMatrixRow> {
+  std::vector<PeCommMatrixRow> rows;
+  auto add = [&](int32_t src_pe, int32_t dst_pe, int64_t bin,
+                 const Cell &cell) {
+    std::optional<int64_t> bin_start;
+    if (bin_us_ > 0)
+      bin_start = bin * bin_us_;
+    rows.push_back({src_pe, dst_pe, bin_start, cell.count, cell.bytes,
+                    cell.latency_us, cell.latency_count});
+  };
+  for (int32_t src = 0; src < dense_pes_; ++src) {
+    for (int32_t dst = 0; dst < dense_pes_; ++dst) {
+      const Cell &cell =
+          dense_[static_cast<size_t>(int64_t{src} * dense_pes_ + dst)];
+      if (cell.count > 0)
+        add(src, dst, 0, cell);
+    }
+  }
+  for (const auto &[key, cell] : sparse_)
+    add(std::get<0>(key), std::get<1>(key), std::get<2>(key), cell);
+  std::sort(rows.begin(), rows.end(),
+            [](const PeCommMatrixRow &a, const PeCommMatrixRow &b) {
+              return std::tie(a.src_pe, a.dst_pe, a.bin_start_us) <
+                     std::tie(b.src_pe, b.dst_pe, b.bin_start_us);
+            });
+  return rows;
+}
+
+} // namespace charmvz
@@ -0,0 +1,187 @@
+#pragma once
+#include "log_parser.h"
+#include "sts_parser.h"
+#include "table_builder.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace charmvz {
+
+// The messages sent from one entry method to another. Counts and bytes are per
+// send; latency is per delivery, from the send to the start of the execution
+// that ran it, so a broadcast adds one send and a latency for each receiver.
+struct CommTotals {
+  int64_t message_count = 0;
+  int64_t total_bytes = 0;
+  int64_t delivery_count = 0;
+  int64_t total_latency_us = 0;
+  int64_t min_latency_us = std::numeric_limits<int64_t>::max();
+  int64_t max_latency_us = std::numeric_limits<int64_t>::min();
+
+  void AddMessage(int32_t msg_len) {
+    ++message_count;
+    total_bytes += msg_len;
+  }
+
+  void AddDelivery(int64_t latency_us) {
+    ++delivery_count;
+    total_latency_us += latency_us;
+    min_latency_us = std::min(min_latency_us, latency_us);
+    max_latency_us = std::max(max_latency_us, latency_us);
+  }
+
+  void Merge(const CommTotals &other) {
+    message_count += other.message_count;
+    total_bytes += other.total_bytes;
+    delivery_count += other.delivery_count;
+    total_latency_us += other.total_latency_us;
+    min_latency_us = std::min(min_latency_us, other.min_latency_us);
+    max_latency_us = std::max(max_latency_us, other.max_latency_us);
+  }
+};
+
+// One ep_comm_graph row. The collections are those the .sts gives the two
+// entry methods; a null sender is a send made outside any execution.
+struct EpCommGraphRow {
+  std::optional<int32_t> sender_ep_id;
+  int32_t receiver_ep_id;
+  std::optional<int32_t> sender_collection_id;
+  std::optional<int32_t> receiver_collection_id;
+  const CommTotals &totals;
+};
+
+template <> struct builders::RowDescriptor<EpCommGraphRow> {
+  using R = EpCommGraphRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::sender_ep_id, &R::receiver_ep_id, &R::sender_collection_id,
+      &R::receiver_collection_id,
+      [](const R &r) { return r.totals.message_count; },
+      [](const R &r) { return r.totals.total_bytes; },
+      [](const R &r) { return r.totals.delivery_count; },
+      [](const R &r) -> std::optional<int64_t> {
+        if (r.totals.delivery_count == 0)
+          return std::nullopt;
+        return r.totals.min_latency_us;
+      },
+      [](const R &r) -> std::optional<double> {
+        if (r.totals.delivery_count == 0)
+          return std::nullopt;
+        return static_cast<double>(r.totals.total_latency_us) /
+               static_cast<double>(r.totals.delivery_count);
+      },
+      [](const R &r) -> std::optional<int64_t> {
+        if (r.totals.delivery_count == 0)
+          return std::nullopt;
+        return r.totals.max_latency_us;
+      });
+};
+
+// The per-(sender ep, receiver ep) totals of the messages one Stage 3 thread
+// links. Each thread fills its own, and they are merged once linkage is done,
+// so the hot path takes no lock.
+class EpCommGraph {
+public:
+  static constexpr int32_t kNoSender = -1;
+
+  // The totals of messages from `sender_ep_id`, or kNoSender, to
+  // `receiver_ep_id`.
+  auto At(int32_t sender_ep_id, int32_t receiver_ep_id) -> CommTotals & {
+    return totals_[std::make_tuple(sender_ep_id, receiver_ep_id)];
+  }
+
+  void Merge(const EpCommGraph &other) {
+    for (const auto &[key, totals] : other.totals_)
+      totals_[key].Merge(totals);
+  }
+
+  // Appends one row per (sender ep, receiver ep), in that order, sends from
+  // outside any execution first.
+  void AppendTo(const StsData &sts_data,
+                builders::TableBuilder<EpCommGraphRow> &builder) const;
+
+  [[nodiscard]] auto size() const -> size_t { return totals_.size(); }
+
+private:
+  using Totals = std::unordered_map<std::tuple<int32_t, int32_t>, CommTotals,
+                                    TupleHash>;
+  Totals totals_;
+};
+
+// One pe_comm_matrix row: the deliveries from `src_pe` to `dst_pe`, in one
+// time bin of the sends when there are bins.
+struct PeCommMatrixRow {
+  int32_t src_pe;
+  int32_t dst_pe;
+  std::optional<int64_t> bin_start_us;
+  int64_t message_count;
+  int64_t total_bytes;
+  int64_t total_latency_us;
+  int64_t latency_count;
+};
+
+template <> struct builders::RowDescriptor<PeCommMatrixRow> {
+  using R = PeCommMatrixRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::src_pe, &R::dst_pe, &R::bin_start_us, &R::message_count,
+      &R::total_bytes, &R::total_latency_us, &R::latency_count);
+};
+
+// The deliveries one Stage 3 thread links, totalled per (src_pe, dst_pe) and,
+// with a bin width, per bin of send time. Small runs index a dense matrix,
+// which costs no hashing per message; past kDenseBytes across all threads the
+// matrix is a hash map of the pairs that occur. Binned totals are always kept
+// sparse, since few (pair, bin) cells are ever filled.
+class PeCommMatrix {
+public:
+  static constexpr int64_t kDenseBytes = int64_t{256} << 20;
+
+  // The side of the dense matrix for `total_pes` PEs totalled by `threads`
+  // threads, or 0 when they are to be sparse.
+  static auto DensePes(int32_t total_pes, int32_t threads, int64_t bin_us)
+      -> int32_t;
+
+  // Dense over `dense_pes` PEs, or sparse when that is 0; binned by
+  // `bin_us`, or not when that is 0.
+  PeCommMatrix(int32_t dense_pes, int64_t bin_us);
+
+  // Adds one delivery of `bytes` sent at `send_time_us`, with its latency
+  // when the receiving execution was seen.
+  void Add(int32_t src_pe, int32_t dst_pe, int64_t send_time_us,
+           int32_t bytes, std::optional<int64_t> latency_us);
+
+  // Adds `other`, which must share this matrix's shape and bins.
+  void Merge(const PeCommMatrix &other);
+
+  // Every filled cell, ordered by (src_pe, dst_pe, bin).
+  [[nodiscard]] auto Rows() const -> std::vector<PeCommMatrixRow>;
+
+private:
+  struct Cell {
+    int64_t count = 0;
+    int64_t bytes = 0;
+    int64_t latency_us = 0;
+    int64_t latency_count = 0;
+
+    void Merge(const Cell &other) {
+      count += other.count;
+      bytes += other.bytes;
+      latency_us += other.latency_us;
+      latency_count += other.latency_count;
+    }
+  };
+
+  int32_t dense_pes_;
+  int64_t bin_us_;
+  std::vector<Cell> dense_;
+  // Keyed on (src_pe, dst_pe, bin); also holds a dense matrix's PEs outside
+  // its range.
+  std::unordered_map<std::tuple<int32_t, int32_t, int64_t>, Cell, TupleHash>
+      sparse_;
+};
+
+} // namespace charmvz
@@ -0,0 +1,258 @@
+#include "critical_path.h"
+#include "output_writer.h"
+#include "schema.h"
+#include "spill.h"
+#include <algorithm>
+#include <map>
+#include <spdlog/spdlog.h>
+
+namespace charmvz {
+
+namespace {
+
+auto duration(const ExecutionSpanRecord &exec) -> int64_t {
+  return exec.end_time_us - exec.start_time_us;
+}
+
+// The step whose interval on the execution's PE contains its start, if any.
+auto step_of(const ExecutionSpanRecord &exec,
+             const std::unordered_map<int32_t,
+                                      std::vector<const StepBoundaryRecord *>>
+                 &steps) -> std::optional<int32_t> {
+  const auto it = steps.find(exec.pe_id);
+  if (it == steps.end())
+    return std::nullopt;
+  const auto &pe_steps = it->second;
+  const auto after = std::upper_bound(
+      pe_steps.begin(), pe_steps.end(), exec.start_time_us,
+      [](int64_t t, const StepBoundaryRecord *step) {
+        return t < step->start_time_us;
+      });
+  if (after == pe_steps.begin())
+    return std::nullopt;
+  const StepBoundaryRecord &step = **std::prev(after);
+  if (step.has_end_time && exec.start_time_us >= step.end_time_us)
+    return std::nullopt;
+  return step.step_id;
+}
+
+} // namespace
+
+DependencyGraph::DependencyGraph(
+    std::vector<ExecutionSpanRecord> executions,
+    const std::vector<StepBoundaryRecord> &steps)
+    : spans_(std::move(executions)) {
+  std::unordered_map<int32_t, std::vector<const StepBoundaryRecord *>>
+      pe_steps;
+  for (const auto &step : steps)
+    pe_steps[step.pe_id].push_back(&step);
+  for (auto &[pe, list] : pe_steps) {
+    std::sort(list.begin(), list.end(),
+              [](const StepBoundaryRecord *a, const StepBoundaryRecord *b) {
+                return a->start_time_us < b->start_time_us;
+              });
+  }
+
+  nodes_.reserve(static_cast<size_t>(spans_.size()));
+  for (int32_t v = 0; v < spans_.size(); ++v)
+    nodes_.push_back({step_of(spans_[v], pe_steps)});
+
+  for (const auto &[pe, indices] : spans_.by_pe()) {
+    // The PE's executions by end, so the one that last ended before each
+    // start is found in a single sweep.
+    std::vector<int32_t> by_end = indices;
+    std::sort(by_end.begin(), by_end.end(), [&](int32_t a, int32_t b) {
+      return std::tie(spans_[a].end_time_us, a) <
+             std::tie(spans_[b].end_time_us, b);
+    });
+    size_t ended = 0;
+    for (const int32_t v : indices) {
+      Node &node = nodes_[v];
+      const int64_t start = spans_[v].start_time_us;
+      while (ended < by_end.size() &&
+             spans_[by_end[ended]].end_time_us <= start)
+        ++ended;
+      // Only a zero-length execution at `start` can sort after v here.
+      for (size_t i = ended; i > 0; --i) {
+        const int32_t prev = by_end[i - 1];
+        if (prev < v) {
+          if (nodes_[prev].step_id == node.step_id)
+            node.prev_on_pe = prev;
+          break;
+        }
+      }
+      const int32_t parent = spans_.Running(pe, start, v, true);
+      if (parent >= 0)
+        AddEdge(parent, v, start, 0, true);
+    }
+  }
+}
+
+void DependencyGraph::AddEdge(int32_t from, int32_t to, int64_t leave_us,
+                              int64_t flight_us, bool nested) {
+  if (from >= to || nodes_[from].step_id != nodes_[to].step_id)
+    return;
+  edges_.push_back({from, to, leave_us, flight_us, nested});
+}
+
+void DependencyGraph::AddMessage(int32_t src_pe, int32_t event,
+                                 int64_t send_time_us) {
+  const int32_t sender =
+      spans_.Running(src_pe, send_time_us, spans_.size(), false);
+  if (sender < 0)
+    return;
+  for (const auto &[pe, ev, receiver] : spans_.Receivers(src_pe, event)) {
+    const int64_t flight_us =
+        std::max<int64_t>(0, spans_[receiver].recv_time_us - send_time_us);
+    AddEdge(sender, receiver, send_time_us, flight_us, false);
+  }
+}
+
+void DependencyGraph::Solve(CriticalPathBuilder &path,
+                            ExecutionSlackBuilder &slack) const {
+  const auto count = nodes_.size();
+  std::vector<std::vector<const Edge *>> in(count);
+  std::vector<std::vector<const Edge *>> out(count);
+  std::vector<std::vector<int32_t>> next_on_pe(count);
+  for (const Edge &edge : edges_) {
+    in[edge.to].push_back(&edge);
+    out[edge.from].push_back(&edge);
+  }
+  for (size_t v = 0; v < count; ++v) {
+    if (nodes_[v].prev_on_pe >= 0)
+      next_on_pe[nodes_[v].prev_on_pe].push_back(static_cast<int32_t>(v));
+  }
+
+  // Forward, in index order: the longest path reaching each node's start,
+  // and the edge it came by -- null for program order, or for none, which
+  // prev_on_pe tells apart.
+  std::vector<int64_t> begin(count, 0);
+  std::vector<const Edge *> via(count, nullptr);
+  std::vector<bool> from_prev(count, false);
+  auto leave = [&](const Edge &edge) {
+    return begin[edge.from] + edge.leave_us -
+           spans_[edge.from].start_time_us + edge.flight_us;
+  };
+  for (size_t v = 0; v < count; ++v) {
+    const int32_t prev = nodes_[v].prev_on_pe;
+    if (prev >= 0) {
+      begin[v] = begin[prev] + duration(spans_[prev]);
+      from_prev[v] = true;
+    }
+    for (const Edge *edge : in[v]) {
+      if (leave(*edge) > begin[v]) {
+        begin[v] = leave(*edge);
+        via[v] = edge;
+        from_prev[v] = false;
+      }
+    }
+  }
+
+  // Backward: the longest path leaving each node's start.
+  std::vector<int64_t> tail(count, 0);
+  for (size_t v = count; v-- > 0;) {
+    const ExecutionSpanRecord &exec = spans_[static_cast<int32_t>(v)];
+    int64_t longest = duration(exec);
+    for (const int32_t next : next_on_pe[v])
+      longest = std::max(longest, duration(exec) + tail[next]);
+    for (const Edge *edge : out[v]) {
+      longest = std::max(longest, edge->leave_us - exec.start_time_us +
+                                      edge->flight_us + tail[edge->to]);
+    }
+    tail[v] = longest;
+  }
+
+  // Each group's path ends where the longest path does.
+  auto finish = [&](size_t v) {
+    return begin[v] + duration(spans_[static_cast<int32_t>(v)]);
+  };
+  std::map<std::optional<int32_t>, size_t> ends;
+  for (size_t v = 0; v < count; ++v) {
+    const auto [it, inserted] = ends.try_emplace(nodes_[v].step_id, v);
+    if (finish(v) > finish(it->second))
+      it->second = v;
+  }
+
+  std::vector<bool> on_path(count, false);
+  std::map<std::optional<int32_t>, int64_t> lengths;
+  for (const auto &[step_id, end] : ends) {
+    std::vector<CriticalPathSegment> segments;
+    auto v = static_cast<int32_t>(end);
+    int64_t cut_us = spans_[v].end_time_us;
+    lengths[step_id] = finish(end);
+    while (v >= 0) {
+      const ExecutionSpanRecord &exec = spans_[v];
+      on_path[v] = true;
+      segments.push_back({step_id, 0, "execution", exec.pe_id, exec.src_pe,
+                          exec.event, exec.ep_id, exec.start_time_us, cut_us,
+                          begin[v] + cut_us - exec.start_time_us});
+      if (from_prev[v]) {
+        v = nodes_[v].prev_on_pe;
+        cut_us = spans_[v].end_time_us;
+      } else if (via[v]) {
+        const Edge &edge = *via[v];
+        if (!edge.nested) {
+          segments.push_back({step_id, 0, "message", exec.pe_id, exec.src_pe,
+                              exec.event, exec.ep_id, edge.leave_us,
+                              edge.leave_us + edge.flight_us, leave(edge)});
+        }
+        v = edge.from;
+        cut_us = edge.leave_us;
+      } else {
+        v = -1;
+      }
+    }
+    std::reverse(segments.begin(), segments.end());
+    for (size_t i = 0; i < segments.size(); ++i) {
+      segments[i].segment = static_cast<int32_t>(i);
+      path.Append(segments[i]);
+    }
+  }
+
+  for (size_t v = 0; v < count; ++v) {
+    const ExecutionSpanRecord &exec = spans_[static_cast<int32_t>(v)];
+    const std::optional<int32_t> step_id = nodes_[v].step_id;
+    slack.Append({step_id, exec.pe_id, exec.src_pe, exec.event, exec.ep_id,
+                  exec.start_time_us, exec.end_time_us,
+                  lengths[step_id] - begin[v] - tail[v], on_path[v]});
+  }
+}
+
+void reconstruct_critical_path(const LogParserResult &log_data,
+                               const RcData &rc_data,
+                               const std::string &output_dir,
+                               const OutputOptions &options) {
+  spdlog::info("Building the dependency graph of {} executions",
+               log_data.executions.size());
+  DependencyGraph graph(log_data.executions, log_data.step_boundaries);
+  auto add_messages = [&](const CreationMap &creations) {
+    for (const auto &[key, creation] : creations) {
+      graph.AddMessage(std::get<0>(key), std::get<1>(key),
+                       creation.send_time_us - rc_data.global_start_time_us);
+    }
+  };
+  if (log_data.spill) {
+    for (int32_t part = 0; part < SpillStore::kPartitions; ++part) {
+      CreationMap creations;
+      log_data.spill->Load(part, creations);
+      add_messages(creations);
+    }
+  } else {
+    add_messages(log_data.creation_map);
+  }
+
+  const auto path_schema = schema::critical_path();
+  const auto slack_schema = schema::execution_slack();
+  auto path_writer =
+      open_table_writer(output_dir, "critical_path", path_schema, options);
+  auto slack_writer =
+      open_table_writer(output_dir, "execution_slack", slack_schema, options);
+  CriticalPathBuilder path(*path_writer, path_schema);
+  ExecutionSlackBuilder slack(*slack_writer, slack_schema);
+  graph.Solve(path, slack);
+  path.Flush();
+  slack.Flush();
+  spdlog::info("Wrote {} critical path segments", path.total_rows());
+}
+
+} // namespace charmvz
@@ -0,0 +1,121 @@
+#pragma once
+#include "execution_spans.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "table_builder.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace charmvz {
+
+// One segment of a critical path: an execution, cut short where the path
+// leaves it on a message, or the message's flight to the next execution.
+// `src_pe` and `event` key the message in both cases -- the one the execution
+// ran, or the one in flight -- and `path_us` is the path's length at the
+// segment's end.
+struct CriticalPathSegment {
+  std::optional<int32_t> step_id;
+  int32_t segment;
+  std::string kind;
+  int32_t pe_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t ep_id;
+  int64_t start_us;
+  int64_t end_us;
+  int64_t path_us;
+};
+
+template <> struct builders::RowDescriptor<CriticalPathSegment> {
+  using R = CriticalPathSegment;
+  static constexpr auto columns = std::make_tuple(
+      &R::step_id, &R::segment, &R::kind, &R::pe_id, &R::src_pe, &R::event,
+      &R::ep_id, &R::start_us, &R::end_us, &R::path_us);
+};
+
+// How much one execution could be delayed without lengthening its step's
+// critical path.
+struct ExecutionSlackRow {
+  std::optional<int32_t> step_id;
+  int32_t pe_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t ep_id;
+  int64_t start_us;
+  int64_t end_us;
+  int64_t slack_us;
+  bool on_critical_path;
+};
+
+template <> struct builders::RowDescriptor<ExecutionSlackRow> {
+  using R = ExecutionSlackRow;
+  static constexpr auto columns =
+      std::make_tuple(&R::step_id, &R::pe_id, &R::src_pe, &R::event,
+                      &R::ep_id, &R::start_us, &R::end_us, &R::slack_us,
+                      &R::on_critical_path);
+};
+
+using CriticalPathBuilder = builders::TableBuilder<CriticalPathSegment>;
+using ExecutionSlackBuilder = builders::TableBuilder<ExecutionSlackRow>;
+
+// The execution -> message -> execution DAG of a run, split by simulation
+// step. An execution depends on the one before it on its PE, on the
+// execution that sent its message, and, when nested, on the execution it
+// runs inside. A path's length is the time spent executing plus the time
+// messages spend in flight; waiting is not counted, so the longest path is
+// the chain of work that bounds the step.
+class DependencyGraph {
+public:
+  // Each execution joins the step whose interval on its own PE contains its
+  // start; without steps, or outside them, it is in the step-less group.
+  // Edges never cross groups.
+  DependencyGraph(std::vector<ExecutionSpanRecord> executions,
+                  const std::vector<StepBoundaryRecord> &steps);
+
+  // A message sent on `src_pe` at `send_time_us`, aligned to the global
+  // start. It links the execution running on src_pe then to every execution
+  // of (src_pe, event), and is dropped when either is missing.
+  void AddMessage(int32_t src_pe, int32_t event, int64_t send_time_us);
+
+  // Appends each group's critical path, segment by segment, and the slack of
+  // every execution.
+  void Solve(CriticalPathBuilder &path, ExecutionSlackBuilder &slack) const;
+
+private:
+  struct Node {
+    std::optional<int32_t> step_id;
+    // The execution that last ended on the PE before this one started.
+    int32_t prev_on_pe = -1;
+  };
+  // A dependency other than program order: a message, or a nested call,
+  // which leaves its parent at the child's start with nothing in flight.
+  struct Edge {
+    int32_t from;
+    int32_t to;
+    int64_t leave_us;
+    int64_t flight_us;
+    bool nested;
+  };
+
+  void AddEdge(int32_t from, int32_t to, int64_t leave_us, int64_t flight_us,
+               bool nested);
+
+  // Every edge follows the spans' order.
+  ExecutionSpans spans_;
+  // Alongside spans_.
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
+};
+
+// Builds the graph from Stage 2's executions and messages and writes
+// critical_path and execution_slack.
+void reconstruct_critical_path(const LogParserResult &log_data,
+                               const RcData &rc_data,
+                               const std::string &output_dir,
+                               const OutputOptions &options = {});
+
+} // namespace charmvz
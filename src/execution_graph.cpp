@@ -0,0 +1,194 @@
+#include "execution_graph.h"
+#include "execution_spans.h"
+#include "output_writer.h"
+#include "parallel.h"
+#include "schema.h"
+#include "spill.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace charmvz {
+
+namespace {
+
+template <class T> constexpr auto npy_type() -> const char * {
+  if constexpr (std::is_same_v<T, int64_t>)
+    return "i8";
+  else if constexpr (std::is_same_v<T, int32_t>)
+    return "i4";
+  else
+    return "u1";
+}
+
+// Writes `values` as a one-dimensional NumPy .npy file (format 1.0). The
+// header is padded so the data starts 64-byte aligned, as numpy.load with
+// mmap_mode expects; a C++ reader maps the file and skips the header, whose
+// length is the little-endian uint16 at offset 8, plus ten bytes.
+template <class T>
+void write_npy(const std::filesystem::path &path,
+               const std::vector<T> &values) {
+  const char order = std::endian::native == std::endian::little ? '<' : '>';
+  std::string header = std::string("{'descr': '") + order + npy_type<T>() +
+                       "', 'fortran_order': False, 'shape': (" +
+                       std::to_string(values.size()) + ",), }";
+  constexpr size_t kPreamble = 10;
+  const size_t padded = (kPreamble + header.size() + 1 + 63) / 64 * 64;
+  header.append(padded - kPreamble - header.size() - 1, ' ');
+  header += '\n';
+  const auto header_len = static_cast<uint16_t>(header.size());
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write("\x93NUMPY\x01\x00", 8);
+  const char len[2] = {static_cast<char>(header_len & 0xff),
+                       static_cast<char>(header_len >> 8)};
+  out.write(len, 2);
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+  out.write(reinterpret_cast<const char *>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(T)));
+  if (!out.flush()) {
+    spdlog::error("Failed writing {}", path.string());
+    throw std::runtime_error("Could not write execution graph");
+  }
+}
+
+} // namespace
+
+auto build_csr(int32_t num_nodes,
+               const std::vector<std::vector<GraphEdge>> &edges) -> CsrGraph {
+  const auto threads = static_cast<int32_t>(edges.size());
+  const auto nodes = static_cast<size_t>(num_nodes);
+  std::vector<std::atomic<int64_t>> cursor(nodes);
+  for_each_bucket(threads, [&](int32_t list) {
+    for (const GraphEdge &edge : edges[list])
+      cursor[edge.from].fetch_add(1, std::memory_order_relaxed);
+  });
+
+  CsrGraph graph;
+  graph.indptr.assign(nodes + 1, 0);
+  for (size_t v = 0; v < nodes; ++v) {
+    graph.indptr[v + 1] = graph.indptr[v] + cursor[v].load();
+    cursor[v].store(graph.indptr[v]);
+  }
+  graph.indices.resize(static_cast<size_t>(graph.indptr.back()));
+  graph.edge_kind.resize(graph.indices.size());
+  for_each_bucket(threads, [&](int32_t list) {
+    for (const GraphEdge &edge : edges[list]) {
+      const auto at = static_cast<size_t>(
+          cursor[edge.from].fetch_add(1, std::memory_order_relaxed));
+      graph.indices[at] = edge.to;
+      graph.edge_kind[at] = static_cast<uint8_t>(edge.kind);
+    }
+  });
+
+  // The scatter leaves each row in whatever order the threads reached it;
+  // sorting the rows makes the files the same from run to run.
+  for_each_bucket(threads, [&](int32_t list) {
+    std::vector<std::pair<int32_t, uint8_t>> row;
+    for (size_t v = static_cast<size_t>(list); v < nodes;
+         v += static_cast<size_t>(threads)) {
+      const auto first = static_cast<size_t>(graph.indptr[v]);
+      const auto last = static_cast<size_t>(graph.indptr[v + 1]);
+      if (last - first < 2)
+        continue;
+      row.clear();
+      for (size_t i = first; i < last; ++i)
+        row.emplace_back(graph.indices[i], graph.edge_kind[i]);
+      std::sort(row.begin(), row.end());
+      for (size_t i = first; i < last; ++i)
+        std::tie(graph.indices[i], graph.edge_kind[i]) = row[i - first];
+    }
+  });
+  return graph;
+}
+
+void write_execution_graph(const LogParserResult &log_data,
+                           const RcData &rc_data,
+                           const std::string &output_dir,
+                           const OutputOptions &options) {
+  if (output_dir == kStdoutPath)
+    return;
+  const ExecutionSpans spans(log_data.executions);
+  const auto threads = static_cast<int32_t>(
+      std::max(1U, std::thread::hardware_concurrency()));
+  std::vector<std::vector<GraphEdge>> edges(static_cast<size_t>(threads));
+
+  // Each thread takes every threads-th PE's succession edges and a
+  // contiguous share of the messages.
+  std::vector<const std::vector<int32_t> *> pes;
+  for (const auto &[pe, indices] : spans.by_pe())
+    pes.push_back(&indices);
+  for_each_bucket(threads, [&](int32_t list) {
+    for (size_t p = static_cast<size_t>(list); p < pes.size();
+         p += static_cast<size_t>(threads)) {
+      const auto &indices = *pes[p];
+      for (size_t i = 1; i < indices.size(); ++i) {
+        edges[list].push_back(
+            {indices[i - 1], indices[i], GraphEdgeKind::Succession});
+      }
+    }
+  });
+  auto add_messages = [&](const CreationMap &creations) {
+    std::vector<const CreationMap::value_type *> sends;
+    sends.reserve(creations.size());
+    for (const auto &entry : creations)
+      sends.push_back(&entry);
+    for_each_bucket(threads, [&](int32_t list) {
+      const size_t share = (sends.size() + threads - 1) / threads;
+      const size_t first = std::min(sends.size(), list * share);
+      const size_t last = std::min(sends.size(), first + share);
+      for (size_t i = first; i < last; ++i) {
+        const auto &[key, creation] = *sends[i];
+        const auto [src_pe, event] = key;
+        const int32_t sender = spans.Running(
+            src_pe, creation.send_time_us - rc_data.global_start_time_us,
+            spans.size(), false);
+        if (sender < 0)
+          continue;
+        for (const auto &[pe, ev, receiver] : spans.Receivers(src_pe, event)) {
+          if (receiver != sender)
+            edges[list].push_back({sender, receiver, GraphEdgeKind::Message});
+        }
+      }
+    });
+  };
+  if (log_data.spill) {
+    for (int32_t part = 0; part < SpillStore::kPartitions; ++part) {
+      CreationMap creations;
+      log_data.spill->Load(part, creations);
+      add_messages(creations);
+    }
+  } else {
+    add_messages(log_data.creation_map);
+  }
+
+  const CsrGraph graph = build_csr(spans.size(), edges);
+  const std::filesystem::path dir =
+      std::filesystem::path(output_dir) / "execution_graph";
+  std::filesystem::create_directories(dir);
+  write_npy(dir / "indptr.npy", graph.indptr);
+  write_npy(dir / "indices.npy", graph.indices);
+  write_npy(dir / "edge_kind.npy", graph.edge_kind);
+
+  const auto node_schema = schema::execution_graph_nodes();
+  auto node_writer = open_table_writer(output_dir, "execution_graph/nodes",
+                                       node_schema, options);
+  builders::TableBuilder<ExecutionGraphNode> nodes(*node_writer, node_schema);
+  for (int32_t v = 0; v < spans.size(); ++v) {
+    const ExecutionSpanRecord &exec = spans[v];
+    nodes.Append({v, exec.pe_id, exec.src_pe, exec.event, exec.ep_id,
+                  exec.start_time_us, exec.end_time_us});
+  }
+  nodes.Flush();
+  spdlog::info("Wrote the execution graph: {} nodes, {} edges",
+               spans.size(), graph.indices.size());
+}
+
+} // namespace charmvz
@@ -0,0 +1,67 @@
+#pragma once
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "table_builder.h"
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace charmvz {
+
+// A node of the execution graph: one execution, numbered in (start, end, pe)
+// order. The node table maps those numbers back to the trace.
+struct ExecutionGraphNode {
+  int32_t node_id;
+  int32_t pe_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t ep_id;
+  int64_t start_time_us;
+  int64_t end_time_us;
+};
+
+template <> struct builders::RowDescriptor<ExecutionGraphNode> {
+  using R = ExecutionGraphNode;
+  static constexpr auto columns =
+      std::make_tuple(&R::node_id, &R::pe_id, &R::src_pe, &R::event,
+                      &R::ep_id, &R::start_time_us, &R::end_time_us);
+};
+
+enum class GraphEdgeKind : uint8_t {
+  // To the next execution to start on the same PE.
+  Succession = 0,
+  // From the execution running when a message was sent to one that ran it.
+  Message = 1,
+};
+
+struct GraphEdge {
+  int32_t from;
+  int32_t to;
+  GraphEdgeKind kind;
+};
+
+// The graph in compressed sparse row form: node v's out-edges are
+// indices[indptr[v] .. indptr[v + 1]), sorted by target then kind, with each
+// edge's GraphEdgeKind alongside in edge_kind. Two messages between the same
+// executions are two edges.
+struct CsrGraph {
+  std::vector<int64_t> indptr;
+  std::vector<int32_t> indices;
+  std::vector<uint8_t> edge_kind;
+};
+
+// Counting-sorts `edges` into CSR form over `num_nodes` nodes, with a thread
+// per list of edges for the counting and the scatter.
+auto build_csr(int32_t num_nodes,
+               const std::vector<std::vector<GraphEdge>> &edges) -> CsrGraph;
+
+// Writes execution_graph/: the node table, and indptr.npy, indices.npy and
+// edge_kind.npy, which NumPy and C++ can memory-map as they are.
+void write_execution_graph(const LogParserResult &log_data,
+                           const RcData &rc_data,
+                           const std::string &output_dir,
+                           const OutputOptions &options = {});
+
+} // namespace charmvz
@@ -0,0 +1,67 @@
+#include "execution_spans.h"
+#include <algorithm>
+#include <limits>
+
+namespace charmvz {
+
+ExecutionSpans::ExecutionSpans(std::vector<ExecutionSpanRecord> executions)
+    : executions_(std::move(executions)) {
+  std::sort(executions_.begin(), executions_.end(),
+            [](const ExecutionSpanRecord &a, const ExecutionSpanRecord &b) {
+              return std::tie(a.start_time_us, a.end_time_us, a.pe_id) <
+                     std::tie(b.start_time_us, b.end_time_us, b.pe_id);
+            });
+  receivers_.reserve(executions_.size());
+  for (int32_t v = 0; v < size(); ++v) {
+    const ExecutionSpanRecord &exec = (*this)[v];
+    receivers_.emplace_back(exec.src_pe, exec.event, v);
+    by_pe_[exec.pe_id].push_back(v);
+    auto &max_ends = max_end_by_pe_[exec.pe_id];
+    max_ends.push_back(max_ends.empty()
+                           ? exec.end_time_us
+                           : std::max(max_ends.back(), exec.end_time_us));
+  }
+  std::sort(receivers_.begin(), receivers_.end());
+}
+
+auto ExecutionSpans::Running(int32_t pe, int64_t time_us, int32_t before,
+                             bool strict) const -> int32_t {
+  const auto it = by_pe_.find(pe);
+  if (it == by_pe_.end())
+    return -1;
+  const auto &indices = it->second;
+  const auto &max_ends = max_end_by_pe_.at(pe);
+  // A PE's executions are in order, so in start order too.
+  const auto bound = std::min(
+      std::lower_bound(indices.begin(), indices.end(), before),
+      std::upper_bound(indices.begin(), indices.end(), time_us,
+                       [&](int64_t t, int32_t v) {
+                         return t < (*this)[v].start_time_us;
+                       }));
+  auto runs = [&](int64_t end_us) {
+    return strict ? end_us > time_us : end_us >= time_us;
+  };
+  // The innermost is the latest to start; once no earlier execution ends
+  // late enough, none is running.
+  for (auto i = static_cast<size_t>(bound - indices.begin()); i > 0; --i) {
+    if (!runs(max_ends[i - 1]))
+      break;
+    if (runs((*this)[indices[i - 1]].end_time_us))
+      return indices[i - 1];
+  }
+  return -1;
+}
+
+auto ExecutionSpans::Receivers(int32_t src_pe, int32_t event) const
+    -> std::span<const Receiver> {
+  const auto first = std::lower_bound(
+      receivers_.begin(), receivers_.end(),
+      Receiver{src_pe, event, std::numeric_limits<int32_t>::min()});
+  auto last = first;
+  while (last != receivers_.end() && std::get<0>(*last) == src_pe &&
+         std::get<1>(*last) == event)
+    ++last;
+  return {first, last};
+}
+
+} // namespace charmvz
@@ -0,0 +1,53 @@
+#pragma once
+#include "log_parser.h"
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace charmvz {
+
+// Stage 2's executions in (start, end, pe) order, numbered by that order, and
+// indexed for the lookups both Stage 3 graphs make: the executions of a PE,
+// the one running on a PE at some time, and the ones that ran a message.
+class ExecutionSpans {
+public:
+  // (src_pe, event, execution): one execution of a message.
+  using Receiver = std::tuple<int32_t, int32_t, int32_t>;
+
+  explicit ExecutionSpans(std::vector<ExecutionSpanRecord> executions);
+
+  [[nodiscard]] auto size() const -> int32_t {
+    return static_cast<int32_t>(executions_.size());
+  }
+  [[nodiscard]] auto operator[](int32_t execution) const
+      -> const ExecutionSpanRecord & {
+    return executions_[static_cast<size_t>(execution)];
+  }
+  // Per PE, its executions in order.
+  [[nodiscard]] auto by_pe() const
+      -> const std::unordered_map<int32_t, std::vector<int32_t>> & {
+    return by_pe_;
+  }
+
+  // The innermost execution on `pe` running at `time_us` among those before
+  // `before`; -1 when none is. A `strict` match must end after time_us, not
+  // at it.
+  [[nodiscard]] auto Running(int32_t pe, int64_t time_us, int32_t before,
+                             bool strict) const -> int32_t;
+  // The executions of the message (src_pe, event): one, or one per
+  // destination of a broadcast, or none when it was never run.
+  [[nodiscard]] auto Receivers(int32_t src_pe, int32_t event) const
+      -> std::span<const Receiver>;
+
+private:
+  std::vector<ExecutionSpanRecord> executions_;
+  std::unordered_map<int32_t, std::vector<int32_t>> by_pe_;
+  // Alongside by_pe_, the running maximum of its executions' ends.
+  std::unordered_map<int32_t, std::vector<int64_t>> max_end_by_pe_;
+  // Sorted, for looking up a message's executions.
+  std::vector<Receiver> receivers_;
+};
+
+} // namespace charmvz
@@ -0,0 +1,131 @@
+#include "flight_server.h"
+#include <csignal>
+#include <exception>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <vector>
+
+namespace charmvz {
+
+namespace {
+
+// The catalog throws on a bad request, as the rest of the pipeline does;
+// Flight reports failures as a Status, which reaches the client as an error.
+auto to_request(const arrow::flight::FlightDescriptor &descriptor)
+    -> ScanRequest {
+  if (descriptor.type == arrow::flight::FlightDescriptor::PATH) {
+    if (descriptor.path.size() != 1) {
+      spdlog::error("A descriptor path names exactly one table");
+      throw std::runtime_error("Invalid descriptor");
+    }
+    ScanRequest request;
+    request.table = descriptor.path[0];
+    return request;
+  }
+  return decode_scan_request(descriptor.cmd);
+}
+
+auto make_info(const TableScanner &scanner, int64_t total_records,
+               const arrow::flight::FlightDescriptor &descriptor,
+               const ScanRequest &request) -> arrow::flight::FlightInfo {
+  arrow::flight::FlightEndpoint endpoint;
+  endpoint.ticket.ticket = encode_scan_request(request);
+  auto info = arrow::flight::FlightInfo::Make(*scanner.schema(), descriptor,
+                                              {endpoint}, total_records, -1);
+  if (!info.ok()) {
+    spdlog::error("Failed to describe {}: {}", request.table,
+                  info.status().ToString());
+    throw std::runtime_error("Could not build FlightInfo");
+  }
+  return std::move(*info);
+}
+
+} // namespace
+
+TraceFlightServer::TraceFlightServer(
+    std::shared_ptr<const TableCatalog> catalog)
+    : catalog_(std::move(catalog)) {}
+
+auto TraceFlightServer::ListFlights(
+    const arrow::flight::ServerCallContext & /*context*/,
+    const arrow::flight::Criteria * /*criteria*/,
+    std::unique_ptr<arrow::flight::FlightListing> *listings) -> arrow::Status {
+  try {
+    std::vector<arrow::flight::FlightInfo> infos;
+    for (const auto &[name, table] : catalog_->tables()) {
+      ScanRequest request;
+      request.table = name;
+      infos.push_back(make_info(*catalog_->Scan(request), table.num_rows,
+                                arrow::flight::FlightDescriptor::Path({name}),
+                                request));
+    }
+    *listings =
+        std::make_unique<arrow::flight::SimpleFlightListing>(std::move(infos));
+  } catch (const std::exception &e) {
+    return arrow::Status::IOError(e.what());
+  }
+  return arrow::Status::OK();
+}
+
+auto TraceFlightServer::GetFlightInfo(
+    const arrow::flight::ServerCallContext & /*context*/,
+    const arrow::flight::FlightDescriptor &request,
+    std::unique_ptr<arrow::flight::FlightInfo> *info) -> arrow::Status {
+  try {
+    const auto scan = to_request(request);
+    // The row count is the table's, before filtering: counting the matches
+    // would cost as much as serving them.
+    *info = std::make_unique<arrow::flight::FlightInfo>(
+        make_info(*catalog_->Scan(scan), catalog_->table(scan.table).num_rows,
+                  request, scan));
+  } catch (const std::exception &e) {
+    return arrow::Status::Invalid(e.what());
+  }
+  return arrow::Status::OK();
+}
+
+auto TraceFlightServer::DoGet(
+    const arrow::flight::ServerCallContext & /*context*/,
+    const arrow::flight::Ticket &request,
+    std::unique_ptr<arrow::flight::FlightDataStream> *stream) -> arrow::Status {
+  try {
+    // Batches are produced as the client drains them, so a reader that stops
+    // early never pays for the rest of the scan.
+    *stream = std::make_unique<arrow::flight::RecordBatchStream>(
+        catalog_->Scan(decode_scan_request(request.ticket)));
+  } catch (const std::exception &e) {
+    return arrow::Status::Invalid(e.what());
+  }
+  return arrow::Status::OK();
+}
+
+void serve_tables(const std::string &output_dir, int port) {
+  TraceFlightServer server(std::make_shared<const TableCatalog>(output_dir));
+
+  // Bound to the loopback interface only: the tables are served without
+  // authentication, to the processes of this machine.
+  auto location = arrow::flight::Location::ForGrpcTcp("localhost", port);
+  if (!location.ok()) {
+    spdlog::error("Invalid Flight location: {}", location.status().ToString());
+    throw std::runtime_error("Could not start Flight server");
+  }
+  arrow::flight::FlightServerOptions options(*location);
+  auto status = server.Init(options);
+  if (!status.ok()) {
+    spdlog::error("Failed to start Flight server: {}", status.ToString());
+    throw std::runtime_error("Could not start Flight server");
+  }
+  status = server.SetShutdownOnSignals({SIGINT, SIGTERM});
+  if (!status.ok()) {
+    spdlog::error("Failed to install signal handlers: {}", status.ToString());
+    throw std::runtime_error("Could not start Flight server");
+  }
+  spdlog::info("Serving {} on grpc://localhost:{}", output_dir, server.port());
+  status = server.Serve();
+  if (!status.ok()) {
+    spdlog::error("Flight server stopped: {}", status.ToString());
+    throw std::runtime_error("Flight server failed");
+  }
+}
+
+} // namespace charmvz
@@ -0,0 +1,41 @@
+#pragma once
+#include "table_scan.h"
+#include <arrow/flight/api.h>
+#include <memory>
+#include <string>
+
+namespace charmvz {
+
+// Serves the tables of one output directory over Arrow Flight.
+//
+// ListFlights names every table with its schema and row count. A FlightInfo or
+// DoGet request is a ScanRequest: as a descriptor, either a path naming the
+// table or a command holding encode_scan_request() text; as a ticket, always
+// the text. The filters run on the server, against the Parquet statistics
+// first, so a client receives only the rows and columns it asked for.
+class TraceFlightServer : public arrow::flight::FlightServerBase {
+public:
+  explicit TraceFlightServer(std::shared_ptr<const TableCatalog> catalog);
+
+  auto ListFlights(const arrow::flight::ServerCallContext &context,
+                   const arrow::flight::Criteria *criteria,
+                   std::unique_ptr<arrow::flight::FlightListing> *listings)
+      -> arrow::Status override;
+  auto GetFlightInfo(const arrow::flight::ServerCallContext &context,
+                     const arrow::flight::FlightDescriptor &request,
+                     std::unique_ptr<arrow::flight::FlightInfo> *info)
+      -> arrow::Status override;
+  auto DoGet(const arrow::flight::ServerCallContext &context,
+             const arrow::flight::Ticket &request,
+             std::unique_ptr<arrow::flight::FlightDataStream> *stream)
+      -> arrow::Status override;
+
+private:
+  std::shared_ptr<const TableCatalog> catalog_;
+};
+
+// Loads `output_dir` and serves it on localhost:`port` until SIGINT or
+// SIGTERM. Port 0 picks a free port, which is logged.
+void serve_tables(const std::string &output_dir, int port);
+
+} // namespace charmvz
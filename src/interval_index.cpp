@@ -0,0 +1,233 @@
+#include "interval_index.h"
+#include <algorithm>
+#include <arrow/ipc/reader.h>
+#include <parquet/arrow/reader.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace charmvz {
+
+namespace {
+
+template <class T>
+auto value_or_throw(arrow::Result<T> result, const std::string &what) -> T {
+  if (!result.ok()) {
+    spdlog::error("{}: {}", what, result.status().ToString());
+    throw std::runtime_error(what);
+  }
+  return std::move(*result);
+}
+
+void throw_not_ok(const arrow::Status &status, const std::string &what) {
+  if (!status.ok()) {
+    spdlog::error("{}: {}", what, status.ToString());
+    throw std::runtime_error(what);
+  }
+}
+
+// Calls `visit(batch, first_row)` for each unit of the file -- a Parquet row
+// group or an IPC record batch -- that `wanted(first_row, num_rows)` accepts.
+// Units turned down are not decoded; a Parquet row group's size is in the
+// footer, an IPC batch's only in its own header, so those are mapped but not
+// copied.
+template <class Wanted, class Visit>
+void for_each_unit(const TableFile &file, const arrow::Schema &schema,
+                   Wanted wanted, Visit visit) {
+  if (file.parquet_metadata) {
+    auto reader = value_or_throw(
+        parquet::arrow::OpenFile(file.file, arrow::default_memory_pool()),
+        "Could not open " + file.path);
+    std::vector<int> columns(static_cast<size_t>(schema.num_fields()));
+    for (size_t i = 0; i < columns.size(); ++i)
+      columns[i] = static_cast<int>(i);
+    int64_t first_row = 0;
+    const auto &metadata = *file.parquet_metadata;
+    for (int row_group = 0; row_group < metadata.num_row_groups();
+         ++row_group) {
+      const int64_t num_rows = metadata.RowGroup(row_group)->num_rows();
+      if (wanted(first_row, num_rows)) {
+        std::shared_ptr<arrow::Table> rows;
+        throw_not_ok(reader->ReadRowGroup(row_group, columns, &rows),
+                     "Could not read " + file.path);
+        arrow::TableBatchReader batches(*rows);
+        int64_t batch_row = first_row;
+        std::shared_ptr<arrow::RecordBatch> batch;
+        while (true) {
+          throw_not_ok(batches.ReadNext(&batch),
+                       "Could not read " + file.path);
+          if (!batch)
+            break;
+          visit(batch, batch_row);
+          batch_row += batch->num_rows();
+        }
+      }
+      first_row += num_rows;
+    }
+    return;
+  }
+  auto reader =
+      value_or_throw(arrow::ipc::RecordBatchFileReader::Open(file.file),
+                     "Could not open " + file.path);
+  int64_t first_row = 0;
+  for (int i = 0; i < reader->num_record_batches(); ++i) {
+    const auto batch = value_or_throw(reader->ReadRecordBatch(i),
+                                      "Could not read " + file.path);
+    if (wanted(first_row, batch->num_rows()))
+      visit(batch, first_row);
+    first_row += batch->num_rows();
+  }
+}
+
+template <class ArrayType, arrow::Type::type kType>
+auto typed_column(const arrow::RecordBatch &batch, const std::string &name,
+                  const std::string &path) -> const ArrayType & {
+  const auto column = batch.GetColumnByName(name);
+  if (!column || column->type_id() != kType) {
+    spdlog::error("{} is not an interval index: no column {} of the "
+                  "expected type",
+                  path, name);
+    throw std::runtime_error("Invalid interval index");
+  }
+  return static_cast<const ArrayType &>(*column);
+}
+
+} // namespace
+
+void IntervalIndexer::Drain(int32_t pe_id, IntervalIndexBuilder &builder) {
+  // Both tables write a PE's rows in start order already; sorting anyway
+  // keeps the binary searches sound whatever order the rows arrive in.
+  std::sort(intervals_.begin(), intervals_.end(),
+            [](const IntervalIndexRow &a, const IntervalIndexRow &b) {
+              return std::tie(a.start_us, a.row_offset) <
+                     std::tie(b.start_us, b.row_offset);
+            });
+  int64_t max_end_us = 0;
+  for (size_t i = 0; i < intervals_.size(); ++i) {
+    IntervalIndexRow &interval = intervals_[i];
+    max_end_us = i == 0 ? interval.end_us
+                        : std::max(max_end_us, interval.end_us);
+    interval.pe_id = pe_id;
+    interval.max_end_us = max_end_us;
+    builder.Append(interval);
+  }
+  intervals_.clear();
+}
+
+IntervalIndex::IntervalIndex(const TableCatalog &catalog,
+                             const std::string &table)
+    : table_name_(table), table_(catalog.table(table)) {
+  const auto &index = catalog.table(table + "_index");
+  if (index.files.size() != table_.files.size()) {
+    spdlog::error("{}_index has {} files for the {} of {}", table,
+                  index.files.size(), table_.files.size(), table);
+    throw std::runtime_error("Interval index does not match its table");
+  }
+
+  for (size_t file = 0; file < index.files.size(); ++file) {
+    const TableFile &index_file = index.files[file];
+    for_each_unit(
+        index_file, *index.schema, [](int64_t, int64_t) { return true; },
+        [&](const std::shared_ptr<arrow::RecordBatch> &batch, int64_t) {
+          const auto &path = index_file.path;
+          const auto &pe_ids =
+              typed_column<arrow::Int32Array, arrow::Type::INT32>(
+                  *batch, "pe_id", path);
+          auto int64s = [&](const char *name) -> const arrow::Int64Array & {
+            return typed_column<arrow::Int64Array, arrow::Type::INT64>(
+                *batch, name, path);
+          };
+          const auto &starts = int64s("start_us");
+          const auto &ends = int64s("end_us");
+          const auto &max_ends = int64s("max_end_us");
+          const auto &rows = int64s("row_offset");
+          for (int64_t i = 0; i < batch->num_rows(); ++i) {
+            const auto [it, inserted] = pes_.try_emplace(pe_ids.Value(i));
+            PeIntervals &pe = it->second;
+            if (inserted) {
+              pe.file = file;
+            } else if (pe.file != file ||
+                       starts.Value(i) < pe.start_us.back()) {
+              spdlog::error("{}: the intervals of PE {} are not one sorted "
+                            "run",
+                            path, pe_ids.Value(i));
+              throw std::runtime_error("Invalid interval index");
+            }
+            pe.start_us.push_back(starts.Value(i));
+            pe.end_us.push_back(ends.Value(i));
+            pe.max_end_us.push_back(max_ends.Value(i));
+            pe.row_offset.push_back(rows.Value(i));
+          }
+        });
+  }
+  spdlog::info("Loaded the interval index of {}: {} PEs", table, pes_.size());
+}
+
+auto IntervalIndex::Overlapping(int32_t pe_id, int64_t begin_us,
+                                int64_t end_us) const
+    -> std::vector<IntervalHit> {
+  std::vector<IntervalHit> hits;
+  const auto it = pes_.find(pe_id);
+  if (it == pes_.end())
+    return hits;
+  const PeIntervals &pe = it->second;
+  // Past `last` every interval starts too late; before `first` every one,
+  // and every one earlier, has ended before begin_us.
+  const auto first = static_cast<size_t>(
+      std::lower_bound(pe.max_end_us.begin(), pe.max_end_us.end(), begin_us) -
+      pe.max_end_us.begin());
+  const auto last = static_cast<size_t>(
+      std::lower_bound(pe.start_us.begin(), pe.start_us.end(), end_us) -
+      pe.start_us.begin());
+  for (size_t i = first; i < last; ++i) {
+    if (pe.end_us[i] >= begin_us)
+      hits.push_back({pe.file, pe.row_offset[i]});
+  }
+  std::sort(hits.begin(), hits.end(),
+            [](const IntervalHit &a, const IntervalHit &b) {
+              return a.row < b.row;
+            });
+  return hits;
+}
+
+auto IntervalIndex::Read(int32_t pe_id, int64_t begin_us,
+                         int64_t end_us) const
+    -> std::shared_ptr<arrow::Table> {
+  const auto hits = Overlapping(pe_id, begin_us, end_us);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> slices;
+  if (!hits.empty()) {
+    // One PE's rows are all in one file.
+    const TableFile &file = table_.files[hits.front().file];
+    size_t next = 0;
+    auto wanted = [&](int64_t first_row, int64_t num_rows) {
+      return next < hits.size() && hits[next].row < first_row + num_rows;
+    };
+    auto visit = [&](const std::shared_ptr<arrow::RecordBatch> &batch,
+                     int64_t first_row) {
+      const int64_t end_row = first_row + batch->num_rows();
+      while (next < hits.size() && hits[next].row < end_row) {
+        // A run of consecutive rows is one zero-copy slice.
+        const int64_t run_start = hits[next].row;
+        int64_t run_end = run_start + 1;
+        ++next;
+        while (next < hits.size() && hits[next].row == run_end &&
+               run_end < end_row) {
+          ++run_end;
+          ++next;
+        }
+        slices.push_back(
+            batch->Slice(run_start - first_row, run_end - run_start));
+      }
+    };
+    for_each_unit(file, *table_.schema, wanted, visit);
+    if (next < hits.size()) {
+      spdlog::error("{}_index points past the end of {}", table_name_,
+                    file.path);
+      throw std::runtime_error("Interval index does not match its table");
+    }
+  }
+  return value_or_throw(
+      arrow::Table::FromRecordBatches(table_.schema, slices),
+      "Could not assemble the rows of " + table_name_);
+}
+
+} // namespace charmvz
@@ -0,0 +1,96 @@
+#pragma once
+#include "table_builder.h"
+#include "table_scan.h"
+#include <arrow/api.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace charmvz {
+
+// One interval of an indexed table: where a row of execution or idle_interval
+// starts and ends, and its offset in the file that holds it. `max_end_us` is
+// the latest end of this and every earlier interval of the PE, which never
+// decreases, so the first interval that can reach a time is a binary search.
+struct IntervalIndexRow {
+  int32_t pe_id;
+  int64_t start_us;
+  int64_t end_us;
+  int64_t max_end_us;
+  int64_t row_offset;
+};
+
+template <> struct builders::RowDescriptor<IntervalIndexRow> {
+  using R = IntervalIndexRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::start_us, &R::end_us, &R::max_end_us, &R::row_offset);
+};
+
+using IntervalIndexBuilder = builders::TableBuilder<IntervalIndexRow>;
+
+// Collects the intervals of the PE being read and writes them as its index,
+// sorted by start.
+class IntervalIndexer {
+public:
+  // `row_offset` is the row's position in the file its builder writes.
+  void Add(int64_t start_us, int64_t end_us, int64_t row_offset) {
+    intervals_.push_back({0, start_us, end_us, 0, row_offset});
+  }
+
+  // Appends the PE's index to `builder` and starts over for the next PE.
+  void Drain(int32_t pe_id, IntervalIndexBuilder &builder);
+
+private:
+  std::vector<IntervalIndexRow> intervals_;
+};
+
+// A row of an indexed table: which of its catalog files, and where in it.
+struct IntervalHit {
+  size_t file;
+  int64_t row;
+};
+
+// The `<table>_index` sidecar of execution or idle_interval, loaded once, for
+// point and window queries that read only the rows they return. The sidecar
+// has the layout of its table -- one file, or one part per pe_bucket -- so its
+// K-th file indexes the table's K-th.
+class IntervalIndex {
+public:
+  // Throws if the catalog has no `<table>_index`, or it does not match the
+  // table's files.
+  IntervalIndex(const TableCatalog &catalog, const std::string &table);
+
+  // The rows of PE `pe_id` overlapping [begin_us, end_us) in file and row
+  // order, which is start order: a row is kept if it starts before end_us and
+  // ends at or after begin_us, as a TableScanner's time filter keeps it. Two
+  // binary searches and the candidates between them; nothing is read.
+  [[nodiscard]] auto Overlapping(int32_t pe_id, int64_t begin_us,
+                                 int64_t end_us) const
+      -> std::vector<IntervalHit>;
+
+  // Those rows, read from the table. Only the Parquet row groups or IPC
+  // batches holding them are decoded.
+  [[nodiscard]] auto Read(int32_t pe_id, int64_t begin_us,
+                          int64_t end_us) const
+      -> std::shared_ptr<arrow::Table>;
+
+private:
+  // One PE's index, sorted by start.
+  struct PeIntervals {
+    size_t file = 0;
+    std::vector<int64_t> start_us;
+    std::vector<int64_t> end_us;
+    std::vector<int64_t> max_end_us;
+    std::vector<int64_t> row_offset;
+  };
+
+  std::string table_name_;
+  // A copy, so the index holds the table's files open.
+  CatalogTable table_;
+  std::map<int32_t, PeIntervals> pes_;
+};
+
+} // namespace charmvz
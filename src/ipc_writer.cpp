@@ -0,0 +1,99 @@
+#include "ipc_writer.h"
+#include <arrow/util/compression.h>
+#include <spdlog/spdlog.h>
+
+namespace charmvz {
+
+namespace {
+
+auto open_file(const std::string &file_path)
+    -> std::shared_ptr<arrow::io::OutputStream> {
+  auto out_result = arrow::io::FileOutputStream::Open(file_path);
+  if (!out_result.ok()) {
+    spdlog::error("Failed to open output file {}: {}", file_path,
+                  out_result.status().ToString());
+    throw std::runtime_error("Could not open file writer");
+  }
+  return *out_result;
+}
+
+} // namespace
+
+IpcWriter::IpcWriter(std::shared_ptr<arrow::Schema> schema,
+                     const std::string &file_path, IpcCompression compression,
+                     arrow::MemoryPool *pool)
+    : IpcWriter(std::move(schema), open_file(file_path), IpcFraming::File,
+                compression, pool) {}
+
+IpcWriter::IpcWriter(std::shared_ptr<arrow::Schema> schema,
+                     std::shared_ptr<arrow::io::OutputStream> sink,
+                     IpcFraming framing, IpcCompression compression,
+                     arrow::MemoryPool *pool)
+    : schema_(std::move(schema)), pool_(pool), out_stream_(std::move(sink)),
+      framing_(framing) {
+  // The schema, key-value metadata included, is part of the IPC format, so
+  // the papi_event_N names survive without anything like store_schema().
+  auto write_options = arrow::ipc::IpcWriteOptions::Defaults();
+  write_options.memory_pool = pool_;
+  if (compression == IpcCompression::Lz4) {
+    auto codec_result =
+        arrow::util::Codec::Create(arrow::Compression::LZ4_FRAME);
+    if (!codec_result.ok()) {
+      spdlog::error("LZ4 is not available: {}",
+                    codec_result.status().ToString());
+      throw std::runtime_error("Could not create IPC compression codec");
+    }
+    write_options.codec = std::move(*codec_result);
+  }
+
+  auto writer_result =
+      framing_ == IpcFraming::Stream
+          ? arrow::ipc::MakeStreamWriter(out_stream_, schema_, write_options)
+          : arrow::ipc::MakeFileWriter(out_stream_, schema_, write_options);
+  if (!writer_result.ok()) {
+    spdlog::error("Failed to open IPC writer: {}",
+                  writer_result.status().ToString());
+    throw std::runtime_error("Could not create IPC writer");
+  }
+  writer_ = std::move(*writer_result);
+}
+
+IpcWriter::~IpcWriter() { Close(); }
+
+void IpcWriter::WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) {
+  if (closed_)
+    return;
+  auto status = writer_->WriteRecordBatch(*batch);
+  if (!status.ok()) {
+    spdlog::error("Failed to write batch to IPC output: {}", status.ToString());
+    return;
+  }
+  // A buffered stream would hold batches back from the consumer until the
+  // buffer fills, which defeats streaming them.
+  if (framing_ == IpcFraming::Stream) {
+    status = out_stream_->Flush();
+    if (!status.ok()) {
+      spdlog::error("Failed to flush IPC stream: {}", status.ToString());
+    }
+  }
+}
+
+void IpcWriter::Close() {
+  if (closed_)
+    return;
+  if (writer_) {
+    auto status = writer_->Close();
+    if (!status.ok()) {
+      spdlog::error("Failed to close IPC writer: {}", status.ToString());
+    }
+  }
+  if (out_stream_) {
+    auto status = out_stream_->Close();
+    if (!status.ok()) {
+      spdlog::error("Failed to close output stream: {}", status.ToString());
+    }
+  }
+  closed_ = true;
+}
+
+} // namespace charmvz
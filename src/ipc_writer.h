@@ -0,0 +1,55 @@
+#pragma once
+#include "output_options.h"
+#include "table_writer.h"
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <memory>
+#include <string>
+
+namespace charmvz {
+
+enum class IpcFraming {
+  // The random-access file format: a footer indexes every batch, so it is
+  // only readable once closed.
+  File,
+  // The streaming format: each batch is readable as soon as it is written.
+  Stream,
+};
+
+// Writes a table in Arrow IPC. Each WriteBatch is one record batch, so a
+// builder's flush size is the reader's unit of access, as a row group is for
+// Parquet.
+//
+// As a file (Feather v2), uncompressed, it is laid out exactly as Arrow holds
+// it in memory, and a reader that mmaps it gets arrays backed by the page
+// cache with no decode at all. As a stream, every batch is flushed through to
+// the sink as it is written, so a reader on the other end of a pipe sees rows
+// at the pace the builders produce them.
+class IpcWriter : public TableWriter {
+public:
+  IpcWriter(std::shared_ptr<arrow::Schema> schema, const std::string &file_path,
+            IpcCompression compression = IpcCompression::None,
+            arrow::MemoryPool *pool = arrow::default_memory_pool());
+  IpcWriter(std::shared_ptr<arrow::Schema> schema,
+            std::shared_ptr<arrow::io::OutputStream> sink, IpcFraming framing,
+            IpcCompression compression = IpcCompression::None,
+            arrow::MemoryPool *pool = arrow::default_memory_pool());
+  ~IpcWriter() override;
+
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) override;
+  void Close() override;
+  [[nodiscard]] auto pool() const -> arrow::MemoryPool * override {
+    return pool_;
+  }
+
+private:
+  std::shared_ptr<arrow::Schema> schema_;
+  arrow::MemoryPool *pool_;
+  std::shared_ptr<arrow::io::OutputStream> out_stream_;
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer_;
+  IpcFraming framing_;
+  bool closed_ = false;
+};
+
+} // namespace charmvz
@@ -1,15 +1,31 @@
 #include "log_parser.h"
 #include "builders.h"
+#include "interval_index.h"
+#include "memory_pool.h"
+#include "output_writer.h"
 #include "parquet_writer.h"
 #include "schema.h"
+#include "spill.h"
+#include "timeline.h"
 #include "utils/log_entry.h"
 #include "zstr.hpp"
+#include <algorithm>
 #include <arrow/builder.h>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <iterator>
 #include <limits>
+#include <mutex>
+#include <optional>
+#include <queue>
 #include <regex>
+#include <set>
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 namespace charmvz {
 
@@ -42,6 +58,16 @@ auto is_chare_array(const StsData &sts_data, int32_t collection_id) -> bool {
   return chare_it != sts_data.chare_map.end() && chare_it->second.ndims >= 1;
 }
 
+// Reads the TOTAL_PAPI_EVENTS counter values that close a BEGIN_ or
+// END_PROCESSING record, however many the trace declares.
+void read_papi_values(std::istringstream &iss, const StsData &sts_data,
+                      LogEntry &e) {
+  e.papiValues.resize(
+      static_cast<size_t>(std::max(sts_data.total_papi_events, 0)));
+  for (auto &value : e.papiValues)
+    iss >> value;
+}
+
 // Reads a std::string as the Projections text pup-er writes it: a decimal
 // length, then exactly that many characters with no separator between them.
 // `toProjectionsFile::bytes` emits Tchar as "%c"
@@ -62,470 +88,1412 @@ auto read_pup_string(std::istringstream &iss) -> std::string {
 
 // Fills in the registered name of a user event, when the STS EVENT table
 // declares one. Applications may emit ids they never registered.
-void attach_user_event_name(const StsData &sts_data,
+void attach_user_event_name(const builders::NameDictionary &names,
                             UserEventOccurrence &occurrence) {
-  auto name_it = sts_data.user_event_map.find(occurrence.user_event_id);
-  if (name_it != sts_data.user_event_map.end()) {
-    occurrence.name = name_it->second.name;
+  if (auto code = names.code(occurrence.user_event_id)) {
+    occurrence.name_code = code->code;
     occurrence.has_name = true;
   }
 }
 
-} // namespace
+// A completed execution waiting for its turn in start order.
+struct PendingExecution {
+  LogEntry begin;
+  LogEntry end;
+  int64_t instance_id;
+};
 
-auto process_logs(const std::vector<std::string> &log_file_paths,
-                  const StsData &sts_data, const RcData &rc_data,
-                  const std::string &output_dir, int32_t step_event_id)
-    -> LogParserResult {
-  LogParserResult result;
+// Holds completed executions back until no execution that started earlier is
+// still open on the PE, then releases them in start order. A log writes an
+// execution's row at its END_PROCESSING, so a nested execution -- one that
+// begins and ends inside another -- comes out ahead of the one enclosing it.
+// Only a still-open execution can start before one already finished, so the
+// buffer holds the current nesting depth and no more. The exception is a BEGIN
+// whose END never arrives, which holds back everything after it until the end
+// of the file.
+class StartOrderBuffer {
+public:
+  void Open(uint64_t start_time) { open_starts_.insert(start_time); }
 
-  auto exec_schema = charmvz::schema::execution(sts_data.papi_event_names);
-  charmvz::ParquetWriter exec_writer(exec_schema,
-                                     output_dir + "/execution.parquet");
-  charmvz::ParquetWriter idle_writer(charmvz::schema::idle_interval(),
-                                     output_dir + "/idle_interval.parquet");
-  charmvz::ParquetWriter chare_writer(charmvz::schema::chare_instance(),
-                                      output_dir + "/chare_instance.parquet");
-  charmvz::ParquetWriter user_event_writer(charmvz::schema::user_event(),
-                                           output_dir + "/user_event.parquet");
-  charmvz::ParquetWriter user_stat_writer(charmvz::schema::user_stat(),
-                                          output_dir + "/user_stat.parquet");
-  charmvz::ParquetWriter memory_sample_writer(
-      charmvz::schema::memory_sample(), output_dir + "/memory_sample.parquet");
-
-  builders::ExecutionBuilder exec_builder(exec_writer, exec_schema,
-                                          sts_data.total_papi_events);
-  builders::IdleIntervalBuilder idle_builder(idle_writer);
-  builders::ChareInstanceBuilder chare_builder(chare_writer);
-  builders::UserEventBuilder user_event_builder(user_event_writer);
-  builders::UserStatBuilder user_stat_builder(user_stat_writer);
-  builders::MemorySampleBuilder memory_sample_builder(memory_sample_writer);
+  void Close(uint64_t start_time) {
+    auto it = open_starts_.find(start_time);
+    if (it != open_starts_.end())
+      open_starts_.erase(it);
+  }
 
-  const int64_t global_start_us = rc_data.global_start_time_us;
+  void Push(PendingExecution execution) {
+    pending_.push(std::move(execution));
+  }
 
-  for (const auto &log_path : log_file_paths) {
-    spdlog::info("Processing log: {}", log_path);
-
-    std::string filename = std::filesystem::path(log_path).filename().string();
-    std::smatch match;
-    std::regex log_regex(R"(.*\.(\d+)\.log(\.gz)?$)");
-    int32_t current_pe_id = -1;
-    if (std::regex_match(filename, match, log_regex)) {
-      current_pe_id = std::stoi(match[1]);
-    } else {
-      // Every row this pipeline writes is keyed on the PE that owns the log
-      // file, so a file whose name yields no PE cannot be attributed at all.
-      // Parsing it anyway would write rows on a PE that does not exist, which
-      // no downstream join rejects.
-      spdlog::error("Skipping {}: cannot determine the PE from its name",
-                    filename);
-      continue;
+  // Emits every pending execution that no open one can precede.
+  template <class Emit> void Release(Emit &&emit) {
+    while (!pending_.empty() &&
+           (open_starts_.empty() ||
+            pending_.top().begin.itime <= *open_starts_.begin())) {
+      emit(pending_.top());
+      pending_.pop();
     }
+  }
 
-    zstr::ifstream log_stream(log_path);
-    std::string line;
-    std::getline(log_stream, line);
-
-    LogEntry last_begin_idle{};
-    std::unordered_map<int32_t, LogEntry> open_processing_entries;
-
-    // USER_EVENT_PAIR writes its begin and its end as two records sharing one
-    // `event` serial (trace-projections.C:1093-1096), so they pair on that.
-    std::unordered_map<int32_t, LogEntry> open_event_pairs;
-    // BEGIN_/END_USER_EVENT_PAIR consume a fresh serial each
-    // (trace-projections.C:1102,1109), so they cannot pair on `event`. They
-    // pair on (user event id, nestedID), which is precisely what nestedID
-    // exists for; the vector is a stack so identically-keyed brackets can nest.
-    std::unordered_map<std::tuple<int32_t, int32_t>, std::vector<LogEntry>,
-                       TupleHash>
-        open_brackets;
-
-    // Emits one row for a bracketed user event, and records a timestep
-    // boundary when the bracket is the configured step-boundary event.
-    auto emit_bracket = [&](int32_t record_type, int32_t user_event_id,
-                            int32_t event, int32_t nested_id, int64_t start_us,
-                            int64_t end_us, bool has_end) {
-      UserEventOccurrence occurrence{};
-      occurrence.pe_id = current_pe_id;
-      occurrence.record_type = record_type;
-      occurrence.user_event_id = user_event_id;
-      occurrence.has_user_event_id = true;
-      occurrence.event = event;
-      occurrence.has_event = true;
-      occurrence.nested_id = nested_id;
-      occurrence.has_nested_id = true;
-      occurrence.start_time_us = start_us;
-      occurrence.end_time_us = end_us;
-      occurrence.has_end_time = has_end;
-      attach_user_event_name(sts_data, occurrence);
-      user_event_builder.Append(occurrence);
-
-      if (step_event_id != NO_STEP_EVENT && user_event_id == step_event_id) {
-        StepBoundaryRecord step{};
-        step.step_id = nested_id;
-        step.pe_id = current_pe_id;
-        step.start_time_us = start_us;
-        step.end_time_us = end_us;
-        step.has_end_time = has_end;
-        result.step_boundaries.push_back(step);
-      }
-    };
-
-    while (std::getline(log_stream, line)) {
-      if (line.empty())
-        continue;
-      std::istringstream iss(line);
-      int token = 0;
-      iss >> token;
-      LogType type = static_cast<LogType>(token);
-
-      LogEntry e{};
-      e.type = type;
-
-      switch (type) {
-      case LogType::CREATION:
-      case LogType::CREATION_BCAST:
-      case LogType::CREATION_MULTICAST: {
-        iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
-            e.irecvtime;
-        if (type == LogType::CREATION_MULTICAST) {
-          iss >> e.numpes;
-          e.pes.resize(e.numpes);
-          for (int i = 0; i < e.numpes; i++)
-            iss >> e.pes[i];
-        } else if (type == LogType::CREATION_BCAST) {
-          iss >> e.numpes;
-        }
-        CreationRecord cr;
-        cr.ep_id = e.eIdx;
-        cr.msg_idx = e.mIdx;
-        cr.msg_len = e.msglen;
-        cr.send_time_us = e.itime;
-        cr.enqueue_time_us = e.irecvtime;
-        cr.is_broadcast = (type == LogType::CREATION_BCAST);
-        cr.broadcast_fanout = (type == LogType::CREATION_BCAST) ? e.numpes : 1;
-        cr.src_pe = current_pe_id;
-        if (type == LogType::CREATION_MULTICAST)
-          cr.dst_pes = e.pes;
-
-        result.creation_map[std::make_tuple(current_pe_id, e.event)] = cr;
-        break;
-      }
-      case LogType::BEGIN_PROCESSING: {
-        iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
-            e.irecvtime;
-        const int32_t index_arity = chare_index_arity(sts_data, e.eIdx);
-        for (int32_t i = 0; i < index_arity; ++i) {
-          int32_t index_value = 0;
-          iss >> index_value;
-          if (i < static_cast<int32_t>(CHARE_INDEX_SLOTS)) {
-            e.id[i] = index_value;
-          }
-        }
-        iss >> e.icputime;
-        for (int32_t i = 0; i < sts_data.total_papi_events; ++i) {
-          uint64_t papi_value = 0;
-          iss >> papi_value;
-          if (i < static_cast<int32_t>(NUMPAPIEVENTS)) {
-            e.papiValues[i] = papi_value;
-          }
-        }
-        open_processing_entries[e.event] = e;
-
-        BeginProcessingRecord bp;
-        bp.dst_pe = current_pe_id;
-        bp.recv_time_us = e.irecvtime;
-        bp.exec_start_time_us = e.itime;
-        result.begin_processing_map[std::make_tuple(e.pe, e.event)] = bp;
-
-        int32_t cid = sts_data.entries.empty()
-                          ? 0
-                          : sts_data.entries.front().collection_id;
-        auto ep_it = sts_data.ep_map.find(e.eIdx);
-        if (ep_it != sts_data.ep_map.end())
-          cid = ep_it->second.collection_id;
-
-        auto chare_tup = std::make_tuple(cid, e.id[0], e.id[1], e.id[2],
-                                         e.id[3], e.id[4], e.id[5]);
-        if (result.chare_instances.find(chare_tup) ==
-            result.chare_instances.end()) {
-          ChareInstanceRecord inst;
-          inst.instance_id = result.chare_instances.size() + 1;
-          inst.collection_id = cid;
-          inst.index_0 = e.id[0];
-          inst.index_1 = e.id[1];
-          inst.index_2 = e.id[2];
-          inst.index_3 = e.id[3];
-          inst.index_4 = e.id[4];
-          inst.index_5 = e.id[5];
-          result.chare_instances[chare_tup] = inst;
-          chare_builder.Append(inst);
-        }
-        break;
-      }
-      case LogType::END_PROCESSING: {
-        iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
-            e.icputime;
-        for (int32_t i = 0; i < sts_data.total_papi_events; ++i) {
-          uint64_t papi_value = 0;
-          iss >> papi_value;
-          if (i < static_cast<int32_t>(NUMPAPIEVENTS)) {
-            e.papiValues[i] = papi_value;
-          }
-        }
+  // End of the log: whatever is still open never closed, so nothing else can
+  // arrive ahead of what is pending.
+  template <class Emit> void Drain(Emit &&emit) {
+    open_starts_.clear();
+    Release(emit);
+  }
 
-        auto begin_it = open_processing_entries.find(e.event);
-        if (begin_it == open_processing_entries.end()) {
-          spdlog::warn("Missing BEGIN_PROCESSING for event {} on PE {}",
-                       e.event, current_pe_id);
-          break;
-        }
+private:
+  struct LaterStart {
+    auto operator()(const PendingExecution &a,
+                    const PendingExecution &b) const -> bool {
+      return a.begin.itime > b.begin.itime;
+    }
+  };
 
-        const LogEntry &begin = begin_it->second;
-        int32_t cid = 0;
-        auto ep_it = sts_data.ep_map.find(begin.eIdx);
-        if (ep_it != sts_data.ep_map.end())
-          cid = ep_it->second.collection_id;
-
-        auto chare_tup =
-            std::make_tuple(cid, begin.id[0], begin.id[1], begin.id[2],
-                            begin.id[3], begin.id[4], begin.id[5]);
-        int64_t inst_id = -1;
-        auto inst_it = result.chare_instances.find(chare_tup);
-        if (inst_it != result.chare_instances.end())
-          inst_id = inst_it->second.instance_id;
-
-        exec_builder.Append(begin, e, current_pe_id,
-                            rc_data.global_start_time_us, inst_id);
-
-        // Retain this execution's location so Stage 3 can detect migrations as
-        // changes of PE. Only chare arrays migrate, so skip everything else.
-        if (inst_id >= 0 && is_chare_array(sts_data, cid)) {
-          InstanceLocationRecord loc;
-          loc.instance_id = inst_id;
-          loc.collection_id = cid;
-          loc.pe_id = current_pe_id;
-          loc.start_time_us =
-              static_cast<int64_t>(begin.itime) - rc_data.global_start_time_us;
-          loc.end_time_us =
-              static_cast<int64_t>(e.itime) - rc_data.global_start_time_us;
-          result.instance_locations.push_back(loc);
-        }
+  std::multiset<uint64_t> open_starts_;
+  std::priority_queue<PendingExecution, std::vector<PendingExecution>,
+                      LaterStart>
+      pending_;
+};
 
-        open_processing_entries.erase(begin_it);
-        break;
+// One PE's timesteps in the order its log opens them, so each row can be
+// given, as it is written, the step whose interval on the PE contains its
+// start. A step is open from its BEGIN bracket to its END, and the log is in
+// time order, so a row never starts inside a step the tracker has not seen.
+// Rows are looked up by start time rather than tagged at their first record,
+// which keeps executions right when --sorted holds them back.
+class StepTracker {
+public:
+  void Open(int32_t step_id, int64_t start_us) {
+    steps_.push_back({start_us, kOpen, step_id});
+  }
+
+  void Close(int32_t step_id, int64_t end_us) {
+    for (auto it = steps_.rbegin(); it != steps_.rend(); ++it) {
+      if (it->step_id == step_id && it->end_us == kOpen) {
+        it->end_us = end_us;
+        return;
       }
-      case LogType::BEGIN_IDLE: {
-        iss >> e.itime >> e.pe;
-        last_begin_idle = e;
-        break;
+    }
+  }
+
+  [[nodiscard]] auto At(int64_t time_us) const -> std::optional<int32_t> {
+    const auto after = std::upper_bound(
+        steps_.begin(), steps_.end(), time_us,
+        [](int64_t t, const Step &step) { return t < step.start_us; });
+    if (after == steps_.begin() || time_us >= std::prev(after)->end_us)
+      return std::nullopt;
+    return std::prev(after)->step_id;
+  }
+
+private:
+  static constexpr int64_t kOpen = std::numeric_limits<int64_t>::max();
+  struct Step {
+    int64_t start_us;
+    int64_t end_us;
+    int32_t step_id;
+  };
+  std::vector<Step> steps_;
+};
+
+// The estimated size of one chare_instances entry, as MapBudget estimates
+// its maps'.
+constexpr int64_t kInstanceNodeBytes =
+    sizeof(decltype(LogParserResult::chare_instances)::value_type) +
+    2 * sizeof(void *);
+
+// Registers the instance keyed `key` in `instances` on first sight, and
+// returns its id. Each shard registers the instances it meets in its own map,
+// which are merged once the shards are done; the ids come from the keys, so
+// an instance met by several shards gets one id without their agreeing on it.
+// Counted against --max-memory in `pool` but never spilled: the chare_instance
+// table is written from the merged map.
+auto intern_instance(decltype(LogParserResult::chare_instances) &instances,
+                     TablePool &pool, const ChareInstanceKey &key) -> int64_t {
+  const auto [it, inserted] = instances.try_emplace(key);
+  ChareInstanceRecord &inst = it->second;
+  if (!inserted)
+    return inst.instance_id;
+  inst.instance_id = make_instance_id(key);
+  inst.collection_id = std::get<0>(key);
+  inst.index_0 = std::get<1>(key);
+  inst.index_1 = std::get<2>(key);
+  inst.index_2 = std::get<3>(key);
+  inst.index_3 = std::get<4>(key);
+  inst.index_4 = std::get<5>(key);
+  inst.index_5 = std::get<6>(key);
+  pool.Charge(kInstanceNodeBytes);
+  return inst.instance_id;
+}
+
+// The tables every PE's log feeds but that stay one file in every layout and
+// are written as they are fed: user_stat and memory_sample. When logs are
+// parsed concurrently, all shards reach them through here and every access
+// takes the lock.
+class SharedTables {
+public:
+  SharedTables(builders::UserStatBuilder &user_stat_builder,
+               builders::MemorySampleBuilder &memory_sample_builder)
+      : user_stat_builder_(user_stat_builder),
+        memory_sample_builder_(memory_sample_builder) {}
+
+  void Append(const UserStatSample &sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    user_stat_builder_.Append(sample);
+  }
+
+  void Append(const MemorySample &sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_sample_builder_.Append(sample);
+  }
+
+  void Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    user_stat_builder_.Flush();
+    memory_sample_builder_.Flush();
+  }
+
+private:
+  std::mutex mutex_;
+  builders::UserStatBuilder &user_stat_builder_;
+  builders::MemorySampleBuilder &memory_sample_builder_;
+};
+
+// The tables whose rows a shard owns outright: the whole output when it is
+// not partitioned, one pe_bucket when it is.
+struct ShardBuilders {
+  builders::ExecutionBuilder &exec;
+  builders::IdleIntervalBuilder &idle;
+  builders::UserEventBuilder &user_event;
+  // Null unless OutputOptions::papi_samples asked for the table.
+  builders::PapiSampleBuilder *papi_sample;
+  // Null unless OutputOptions::time_bin_us asked for the table.
+  builders::TimeProfileBuilder *time_profile;
+  // One per timeline level; empty unless OutputOptions::timeline_levels
+  // asked for them.
+  std::vector<TimelineBuilder *> timeline;
+  // Null unless OutputOptions::interval_index asked for the sidecars.
+  IntervalIndexBuilder *exec_index;
+  IntervalIndexBuilder *idle_index;
+  // Written once all shards are done, as ep_pe_summary.
+  builders::EpPeSummary &summary;
+};
+
+// What every log's parse reads and none modifies, plus the shared tables.
+struct ParseContext {
+  const StsData &sts_data;
+  const RcData &rc_data;
+  int32_t step_event_id;
+  const OutputOptions &options;
+  SharedTables &shared;
+  // The name dictionaries of user_event and user_stat, and of papi_sample's
+  // counter column.
+  const builders::NameDictionary &user_event_names;
+  const builders::NameDictionary &user_stat_names;
+  const builders::NameDictionary &papi_counter_names;
+  // Where Stage 3's inputs go when the run nears --max-memory; null when no
+  // budget was given.
+  SpillStore *spill;
+};
+
+// Counts one shard's Stage 3 inputs against --max-memory, each map in a pool
+// of its own, and moves the largest to the spill store when the run passes
+// the spill threshold. The sizes are estimates: an entry's payload and two
+// pointers of hash-node overhead, plus a multicast's destination list, or an
+// arena slot for each further receiver of a message.
+// Charges are added up locally and handed to the pools every kCheckEntries
+// entries, so the shards do not contend on the counters per record.
+class MapBudget {
+public:
+  MapBudget(LogParserResult &result, SpillStore *spill)
+      : result_(result), spill_(spill) {}
+  MapBudget(const MapBudget &) = delete;
+  auto operator=(const MapBudget &) -> MapBudget & = delete;
+  ~MapBudget() { ChargePending(); }
+
+  void AddCreation(const CreationRecord &cr) {
+    Note(creations_, kNodeBytes<CreationMap> +
+                         static_cast<int64_t>(cr.dst_pes.size() *
+                                              sizeof(int32_t)));
+  }
+  // `bytes` is what BeginProcessingMap::Add reported; a repeat adds none.
+  void AddBegin(int64_t bytes) {
+    if (bytes > 0)
+      Note(begins_, bytes);
+  }
+  void AddLocation() {
+    Note(locations_, sizeof(InstanceLocationRecord));
+  }
+
+  // Hands what is pending to the pools and spills if the run is over the
+  // threshold.
+  void Settle() {
+    ChargePending();
+    if (spill_ != nullptr && memory_accounting().over_spill_threshold())
+      SpillLargest();
+  }
+
+private:
+  static constexpr int64_t kCheckEntries = 4096;
+  // Spilling a map under 1/kMinSpillFraction of the budget frees too little
+  // to be worth the write; the pressure is then the builders', which flush.
+  static constexpr int64_t kMinSpillFraction = 64;
+  template <class Map>
+  static constexpr int64_t kNodeBytes =
+      sizeof(typename Map::value_type) + 2 * sizeof(void *);
+
+  struct Tracked {
+    TablePool *pool;
+    int64_t charged = 0;
+    int64_t pending = 0;
+  };
+
+  void ChargePending() {
+    for (Tracked *tracked : {&creations_, &begins_, &locations_}) {
+      tracked->pool->Charge(tracked->pending);
+      tracked->charged += tracked->pending;
+      tracked->pending = 0;
+    }
+  }
+
+  void Note(Tracked &tracked, int64_t bytes) {
+    tracked.pending += bytes;
+    if (++entries_ % kCheckEntries == 0)
+      Settle();
+  }
+
+  void SpillLargest() {
+    Tracked *largest = std::max(
+        {&creations_, &begins_, &locations_},
+        [](const Tracked *a, const Tracked *b) {
+          return a->charged < b->charged;
+        });
+    if (largest->charged < memory_accounting().budget() / kMinSpillFraction)
+      return;
+    const int64_t in_use = memory_accounting().bytes_allocated();
+    int64_t written = 0;
+    if (largest == &creations_) {
+      written = spill_->Spill(result_.creation_map);
+      CreationMap().swap(result_.creation_map);
+    } else if (largest == &begins_) {
+      written = spill_->Spill(result_.begin_processing_map);
+      result_.begin_processing_map = BeginProcessingMap();
+    } else {
+      written = spill_->Spill(result_.instance_locations);
+      std::vector<InstanceLocationRecord>().swap(result_.instance_locations);
+    }
+    spdlog::info("Spilled {} ({} estimated, {} on disk) to {}: {} in use "
+                 "is past 9/10 of the {} budget",
+                 largest->pool->table(), format_bytes(largest->charged),
+                 format_bytes(written), spill_->dir().string(),
+                 format_bytes(in_use),
+                 format_bytes(memory_accounting().budget()));
+    largest->pool->Charge(-largest->charged);
+    largest->pool->NoteSpill();
+    largest->charged = 0;
+  }
+
+  LogParserResult &result_;
+  SpillStore *spill_;
+  Tracked creations_{memory_accounting().pool("creation_map")};
+  Tracked begins_{memory_accounting().pool("begin_processing_map")};
+  Tracked locations_{memory_accounting().pool("instance_locations")};
+  int64_t entries_ = 0;
+};
+
+// Parses one PE's log, appending its rows to `shard` and what Stage 3 needs to
+// `result`, which `budget` counts.
+void parse_log(const std::string &log_path, int32_t current_pe_id,
+               const ParseContext &ctx, ShardBuilders &shard,
+               LogParserResult &result, MapBudget &budget) {
+  const StsData &sts_data = ctx.sts_data;
+  const RcData &rc_data = ctx.rc_data;
+  const OutputOptions &options = ctx.options;
+  const int32_t step_event_id = ctx.step_event_id;
+  const int64_t global_start_us = rc_data.global_start_time_us;
+
+  zstr::ifstream log_stream(log_path);
+  std::string line;
+  std::getline(log_stream, line);
+
+  LogEntry last_begin_idle{};
+  // A BEGIN_PROCESSING not yet ended, with the collection and instance it
+  // ran on, so its END and its sends need not find them again.
+  struct OpenProcessing {
+    LogEntry begin;
+    int32_t collection_id;
+    int64_t instance_id;
+  };
+  std::unordered_map<int32_t, OpenProcessing> open_processing_entries;
+  TablePool &instance_pool = *memory_accounting().pool("chare_instances");
+  // The same executions in the order they began, so the innermost, the one
+  // a send comes from, is last. Map nodes do not move, so the pointers hold
+  // until their execution ends.
+  std::vector<const OpenProcessing *> open_stack;
+  auto close_open = [&](int32_t event) {
+    for (auto it = open_stack.rbegin(); it != open_stack.rend(); ++it) {
+      if ((*it)->begin.event == event) {
+        open_stack.erase(std::next(it).base());
+        return;
       }
-      case LogType::END_IDLE: {
-        iss >> e.itime >> e.pe;
-        idle_builder.Append(last_begin_idle, e, rc_data.global_start_time_us);
-        break;
+    }
+  };
+  // The collection a BEGIN_PROCESSING's entry method belongs to; the first
+  // registered one when the .sts does not list the entry method.
+  auto collection_of = [&](const LogEntry &begin) {
+    auto ep_it = sts_data.ep_map.find(begin.eIdx);
+    if (ep_it != sts_data.ep_map.end())
+      return ep_it->second.collection_id;
+    return sts_data.entries.empty() ? 0
+                                    : sts_data.entries.front().collection_id;
+  };
+  // The key of the chare instance a BEGIN_PROCESSING names.
+  auto instance_key = [&](const LogEntry &begin) {
+    return std::make_tuple(collection_of(begin), begin.id[0], begin.id[1],
+                           begin.id[2], begin.id[3], begin.id[4],
+                           begin.id[5]);
+  };
+  StartOrderBuffer start_order;
+  // The PE's time bins and timeline pyramid, written once its log is done.
+  std::optional<builders::TimeBinner> time_bins;
+  if (shard.time_profile != nullptr)
+    time_bins.emplace(options.time_bin_us);
+  std::optional<TimelinePyramid> pyramid;
+  if (!shard.timeline.empty())
+    pyramid.emplace(options.timeline_levels, options.timeline_pixel_us);
+  // The PE's execution and idle_interval rows, indexed once its log is done.
+  std::optional<IntervalIndexer> exec_intervals;
+  std::optional<IntervalIndexer> idle_intervals;
+  if (shard.exec_index != nullptr) {
+    exec_intervals.emplace();
+    idle_intervals.emplace();
+  }
+  StepTracker steps;
+  auto is_step_event = [&](int32_t user_event_id) {
+    return step_event_id != NO_STEP_EVENT && user_event_id == step_event_id;
+  };
+  // Writes one completed execution, and its counters one row apiece when
+  // papi_sample is being written, and adds it to its (PE, EP) totals, time
+  // bins, timeline, interval index and graph spans.
+  auto write_execution = [&](const LogEntry &begin, const LogEntry &end,
+                             int64_t instance_id) {
+    const int64_t start_us = static_cast<int64_t>(begin.itime) -
+                             global_start_us;
+    const int64_t end_us = static_cast<int64_t>(end.itime) - global_start_us;
+    const builders::ExecutionRecord record{
+        begin, end, current_pe_id, global_start_us, instance_id,
+        steps.At(start_us)};
+    const int64_t row_offset = shard.exec.total_rows();
+    shard.exec.Append(record);
+    shard.summary.Add(record);
+    if (exec_intervals)
+      exec_intervals->Add(start_us, end_us, row_offset);
+    if (options.critical_path || options.execution_graph) {
+      result.executions.push_back(
+          {current_pe_id, begin.pe, begin.event, begin.eIdx, start_us, end_us,
+           static_cast<int64_t>(begin.irecvtime) - global_start_us});
+    }
+    if (time_bins)
+      time_bins->AddBusy(begin.eIdx, start_us, end_us);
+    if (pyramid)
+      pyramid->Add(begin.eIdx, start_us, end_us);
+    if (shard.papi_sample == nullptr)
+      return;
+    for (size_t i = 0; i < begin.papiValues.size(); ++i) {
+      shard.papi_sample->Append({current_pe_id, begin.event,
+                                 static_cast<int32_t>(i),
+                                 !sts_data.papi_event_names[i].empty(),
+                                 begin.papiValues[i], end.papiValues[i]});
+    }
+  };
+  auto append_execution = [&](const PendingExecution &execution) {
+    write_execution(execution.begin, execution.end, execution.instance_id);
+  };
+
+  // USER_EVENT_PAIR writes its begin and its end as two records sharing one
+  // `event` serial (trace-projections.C:1093-1096), so they pair on that.
+  std::unordered_map<int32_t, LogEntry> open_event_pairs;
+  // BEGIN_/END_USER_EVENT_PAIR consume a fresh serial each
+  // (trace-projections.C:1102,1109), so they cannot pair on `event`. They
+  // pair on (user event id, nestedID), which is precisely what nestedID
+  // exists for; the vector is a stack so identically-keyed brackets can nest.
+  std::unordered_map<std::tuple<int32_t, int32_t>, std::vector<LogEntry>,
+                     TupleHash>
+      open_brackets;
+
+  // Emits one row for a bracketed user event, and records a timestep
+  // boundary when the bracket is the configured step-boundary event.
+  auto emit_bracket = [&](int32_t record_type, int32_t user_event_id,
+                          int32_t event, int32_t nested_id, int64_t start_us,
+                          int64_t end_us, bool has_end) {
+    UserEventOccurrence occurrence{};
+    occurrence.pe_id = current_pe_id;
+    occurrence.record_type = record_type;
+    occurrence.user_event_id = user_event_id;
+    occurrence.has_user_event_id = true;
+    occurrence.event = event;
+    occurrence.has_event = true;
+    occurrence.nested_id = nested_id;
+    occurrence.has_nested_id = true;
+    occurrence.start_time_us = start_us;
+    occurrence.end_time_us = end_us;
+    occurrence.has_end_time = has_end;
+    attach_user_event_name(ctx.user_event_names, occurrence);
+    shard.user_event.Append(occurrence);
+
+    if (is_step_event(user_event_id)) {
+      if (has_end)
+        steps.Close(nested_id, end_us);
+      StepBoundaryRecord step{};
+      step.step_id = nested_id;
+      step.pe_id = current_pe_id;
+      step.start_time_us = start_us;
+      step.end_time_us = end_us;
+      step.has_end_time = has_end;
+      result.step_boundaries.push_back(step);
+    }
+  };
+
+  while (std::getline(log_stream, line)) {
+    if (line.empty())
+      continue;
+    std::istringstream iss(line);
+    int token = 0;
+    iss >> token;
+    LogType type = static_cast<LogType>(token);
+
+    LogEntry e{};
+    e.type = type;
+
+    switch (type) {
+    case LogType::CREATION:
+    case LogType::CREATION_BCAST:
+    case LogType::CREATION_MULTICAST: {
+      iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
+          e.irecvtime;
+      if (type == LogType::CREATION_MULTICAST) {
+        iss >> e.numpes;
+        e.pes.resize(e.numpes);
+        for (int i = 0; i < e.numpes; i++)
+          iss >> e.pes[i];
+      } else if (type == LogType::CREATION_BCAST) {
+        iss >> e.numpes;
       }
-      // BEGIN_PACK / END_PACK / BEGIN_UNPACK / END_UNPACK are deliberately not
-      // collected. They are emitted by CkPackMessage() / CkUnpackMessage()
-      // around ordinary message serialisation, not around chare migration, so
-      // they cannot be used to reconstruct MigrationEpisode. See the comment on
-      // schema::migration_episode().
-      case LogType::BEGIN_COMPUTATION: {
-        iss >> e.itime;
-        ProcessingElementRecord per;
-        per.pe_id = current_pe_id;
-        per.total_pes = sts_data.total_pes;
-        per.begin_time_us = e.itime;
-        per.global_start_us = rc_data.global_start_time_us;
-        result.pes.push_back(per);
-        break;
+      CreationRecord cr;
+      cr.ep_id = e.eIdx;
+      cr.msg_idx = e.mIdx;
+      cr.msg_len = e.msglen;
+      cr.send_time_us = e.itime;
+      cr.enqueue_time_us = e.irecvtime;
+      cr.is_broadcast = (type == LogType::CREATION_BCAST);
+      cr.broadcast_fanout = (type == LogType::CREATION_BCAST) ? e.numpes : 1;
+      cr.src_pe = current_pe_id;
+      cr.step_id =
+          steps.At(static_cast<int64_t>(e.itime) - global_start_us);
+      if (type == LogType::CREATION_MULTICAST)
+        cr.dst_pes = e.pes;
+      if (!open_stack.empty()) {
+        const OpenProcessing &running = *open_stack.back();
+        cr.sender = SenderRecord{running.begin.event, running.begin.eIdx,
+                                 running.instance_id};
       }
-      case LogType::END_COMPUTATION: {
-        iss >> e.itime;
-        for (auto &per : result.pes) {
-          if (per.pe_id == current_pe_id)
-            per.end_time_us = e.itime;
+
+      const auto [created, inserted] = result.creation_map.insert_or_assign(
+          std::make_tuple(current_pe_id, e.event), std::move(cr));
+      if (inserted)
+        budget.AddCreation(created->second);
+      break;
+    }
+    case LogType::BEGIN_PROCESSING: {
+      iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
+          e.irecvtime;
+      const int32_t index_arity = chare_index_arity(sts_data, e.eIdx);
+      for (int32_t i = 0; i < index_arity; ++i) {
+        int32_t index_value = 0;
+        iss >> index_value;
+        if (i < static_cast<int32_t>(CHARE_INDEX_SLOTS)) {
+          e.id[i] = index_value;
         }
-        break;
-      }
-      case LogType::USER_EVENT: {
-        iss >> e.mIdx >> e.itime >> e.event >> e.pe;
-        UserEventOccurrence occurrence{};
-        occurrence.pe_id = current_pe_id;
-        occurrence.record_type = static_cast<int32_t>(type);
-        occurrence.user_event_id = e.mIdx;
-        occurrence.has_user_event_id = true;
-        occurrence.event = e.event;
-        occurrence.has_event = true;
-        occurrence.start_time_us =
-            static_cast<int64_t>(e.itime) - global_start_us;
-        attach_user_event_name(sts_data, occurrence);
-        user_event_builder.Append(occurrence);
-        break;
       }
-      case LogType::USER_SUPPLIED: {
-        iss >> e.userSuppliedData >> e.itime;
-        UserEventOccurrence occurrence{};
-        occurrence.pe_id = current_pe_id;
-        occurrence.record_type = static_cast<int32_t>(type);
-        occurrence.start_time_us =
-            static_cast<int64_t>(e.itime) - global_start_us;
-        occurrence.user_supplied_int = e.userSuppliedData;
-        occurrence.has_user_supplied_int = true;
-        user_event_builder.Append(occurrence);
-        break;
-      }
-      case LogType::USER_SUPPLIED_NOTE: {
-        iss >> e.itime;
-        e.userSuppliedNote = read_pup_string(iss);
-        UserEventOccurrence occurrence{};
-        occurrence.pe_id = current_pe_id;
-        occurrence.record_type = static_cast<int32_t>(type);
-        occurrence.start_time_us =
-            static_cast<int64_t>(e.itime) - global_start_us;
-        occurrence.note = e.userSuppliedNote;
-        occurrence.has_note = true;
-        user_event_builder.Append(occurrence);
-        break;
+      iss >> e.icputime;
+      read_papi_values(iss, sts_data, e);
+      auto [open_it, opened] = open_processing_entries.try_emplace(e.event);
+      if (options.sorted) {
+        if (!opened) {
+          start_order.Close(open_it->second.begin.itime);
+        }
+        start_order.Open(e.itime);
       }
-      case LogType::USER_SUPPLIED_BRACKETED_NOTE: {
-        iss >> e.itime >> e.iEndTime >> e.event;
-        e.userSuppliedNote = read_pup_string(iss);
-        UserEventOccurrence occurrence{};
-        occurrence.pe_id = current_pe_id;
-        occurrence.record_type = static_cast<int32_t>(type);
-        occurrence.event = e.event;
-        occurrence.has_event = true;
-        occurrence.start_time_us =
-            static_cast<int64_t>(e.itime) - global_start_us;
-        occurrence.end_time_us =
-            static_cast<int64_t>(e.iEndTime) - global_start_us;
-        occurrence.has_end_time = true;
-        occurrence.note = e.userSuppliedNote;
-        occurrence.has_note = true;
-        user_event_builder.Append(occurrence);
+      if (!opened)
+        close_open(e.event);
+      const ChareInstanceKey key = instance_key(e);
+      open_it->second = {e, std::get<0>(key),
+                         intern_instance(result.chare_instances,
+                                         instance_pool, key)};
+      open_stack.push_back(&open_it->second);
+
+      BeginProcessingRecord bp;
+      bp.dst_pe = current_pe_id;
+      bp.recv_time_us = e.irecvtime;
+      bp.exec_start_time_us = e.itime;
+      budget.AddBegin(result.begin_processing_map.Add(
+          std::make_tuple(e.pe, e.event), bp));
+      break;
+    }
+    case LogType::END_PROCESSING: {
+      iss >> e.mIdx >> e.eIdx >> e.itime >> e.event >> e.pe >> e.msglen >>
+          e.icputime;
+      read_papi_values(iss, sts_data, e);
+
+      auto begin_it = open_processing_entries.find(e.event);
+      if (begin_it == open_processing_entries.end()) {
+        spdlog::warn("Missing BEGIN_PROCESSING for event {} on PE {}",
+                     e.event, current_pe_id);
         break;
       }
-      case LogType::USER_EVENT_PAIR: {
-        // The record's own `pe` field is meaningless for the bracketed forms
-        // -- their LogEntry constructor never assigns it, so it is 0 on every
-        // PE. Attribution uses the PE the log file belongs to.
-        iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
-        auto open_it = open_event_pairs.find(e.event);
-        if (open_it == open_event_pairs.end()) {
-          open_event_pairs[e.event] = e;
-          break;
-        }
-        const LogEntry &begin = open_it->second;
-        emit_bracket(static_cast<int32_t>(type), begin.mIdx, begin.event,
-                     begin.nestedID,
-                     static_cast<int64_t>(begin.itime) - global_start_us,
-                     static_cast<int64_t>(e.itime) - global_start_us, true);
-        open_event_pairs.erase(open_it);
-        break;
+
+      const LogEntry &begin = begin_it->second.begin;
+      const int32_t cid = begin_it->second.collection_id;
+      const int64_t inst_id = begin_it->second.instance_id;
+
+      if (options.sorted) {
+        start_order.Close(begin.itime);
+        start_order.Push(PendingExecution{begin, e, inst_id});
+        start_order.Release(append_execution);
+      } else {
+        write_execution(begin, e, inst_id);
       }
-      case LogType::BEGIN_USER_EVENT_PAIR: {
-        iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
-        open_brackets[std::make_tuple(static_cast<int32_t>(e.mIdx), e.nestedID)]
-            .push_back(e);
-        break;
+
+      // Retain this execution's location so Stage 3 can detect migrations as
+      // changes of PE. Only chare arrays migrate, so skip everything else.
+      if (inst_id >= 0 && is_chare_array(sts_data, cid)) {
+        InstanceLocationRecord loc;
+        loc.instance_id = inst_id;
+        loc.collection_id = cid;
+        loc.pe_id = current_pe_id;
+        loc.start_time_us =
+            static_cast<int64_t>(begin.itime) - rc_data.global_start_time_us;
+        loc.end_time_us =
+            static_cast<int64_t>(e.itime) - rc_data.global_start_time_us;
+        result.instance_locations.push_back(loc);
+        budget.AddLocation();
       }
-      case LogType::END_USER_EVENT_PAIR: {
-        iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
-        auto key = std::make_tuple(static_cast<int32_t>(e.mIdx), e.nestedID);
-        auto open_it = open_brackets.find(key);
-        if (open_it == open_brackets.end() || open_it->second.empty()) {
-          // An END with no BEGIN: tracing was switched on mid-bracket, or the
-          // application is unbalanced. Keep it as a zero-width occurrence
-          // rather than silently dropping the evidence.
-          spdlog::warn("END_USER_EVENT_PAIR with no open bracket for user "
-                       "event {} (nestedID {}) on PE {}",
-                       e.mIdx, e.nestedID, current_pe_id);
-          emit_bracket(static_cast<int32_t>(type), e.mIdx, e.event, e.nestedID,
-                       static_cast<int64_t>(e.itime) - global_start_us, 0,
-                       false);
-          break;
-        }
-        const LogEntry begin = open_it->second.back();
-        open_it->second.pop_back();
-        emit_bracket(static_cast<int32_t>(LogType::BEGIN_USER_EVENT_PAIR),
-                     begin.mIdx, begin.event, begin.nestedID,
-                     static_cast<int64_t>(begin.itime) - global_start_us,
-                     static_cast<int64_t>(e.itime) - global_start_us, true);
-        break;
+
+      close_open(e.event);
+      open_processing_entries.erase(begin_it);
+      break;
+    }
+    case LogType::BEGIN_IDLE: {
+      iss >> e.itime >> e.pe;
+      last_begin_idle = e;
+      break;
+    }
+    case LogType::END_IDLE: {
+      iss >> e.itime >> e.pe;
+      const int64_t start_us =
+          static_cast<int64_t>(last_begin_idle.itime) - global_start_us;
+      const int64_t end_us = static_cast<int64_t>(e.itime) - global_start_us;
+      if (idle_intervals)
+        idle_intervals->Add(start_us, end_us, shard.idle.total_rows());
+      shard.idle.Append(
+          {last_begin_idle, e, global_start_us, steps.At(start_us)});
+      if (time_bins)
+        time_bins->AddIdle(start_us, end_us);
+      break;
+    }
+    // BEGIN_PACK / END_PACK / BEGIN_UNPACK / END_UNPACK are deliberately not
+    // collected. They are emitted by CkPackMessage() / CkUnpackMessage()
+    // around ordinary message serialisation, not around chare migration, so
+    // they cannot be used to reconstruct MigrationEpisode. See the comment on
+    // schema::migration_episode().
+    case LogType::BEGIN_COMPUTATION: {
+      iss >> e.itime;
+      ProcessingElementRecord per;
+      per.pe_id = current_pe_id;
+      per.total_pes = sts_data.total_pes;
+      per.begin_time_us = e.itime;
+      per.global_start_us = rc_data.global_start_time_us;
+      result.pes.push_back(per);
+      break;
+    }
+    case LogType::END_COMPUTATION: {
+      iss >> e.itime;
+      for (auto &per : result.pes) {
+        if (per.pe_id == current_pe_id)
+          per.end_time_us = e.itime;
       }
-      case LogType::USER_STAT: {
-        // `cputime` here is the application's own time value, written raw
-        // rather than as integer microseconds like every other time field
-        // (trace-projections.C:775-776), so it is read as a double. The
-        // record's `pe` is genuine (CkMyPe()) but is read and discarded, since
-        // every table in this schema keys on the log file's PE.
-        iss >> e.itime >> e.statTime >> e.stat >> e.pe >> e.mIdx;
-        UserStatSample sample{};
-        sample.pe_id = current_pe_id;
-        sample.stat_id = e.mIdx;
-        sample.time_us = static_cast<int64_t>(e.itime) - global_start_us;
-        sample.stat_value = e.stat;
-        // updateStat() records -1 for "the application supplied no time"
-        // (trace-projections.C:1144-1148).
-        sample.has_user_time = e.statTime != -1.0;
-        sample.user_time_s = e.statTime;
-        auto stat_it = sts_data.user_stat_map.find(sample.stat_id);
-        if (stat_it != sts_data.user_stat_map.end()) {
-          sample.name = stat_it->second.name;
-          sample.has_name = true;
-        }
-        user_stat_builder.Append(sample);
+      break;
+    }
+    case LogType::USER_EVENT: {
+      iss >> e.mIdx >> e.itime >> e.event >> e.pe;
+      UserEventOccurrence occurrence{};
+      occurrence.pe_id = current_pe_id;
+      occurrence.record_type = static_cast<int32_t>(type);
+      occurrence.user_event_id = e.mIdx;
+      occurrence.has_user_event_id = true;
+      occurrence.event = e.event;
+      occurrence.has_event = true;
+      occurrence.start_time_us =
+          static_cast<int64_t>(e.itime) - global_start_us;
+      attach_user_event_name(ctx.user_event_names, occurrence);
+      shard.user_event.Append(occurrence);
+      break;
+    }
+    case LogType::USER_SUPPLIED: {
+      iss >> e.userSuppliedData >> e.itime;
+      UserEventOccurrence occurrence{};
+      occurrence.pe_id = current_pe_id;
+      occurrence.record_type = static_cast<int32_t>(type);
+      occurrence.start_time_us =
+          static_cast<int64_t>(e.itime) - global_start_us;
+      occurrence.user_supplied_int = e.userSuppliedData;
+      occurrence.has_user_supplied_int = true;
+      shard.user_event.Append(occurrence);
+      break;
+    }
+    case LogType::USER_SUPPLIED_NOTE: {
+      iss >> e.itime;
+      e.userSuppliedNote = read_pup_string(iss);
+      UserEventOccurrence occurrence{};
+      occurrence.pe_id = current_pe_id;
+      occurrence.record_type = static_cast<int32_t>(type);
+      occurrence.start_time_us =
+          static_cast<int64_t>(e.itime) - global_start_us;
+      occurrence.note = e.userSuppliedNote;
+      occurrence.has_note = true;
+      shard.user_event.Append(occurrence);
+      break;
+    }
+    case LogType::USER_SUPPLIED_BRACKETED_NOTE: {
+      iss >> e.itime >> e.iEndTime >> e.event;
+      e.userSuppliedNote = read_pup_string(iss);
+      UserEventOccurrence occurrence{};
+      occurrence.pe_id = current_pe_id;
+      occurrence.record_type = static_cast<int32_t>(type);
+      occurrence.event = e.event;
+      occurrence.has_event = true;
+      occurrence.start_time_us =
+          static_cast<int64_t>(e.itime) - global_start_us;
+      occurrence.end_time_us =
+          static_cast<int64_t>(e.iEndTime) - global_start_us;
+      occurrence.has_end_time = true;
+      occurrence.note = e.userSuppliedNote;
+      occurrence.has_note = true;
+      shard.user_event.Append(occurrence);
+      break;
+    }
+    case LogType::USER_EVENT_PAIR: {
+      // The record's own `pe` field is meaningless for the bracketed forms
+      // -- their LogEntry constructor never assigns it, so it is 0 on every
+      // PE. Attribution uses the PE the log file belongs to.
+      iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
+      auto open_it = open_event_pairs.find(e.event);
+      if (open_it == open_event_pairs.end()) {
+        open_event_pairs[e.event] = e;
+        if (is_step_event(e.mIdx))
+          steps.Open(e.nestedID,
+                     static_cast<int64_t>(e.itime) - global_start_us);
         break;
       }
-      case LogType::MEMORY_USAGE_CURRENT: {
-        // The byte count comes *before* the timestamp, reversing the order
-        // every other record uses (trace-projections.C:770-772), and the
-        // record carries no PE field at all.
-        iss >> e.memUsage >> e.itime;
-        MemorySample sample{};
-        sample.pe_id = current_pe_id;
-        sample.time_us = static_cast<int64_t>(e.itime) - global_start_us;
-        sample.bytes = static_cast<int64_t>(e.memUsage);
-        memory_sample_builder.Append(sample);
+      const LogEntry &begin = open_it->second;
+      emit_bracket(static_cast<int32_t>(type), begin.mIdx, begin.event,
+                   begin.nestedID,
+                   static_cast<int64_t>(begin.itime) - global_start_us,
+                   static_cast<int64_t>(e.itime) - global_start_us, true);
+      open_event_pairs.erase(open_it);
+      break;
+    }
+    case LogType::BEGIN_USER_EVENT_PAIR: {
+      iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
+      open_brackets[std::make_tuple(static_cast<int32_t>(e.mIdx), e.nestedID)]
+          .push_back(e);
+      if (is_step_event(e.mIdx))
+        steps.Open(e.nestedID, static_cast<int64_t>(e.itime) - global_start_us);
+      break;
+    }
+    case LogType::END_USER_EVENT_PAIR: {
+      iss >> e.mIdx >> e.itime >> e.event >> e.pe >> e.nestedID;
+      auto key = std::make_tuple(static_cast<int32_t>(e.mIdx), e.nestedID);
+      auto open_it = open_brackets.find(key);
+      if (open_it == open_brackets.end() || open_it->second.empty()) {
+        // An END with no BEGIN: tracing was switched on mid-bracket, or the
+        // application is unbalanced. Keep it as a zero-width occurrence
+        // rather than silently dropping the evidence.
+        spdlog::warn("END_USER_EVENT_PAIR with no open bracket for user "
+                     "event {} (nestedID {}) on PE {}",
+                     e.mIdx, e.nestedID, current_pe_id);
+        emit_bracket(static_cast<int32_t>(type), e.mIdx, e.event, e.nestedID,
+                     static_cast<int64_t>(e.itime) - global_start_us, 0,
+                     false);
         break;
       }
-      default:
-        break;
+      const LogEntry begin = open_it->second.back();
+      open_it->second.pop_back();
+      emit_bracket(static_cast<int32_t>(LogType::BEGIN_USER_EVENT_PAIR),
+                   begin.mIdx, begin.event, begin.nestedID,
+                   static_cast<int64_t>(begin.itime) - global_start_us,
+                   static_cast<int64_t>(e.itime) - global_start_us, true);
+      break;
+    }
+    case LogType::USER_STAT: {
+      // `cputime` here is the application's own time value, written raw
+      // rather than as integer microseconds like every other time field
+      // (trace-projections.C:775-776), so it is read as a double. The
+      // record's `pe` is genuine (CkMyPe()) but is read and discarded, since
+      // every table in this schema keys on the log file's PE.
+      iss >> e.itime >> e.statTime >> e.stat >> e.pe >> e.mIdx;
+      UserStatSample sample{};
+      sample.pe_id = current_pe_id;
+      sample.stat_id = e.mIdx;
+      sample.time_us = static_cast<int64_t>(e.itime) - global_start_us;
+      sample.stat_value = e.stat;
+      // updateStat() records -1 for "the application supplied no time"
+      // (trace-projections.C:1144-1148).
+      sample.has_user_time = e.statTime != -1.0;
+      sample.user_time_s = e.statTime;
+      if (auto code = ctx.user_stat_names.code(sample.stat_id)) {
+        sample.name_code = code->code;
+        sample.has_name = true;
       }
+      ctx.shared.Append(sample);
+      break;
     }
+    case LogType::MEMORY_USAGE_CURRENT: {
+      // The byte count comes *before* the timestamp, reversing the order
+      // every other record uses (trace-projections.C:770-772), and the
+      // record carries no PE field at all.
+      iss >> e.memUsage >> e.itime;
+      MemorySample sample{};
+      sample.pe_id = current_pe_id;
+      sample.time_us = static_cast<int64_t>(e.itime) - global_start_us;
+      sample.bytes = static_cast<int64_t>(e.memUsage);
+      ctx.shared.Append(sample);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  start_order.Drain(append_execution);
 
-    // Brackets still open at end of file: the run was cut short, or tracing
-    // ended inside the bracket. Emit them with no end timestamp so the
-    // occurrence is still visible.
-    for (const auto &[event_serial, begin] : open_event_pairs) {
-      spdlog::warn("Unmatched USER_EVENT_PAIR record for event serial {} on "
-                   "PE {}",
-                   event_serial, current_pe_id);
-      emit_bracket(static_cast<int32_t>(LogType::USER_EVENT_PAIR), begin.mIdx,
-                   begin.event, begin.nestedID,
+  // Brackets still open at end of file: the run was cut short, or tracing
+  // ended inside the bracket. Emit them with no end timestamp so the
+  // occurrence is still visible.
+  for (const auto &[event_serial, begin] : open_event_pairs) {
+    spdlog::warn("Unmatched USER_EVENT_PAIR record for event serial {} on "
+                 "PE {}",
+                 event_serial, current_pe_id);
+    emit_bracket(static_cast<int32_t>(LogType::USER_EVENT_PAIR), begin.mIdx,
+                 begin.event, begin.nestedID,
+                 static_cast<int64_t>(begin.itime) - global_start_us, 0,
+                 false);
+  }
+  for (const auto &[key, stack] : open_brackets) {
+    for (const auto &begin : stack) {
+      spdlog::warn("Unclosed BEGIN_USER_EVENT_PAIR for user event {} "
+                   "(nestedID {}) on PE {}",
+                   std::get<0>(key), std::get<1>(key), current_pe_id);
+      emit_bracket(static_cast<int32_t>(LogType::BEGIN_USER_EVENT_PAIR),
+                   begin.mIdx, begin.event, begin.nestedID,
                    static_cast<int64_t>(begin.itime) - global_start_us, 0,
                    false);
     }
-    for (const auto &[key, stack] : open_brackets) {
-      for (const auto &begin : stack) {
-        spdlog::warn("Unclosed BEGIN_USER_EVENT_PAIR for user event {} "
-                     "(nestedID {}) on PE {}",
-                     std::get<0>(key), std::get<1>(key), current_pe_id);
-        emit_bracket(static_cast<int32_t>(LogType::BEGIN_USER_EVENT_PAIR),
-                     begin.mIdx, begin.event, begin.nestedID,
-                     static_cast<int64_t>(begin.itime) - global_start_us, 0,
-                     false);
+  }
+
+  if (time_bins)
+    time_bins->Drain(current_pe_id, *shard.time_profile);
+  if (pyramid)
+    pyramid->Drain(current_pe_id, shard.timeline);
+  if (exec_intervals) {
+    exec_intervals->Drain(current_pe_id, *shard.exec_index);
+    idle_intervals->Drain(current_pe_id, *shard.idle_index);
+  }
+}
+
+// A PE's log, with the PE its name gives.
+using PeLog = std::pair<std::string, int32_t>;
+
+// Moves one shard's Stage 3 inputs into the combined result. Every key carries
+// a PE the shard owns, so the maps cannot collide except on a broadcast, which
+// several PEs begin processing under one (src_pe, event); the shard's
+// receivers are then chained after the ones already merged. An instance met
+// by several shards has the same id in each, and is kept once.
+void merge_partial(LogParserResult &result, LogParserResult &&partial) {
+  result.creation_map.merge(partial.creation_map);
+  result.chare_instances.merge(partial.chare_instances);
+  memory_accounting().pool("chare_instances")->Charge(
+      -kInstanceNodeBytes *
+      static_cast<int64_t>(partial.chare_instances.size()));
+  result.begin_processing_map.Merge(std::move(partial.begin_processing_map));
+  result.instance_locations.insert(
+      result.instance_locations.end(),
+      std::make_move_iterator(partial.instance_locations.begin()),
+      std::make_move_iterator(partial.instance_locations.end()));
+  result.pes.insert(result.pes.end(), partial.pes.begin(), partial.pes.end());
+  result.step_boundaries.insert(result.step_boundaries.end(),
+                                partial.step_boundaries.begin(),
+                                partial.step_boundaries.end());
+  result.executions.insert(result.executions.end(),
+                           partial.executions.begin(),
+                           partial.executions.end());
+}
+
+// One shard's part of a table the options may leave out, papi_sample or
+// time_profile: a writer and a builder when `wanted`, nothing otherwise.
+template <class Row> class OptionalTable {
+public:
+  OptionalTable(bool wanted, const std::string &output_dir,
+                const std::string &table,
+                const std::shared_ptr<arrow::Schema> &schema,
+                const OutputOptions &options,
+                std::vector<std::shared_ptr<arrow::Array>> dictionaries = {}) {
+    if (!wanted)
+      return;
+    writer_ = open_table_writer(output_dir, table, schema, options);
+    builder_.emplace(*writer_, schema, 0, std::move(dictionaries));
+  }
+
+  [[nodiscard]] auto builder() -> builders::TableBuilder<Row> * {
+    return builder_ ? &*builder_ : nullptr;
+  }
+
+  // Flushes and closes the table; its Parquet footer, or nullptr.
+  auto Close() -> std::shared_ptr<parquet::FileMetaData> {
+    if (!builder_)
+      return nullptr;
+    builder_->Flush();
+    writer_->Close();
+    return parquet_footer(*writer_);
+  }
+
+private:
+  std::unique_ptr<TableWriter> writer_;
+  std::optional<builders::TableBuilder<Row>> builder_;
+};
+
+// Written when OutputOptions::papi_samples asks for it.
+auto papi_sample_table(const std::string &output_dir, const std::string &table,
+                       const ParseContext &ctx)
+    -> OptionalTable<builders::PapiSampleRecord> {
+  return {ctx.options.papi_samples, output_dir, table,
+          charmvz::schema::papi_sample(ctx.sts_data.papi_event_names),
+          ctx.options, std::vector{ctx.papi_counter_names.values()}};
+}
+
+// Written when OutputOptions::time_bin_us gives a bin width.
+auto time_profile_table(const std::string &output_dir,
+                        const std::string &table, const ParseContext &ctx)
+    -> OptionalTable<builders::TimeProfileRow> {
+  return {ctx.options.time_bin_us > 0, output_dir, table,
+          charmvz::schema::time_profile(ctx.options.time_bin_us),
+          ctx.options};
+}
+
+// Written when OutputOptions::interval_index asks for it: the sidecar of
+// `indexed`, at `part` of its own table, `<indexed>_index`.
+auto interval_index_table(const std::string &output_dir,
+                          const std::string &indexed, const std::string &part,
+                          const ParseContext &ctx)
+    -> OptionalTable<IntervalIndexRow> {
+  return {ctx.options.interval_index, output_dir, indexed + "_index" + part,
+          charmvz::schema::interval_index(indexed), ctx.options};
+}
+
+// One shard's timeline levels, level K written as timeline/level=K/<part>.
+// Sorted output declares each file ordered by (pe_id, tile, start_us), which a
+// viewer's filter on the PEs and tiles in view prunes row groups by.
+class TimelineTables {
+public:
+  TimelineTables(const std::string &output_dir, const std::string &part,
+                 const ParseContext &ctx) {
+    const OutputOptions &options = ctx.options;
+    if (options.timeline_levels <= 0)
+      return;
+    const TimelinePyramid pyramid(options.timeline_levels,
+                                  options.timeline_pixel_us);
+    ParquetWriterOptions parquet_options;
+    if (options.sorted)
+      parquet_options.sorted_by = {"pe_id", "tile", "start_us"};
+    for (int32_t level = 0; level < options.timeline_levels; ++level) {
+      const std::string table =
+          "timeline/level=" + std::to_string(level) + "/" + part;
+      if (output_dir != kStdoutPath) {
+        std::filesystem::create_directories(
+            (std::filesystem::path(output_dir) / table).parent_path());
       }
+      const auto schema = charmvz::schema::timeline_level(
+          level, pyramid.pixel_us(level), pyramid.tile_us(level));
+      writers_.push_back(open_table_writer(output_dir, table, schema, options,
+                                           parquet_options));
+      builders_.emplace_back(*writers_.back(), schema);
+    }
+  }
+
+  [[nodiscard]] auto builders() -> std::vector<TimelineBuilder *> {
+    std::vector<TimelineBuilder *> levels;
+    for (auto &builder : builders_)
+      levels.push_back(&builder);
+    return levels;
+  }
+
+  // Flushes and closes every level; their Parquet footers, or nullptrs.
+  auto Close() -> std::vector<std::shared_ptr<parquet::FileMetaData>> {
+    std::vector<std::shared_ptr<parquet::FileMetaData>> footers;
+    for (size_t level = 0; level < builders_.size(); ++level) {
+      builders_[level].Flush();
+      writers_[level]->Close();
+      footers.push_back(parquet_footer(*writers_[level]));
     }
+    return footers;
   }
 
-  exec_builder.Flush();
-  idle_builder.Flush();
-  chare_builder.Flush();
-  user_event_builder.Flush();
-  user_stat_builder.Flush();
-  memory_sample_builder.Flush();
+private:
+  std::vector<std::unique_ptr<TableWriter>> writers_;
+  // A deque, so a builder stays where the shard's pointers to it point.
+  std::deque<TimelineBuilder> builders_;
+};
+
+// Writes the merged chare instances ordered by instance_id, so the table is
+// the same however the logs were sharded, and its row groups' statistics prune
+// a lookup by id. The ids are hashes of the natural keys; two keys sharing one
+// would join one instance's executions to another's, so that stops the run.
+void write_chare_instances(
+    const decltype(LogParserResult::chare_instances) &instances,
+    const std::string &output_dir, const OutputOptions &options) {
+  std::vector<const ChareInstanceRecord *> ordered;
+  ordered.reserve(instances.size());
+  for (const auto &kv : instances)
+    ordered.push_back(&kv.second);
+  std::sort(ordered.begin(), ordered.end(),
+            [](const ChareInstanceRecord *a, const ChareInstanceRecord *b) {
+              return a->instance_id < b->instance_id;
+            });
+  const auto collision = std::adjacent_find(
+      ordered.begin(), ordered.end(),
+      [](const ChareInstanceRecord *a, const ChareInstanceRecord *b) {
+        return a->instance_id == b->instance_id;
+      });
+  if (collision != ordered.end()) {
+    spdlog::error("Chare instances of collections {} and {} hash to the same "
+                  "instance_id {}",
+                  (*collision)->collection_id,
+                  (*std::next(collision))->collection_id,
+                  (*collision)->instance_id);
+    throw std::runtime_error("Chare instance id collision");
+  }
+
+  ParquetWriterOptions chare_options;
+  chare_options.bloom_filter_columns =
+      charmvz::schema::chare_instance_bloom_filter_columns();
+  chare_options.sorted_by = {"instance_id"};
+  const auto schema = charmvz::schema::chare_instance();
+  auto writer = open_table_writer(output_dir, "chare_instance", schema,
+                                  options, chare_options);
+  builders::ChareInstanceBuilder builder(*writer, schema);
+  for (const ChareInstanceRecord *inst : ordered)
+    builder.Append(*inst);
+  builder.Flush();
+}
+
+// Writes the shards' merged (PE, EP) totals. Small enough to stay one file when
+// execution is partitioned.
+void write_ep_pe_summary(const builders::EpPeSummary &summary,
+                         const std::string &output_dir,
+                         const ParseContext &ctx) {
+  const auto &counters = ctx.sts_data.papi_event_names;
+  const auto schema = charmvz::schema::ep_pe_summary(counters);
+  auto writer =
+      open_table_writer(output_dir, "ep_pe_summary", schema, ctx.options);
+  builders::EpPeSummaryBuilder builder(*writer, schema, counters.size());
+  summary.AppendTo(builder);
+  builder.Flush();
+}
+
+// Writes execution, idle_interval and user_event as Hive-partitioned datasets.
+// Each bucket is parsed on its own thread into its own writers, so nothing on
+// the per-execution path is shared but the chare-instance lookup. For Parquet,
+// the footers of the closed parts are gathered into each dataset's
+// `_metadata`; Arrow IPC has no such summary file. The buckets' (PE, EP)
+// totals are merged into `summary`.
+void parse_partitioned(const std::vector<PeLog> &logs, const ParseContext &ctx,
+                       const std::shared_ptr<arrow::Schema> &exec_schema,
+                       const ParquetWriterOptions &exec_options,
+                       const ParquetWriterOptions &idle_options,
+                       const std::string &output_dir,
+                       LogParserResult &result,
+                       builders::EpPeSummary &summary) {
+  const OutputOptions &options = ctx.options;
+  const int32_t buckets = options.partition_buckets;
+  std::vector<std::vector<const PeLog *>> bucket_logs(buckets);
+  for (const auto &log : logs)
+    bucket_logs[log.second % buckets].push_back(&log);
+
+  std::vector<std::string> tables = {"execution", "idle_interval",
+                                     "user_event"};
+  if (options.papi_samples)
+    tables.emplace_back("papi_sample");
+  if (options.time_bin_us > 0)
+    tables.emplace_back("time_profile");
+  if (options.interval_index) {
+    tables.emplace_back("execution_index");
+    tables.emplace_back("idle_interval_index");
+  }
+  for (const auto &table : tables) {
+    for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+      std::filesystem::create_directories(
+          std::filesystem::path(output_dir) / table /
+          ("pe_bucket=" + std::to_string(bucket)));
+    }
+  }
+
+  struct BucketOutput {
+    LogParserResult partial;
+    std::shared_ptr<parquet::FileMetaData> exec_metadata;
+    std::shared_ptr<parquet::FileMetaData> idle_metadata;
+    std::shared_ptr<parquet::FileMetaData> user_event_metadata;
+    std::shared_ptr<parquet::FileMetaData> papi_sample_metadata;
+    std::shared_ptr<parquet::FileMetaData> time_profile_metadata;
+    std::vector<std::shared_ptr<parquet::FileMetaData>> timeline_metadata;
+    std::shared_ptr<parquet::FileMetaData> exec_index_metadata;
+    std::shared_ptr<parquet::FileMetaData> idle_index_metadata;
+    builders::EpPeSummary summary;
+    std::exception_ptr error;
+  };
+  std::vector<BucketOutput> outputs(buckets);
+
+  std::vector<std::thread> threads;
+  threads.reserve(buckets);
+  for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+    threads.emplace_back([&, bucket] {
+      BucketOutput &out = outputs[bucket];
+      try {
+        const std::string part = bucket_part(bucket);
+        auto exec_writer = open_table_writer(
+            output_dir, "execution/" + part, exec_schema, options,
+            exec_options);
+        auto idle_writer = open_table_writer(
+            output_dir, "idle_interval/" + part,
+            charmvz::schema::idle_interval(), options, idle_options);
+        auto user_event_writer =
+            open_table_writer(output_dir, "user_event/" + part,
+                              charmvz::schema::user_event(), options);
+        auto papi_sample =
+            papi_sample_table(output_dir, "papi_sample/" + part, ctx);
+        auto time_profile =
+            time_profile_table(output_dir, "time_profile/" + part, ctx);
+        TimelineTables timeline(output_dir, part, ctx);
+        auto exec_index =
+            interval_index_table(output_dir, "execution", "/" + part, ctx);
+        auto idle_index =
+            interval_index_table(output_dir, "idle_interval", "/" + part, ctx);
+        builders::ExecutionBuilder exec_builder(
+            *exec_writer, exec_schema, ctx.sts_data.papi_event_names.size());
+        builders::IdleIntervalBuilder idle_builder(
+            *idle_writer, charmvz::schema::idle_interval());
+        builders::UserEventBuilder user_event_builder(
+            *user_event_writer, charmvz::schema::user_event(), 0,
+            {ctx.user_event_names.values()});
+        ShardBuilders shard{exec_builder,
+                            idle_builder,
+                            user_event_builder,
+                            papi_sample.builder(),
+                            time_profile.builder(),
+                            timeline.builders(),
+                            exec_index.builder(),
+                            idle_index.builder(),
+                            out.summary};
+        MapBudget budget(out.partial, ctx.spill);
+
+        for (const PeLog *log : bucket_logs[bucket]) {
+          spdlog::info("Processing log: {} (pe_bucket={})", log->first,
+                       bucket);
+          parse_log(log->first, log->second, ctx, shard, out.partial, budget);
+        }
+
+        exec_builder.Flush();
+        idle_builder.Flush();
+        user_event_builder.Flush();
+        exec_writer->Close();
+        idle_writer->Close();
+        user_event_writer->Close();
+        out.exec_metadata = parquet_footer(*exec_writer);
+        out.idle_metadata = parquet_footer(*idle_writer);
+        out.user_event_metadata = parquet_footer(*user_event_writer);
+        out.papi_sample_metadata = papi_sample.Close();
+        out.time_profile_metadata = time_profile.Close();
+        out.timeline_metadata = timeline.Close();
+        out.exec_index_metadata = exec_index.Close();
+        out.idle_index_metadata = idle_index.Close();
+      } catch (...) {
+        out.error = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (const auto &out : outputs) {
+    if (out.error)
+      std::rethrow_exception(out.error);
+  }
+
+  using Parts = std::vector<
+      std::pair<std::string, std::shared_ptr<parquet::FileMetaData>>>;
+  Parts exec_parts, idle_parts, user_event_parts, papi_sample_parts,
+      time_profile_parts, exec_index_parts, idle_index_parts;
+  for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+    BucketOutput &out = outputs[bucket];
+    merge_partial(result, std::move(out.partial));
+    summary.Merge(out.summary);
+    const std::string part = bucket_part(bucket) + ".parquet";
+    exec_parts.emplace_back(part, out.exec_metadata);
+    idle_parts.emplace_back(part, out.idle_metadata);
+    user_event_parts.emplace_back(part, out.user_event_metadata);
+    papi_sample_parts.emplace_back(part, out.papi_sample_metadata);
+    time_profile_parts.emplace_back(part, out.time_profile_metadata);
+    exec_index_parts.emplace_back(part, out.exec_index_metadata);
+    idle_index_parts.emplace_back(part, out.idle_index_metadata);
+  }
+  if (options.format == OutputFormat::Parquet) {
+    write_metadata_summary(output_dir + "/execution", exec_parts);
+    write_metadata_summary(output_dir + "/idle_interval", idle_parts);
+    write_metadata_summary(output_dir + "/user_event", user_event_parts);
+    if (options.papi_samples)
+      write_metadata_summary(output_dir + "/papi_sample", papi_sample_parts);
+    if (options.time_bin_us > 0)
+      write_metadata_summary(output_dir + "/time_profile", time_profile_parts);
+    if (options.interval_index) {
+      write_metadata_summary(output_dir + "/execution_index",
+                             exec_index_parts);
+      write_metadata_summary(output_dir + "/idle_interval_index",
+                             idle_index_parts);
+    }
+    for (int32_t level = 0; level < options.timeline_levels; ++level) {
+      Parts level_parts;
+      for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+        level_parts.emplace_back(bucket_part(bucket) + ".parquet",
+                                 outputs[bucket].timeline_metadata[level]);
+      }
+      write_metadata_summary(output_dir + "/timeline/level=" +
+                                 std::to_string(level),
+                             level_parts);
+    }
+  }
+}
+
+} // namespace
+
+auto BeginProcessingMap::Add(const Key &key,
+                             const BeginProcessingRecord &receipt) -> int64_t {
+  const auto [it, inserted] = entries_.try_emplace(key, Entry{{receipt}});
+  if (inserted)
+    return sizeof(decltype(entries_)::value_type) + 2 * sizeof(void *);
+  Entry &entry = it->second;
+  Slot &last = entry.last == kNone ? entry.first : arena_[entry.last];
+  if (last.receipt.dst_pe == receipt.dst_pe)
+    return 0;
+  last.next = static_cast<int64_t>(arena_.size());
+  entry.last = last.next;
+  arena_.push_back({receipt});
+  return sizeof(Slot);
+}
+
+auto BeginProcessingMap::Find(const Key &key) const
+    -> const BeginProcessingRecord * {
+  const auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second.first.receipt;
+}
+
+void BeginProcessingMap::Merge(BeginProcessingMap &&other) {
+  const auto offset = static_cast<int64_t>(arena_.size());
+  auto rebase = [&](int64_t at) { return at == kNone ? kNone : at + offset; };
+  for (Slot &slot : other.arena_) {
+    slot.next = rebase(slot.next);
+    arena_.push_back(slot);
+  }
+  for (auto &[key, theirs] : other.entries_) {
+    theirs.first.next = rebase(theirs.first.next);
+    theirs.last = rebase(theirs.last);
+    const auto [it, inserted] = entries_.try_emplace(key, theirs);
+    if (inserted)
+      continue;
+    // Their first receipt moves to the arena, chained after our last.
+    Entry &ours = it->second;
+    const auto at = static_cast<int64_t>(arena_.size());
+    arena_.push_back(theirs.first);
+    (ours.last == kNone ? ours.first : arena_[ours.last]).next = at;
+    ours.last = theirs.last == kNone ? at : theirs.last;
+  }
+  other = BeginProcessingMap();
+}
+
+auto pe_from_log_name(const std::string &log_path) -> int32_t {
+  static const std::regex log_regex(R"(.*\.(\d+)\.log(\.gz)?$)");
+  const std::string filename =
+      std::filesystem::path(log_path).filename().string();
+  std::smatch match;
+  if (!std::regex_match(filename, match, log_regex)) {
+    return -1;
+  }
+  return std::stoi(match[1]);
+}
+
+auto process_logs(const std::vector<std::string> &log_file_paths,
+                  const StsData &sts_data, const RcData &rc_data,
+                  const std::string &output_dir, int32_t step_event_id,
+                  const OutputOptions &options) -> LogParserResult {
+  if (options.partition_buckets > 0 && !options.stream_table.empty()) {
+    // The buckets write concurrently, each through its own writer; they cannot
+    // all own stdout.
+    spdlog::error("Streaming a table cannot be combined with partitioning");
+    throw std::runtime_error("Stream with partitioned output");
+  }
+  LogParserResult result;
+  // The budget is the option's, whoever calls: the spill store below is only
+  // ever used once the accounting has a threshold to pass. It stays set for
+  // Stage 3's builders.
+  memory_accounting().set_budget(options.max_memory_bytes);
+
+  auto exec_schema = charmvz::schema::execution(sts_data.papi_event_names,
+                                                options.compact_types);
+  ParquetWriterOptions exec_options;
+  exec_options.bloom_filter_columns =
+      charmvz::schema::execution_bloom_filter_columns();
+  if (options.compact_types) {
+    exec_options.delta_encoded_columns =
+        charmvz::schema::execution_delta_columns();
+  }
+  // Idle intervals need no reordering to be sorted: a PE's BEGIN/END_IDLE
+  // pairs never nest, so once the logs are taken in PE order the rows already
+  // are.
+  ParquetWriterOptions idle_options;
+  if (options.sorted) {
+    exec_options.sorted_by = {"pe_id", "start_time_us"};
+    idle_options.sorted_by = {"pe_id", "start_time_us"};
+  }
+  auto user_stat_writer = open_table_writer(
+      output_dir, "user_stat", charmvz::schema::user_stat(), options);
+  auto memory_sample_writer = open_table_writer(
+      output_dir, "memory_sample", charmvz::schema::memory_sample(), options);
+
+  const builders::NameDictionary user_event_names(sts_data.user_event_map);
+  const builders::NameDictionary user_stat_names(sts_data.user_stat_map);
+  const builders::NameDictionary papi_counter_names(sts_data.papi_event_names);
+  builders::UserStatBuilder user_stat_builder(*user_stat_writer,
+                                              charmvz::schema::user_stat(), 0,
+                                              {user_stat_names.values()});
+  builders::MemorySampleBuilder memory_sample_builder(
+      *memory_sample_writer, charmvz::schema::memory_sample());
+  SharedTables shared(user_stat_builder, memory_sample_builder);
+  // The spill files go beside the output, which is where the space for it
+  // was provisioned; a stream to stdout has no directory of its own.
+  std::shared_ptr<SpillStore> spill;
+  if (options.max_memory_bytes > 0) {
+    const std::filesystem::path spill_base =
+        output_dir == kStdoutPath ? std::filesystem::temp_directory_path()
+                                  : std::filesystem::path(output_dir);
+    spill = std::make_shared<SpillStore>(spill_base, sts_data.total_pes);
+  }
+  const ParseContext ctx{sts_data,        rc_data,        step_event_id,
+                         options,         shared,         user_event_names,
+                         user_stat_names, papi_counter_names, spill.get()};
+
+  std::vector<PeLog> logs;
+  for (const auto &log_path : log_file_paths) {
+    const int32_t pe_id = pe_from_log_name(log_path);
+    if (pe_id < 0) {
+      // Every row this pipeline writes is keyed on the PE that owns the log
+      // file, so a file whose name yields no PE cannot be attributed at all.
+      // Parsing it anyway would write rows on a PE that does not exist, which
+      // no downstream join rejects.
+      spdlog::error("Skipping {}: cannot determine the PE from its name",
+                    std::filesystem::path(log_path).filename().string());
+      continue;
+    }
+    logs.emplace_back(log_path, pe_id);
+  }
+  // Directory listing order is arbitrary. Sorted output needs the PEs in
+  // order, and each PE's rows are then ordered as its log is read.
+  if (options.sorted) {
+    std::stable_sort(logs.begin(), logs.end(),
+                     [](const PeLog &a, const PeLog &b) {
+                       return a.second < b.second;
+                     });
+  }
+
+  builders::EpPeSummary summary;
+  if (options.partition_buckets > 0) {
+    parse_partitioned(logs, ctx, exec_schema, exec_options, idle_options,
+                      output_dir, result, summary);
+  } else {
+    auto exec_writer = open_table_writer(output_dir, "execution", exec_schema,
+                                         options, exec_options);
+    auto idle_writer =
+        open_table_writer(output_dir, "idle_interval",
+                          charmvz::schema::idle_interval(), options,
+                          idle_options);
+    auto user_event_writer = open_table_writer(
+        output_dir, "user_event", charmvz::schema::user_event(), options);
+    auto papi_sample = papi_sample_table(output_dir, "papi_sample", ctx);
+    auto time_profile = time_profile_table(output_dir, "time_profile", ctx);
+    TimelineTables timeline(output_dir, "part-0", ctx);
+    auto exec_index = interval_index_table(output_dir, "execution", "", ctx);
+    auto idle_index =
+        interval_index_table(output_dir, "idle_interval", "", ctx);
+    builders::ExecutionBuilder exec_builder(
+        *exec_writer, exec_schema, sts_data.papi_event_names.size());
+    builders::IdleIntervalBuilder idle_builder(
+        *idle_writer, charmvz::schema::idle_interval());
+    builders::UserEventBuilder user_event_builder(
+        *user_event_writer, charmvz::schema::user_event(), 0,
+        {ctx.user_event_names.values()});
+    ShardBuilders shard{exec_builder,
+                        idle_builder,
+                        user_event_builder,
+                        papi_sample.builder(),
+                        time_profile.builder(),
+                        timeline.builders(),
+                        exec_index.builder(),
+                        idle_index.builder(),
+                        summary};
+    MapBudget budget(result, ctx.spill);
+
+    for (const auto &[log_path, pe_id] : logs) {
+      spdlog::info("Processing log: {}", log_path);
+      parse_log(log_path, pe_id, ctx, shard, result, budget);
+    }
+
+    exec_builder.Flush();
+    idle_builder.Flush();
+    user_event_builder.Flush();
+    papi_sample.Close();
+    time_profile.Close();
+    timeline.Close();
+    exec_index.Close();
+    idle_index.Close();
+  }
+  shared.Flush();
+  write_chare_instances(result.chare_instances, output_dir, options);
+  write_ep_pe_summary(summary, output_dir, ctx);
+
+  // Once anything has spilled, Stage 3 reads every input a partition at a
+  // time, so what is still in memory joins it on disk.
+  if (spill && spill->used()) {
+    spill->Spill(result.creation_map);
+    spill->Spill(result.begin_processing_map);
+    spill->Spill(result.instance_locations);
+    CreationMap().swap(result.creation_map);
+    result.begin_processing_map = BeginProcessingMap();
+    std::vector<InstanceLocationRecord>().swap(result.instance_locations);
+    for (const char *map :
+         {"creation_map", "begin_processing_map", "instance_locations"}) {
+      auto *pool = memory_accounting().pool(map);
+      pool->Charge(-pool->bytes_allocated());
+    }
+    spdlog::info("Stage 3 will read its inputs from {} ({} spilled)",
+                 spill->dir().string(), format_bytes(spill->bytes_written()));
+    result.spill = std::move(spill);
+  }
 
   return result;
 }
@@ -1,7 +1,11 @@
 #pragma once
+#include "output_options.h"
 #include "rc_parser.h"
 #include "sts_parser.h"
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <type_traits>
@@ -29,6 +33,16 @@ struct TupleHash {
   }
 };
 
+// The execution running on a PE when it sent a message: the innermost one
+// begun and not yet ended, with the instance its BEGIN_PROCESSING registered.
+// `instance_id` is -1 when there is none, as the execution row's would be
+// null.
+struct SenderRecord {
+  int32_t event;
+  int32_t ep_id;
+  int64_t instance_id;
+};
+
 struct CreationRecord {
   int32_t ep_id;
   int32_t msg_idx;
@@ -39,6 +53,10 @@ struct CreationRecord {
   int32_t broadcast_fanout;
   int32_t src_pe;
   std::vector<int32_t> dst_pes;
+  // The sender's step at the send.
+  std::optional<int32_t> step_id;
+  // Unset when the send came from outside any execution.
+  std::optional<SenderRecord> sender;
 };
 
 // Where one chare-array instance was executing, and when. Stage 3 sorts these
@@ -55,6 +73,20 @@ struct InstanceLocationRecord {
   int64_t end_time_us;
 };
 
+// One execution as the Stage 3 graphs see it: where and when it ran, and the
+// (src_pe, event) of the message it ran. Timestamps are aligned to the global
+// start. Collected only under OutputOptions::critical_path or
+// execution_graph.
+struct ExecutionSpanRecord {
+  int32_t pe_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t ep_id;
+  int64_t start_time_us;
+  int64_t end_time_us;
+  int64_t recv_time_us;
+};
+
 struct ProcessingElementRecord {
   int32_t pe_id;
   int32_t total_pes;
@@ -89,7 +121,8 @@ struct UserEventOccurrence {
   int32_t record_type;
   int32_t user_event_id;
   bool has_user_event_id;
-  std::string name;
+  // The name's code in the user_event name dictionary.
+  int32_t name_code;
   bool has_name;
   int32_t event;
   bool has_event;
@@ -111,7 +144,8 @@ struct UserEventOccurrence {
 struct UserStatSample {
   int32_t pe_id;
   int32_t stat_id;
-  std::string name;
+  // The name's code in the user_stat name dictionary.
+  int32_t name_code;
   bool has_name;
   int64_t time_us;
   double stat_value;
@@ -137,24 +171,127 @@ struct StepBoundaryRecord {
   bool has_end_time;
 };
 
+// A chare instance's natural key: collection_id, then index_0 .. index_5.
+using ChareInstanceKey =
+    std::tuple<int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t>;
+
+// The instance_id of the chare instance keyed `key`: a 63-bit hash of the key,
+// so every shard derives the same id from its own BEGIN_PROCESSING records, in
+// any order and without asking the others. process_logs checks that the ids
+// of a run's instances are distinct.
+constexpr auto make_instance_id(const ChareInstanceKey &key) -> int64_t {
+  uint64_t hash = 0x9e3779b97f4a7c15;
+  std::apply(
+      [&](auto... parts) {
+        // The splitmix64 finaliser over each part in turn.
+        ((hash ^= static_cast<uint32_t>(parts),
+          hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9,
+          hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb,
+          hash ^= hash >> 31),
+         ...);
+      },
+      key);
+  return static_cast<int64_t>(hash >> 1);
+}
+
+// Keyed on (src_pe, event), the sender's side of a message.
+using CreationMap =
+    std::unordered_map<std::tuple<int32_t, int32_t>, CreationRecord, TupleHash>;
+
+// Every receipt of each message, keyed on (src_pe, event). Most messages have
+// one receiver, kept in the map entry itself. A broadcast or multicast chains
+// its further receivers through an arena the map owns, so linking one to N
+// PEs adds N - 1 arena slots rather than a hash node apiece.
+class BeginProcessingMap {
+public:
+  using Key = std::tuple<int32_t, int32_t>;
+
+  // Records that `receipt.dst_pe` began processing message `key`, unless that
+  // PE was the last to: a PE runs a multicast once per element it holds, and
+  // its log is read in one go, so its repeats arrive together. Returns the
+  // bytes the map grew by, estimated as MapBudget counts them: a hash node for
+  // a new key, an arena slot for a further receiver and nothing for a repeat.
+  auto Add(const Key &key, const BeginProcessingRecord &receipt) -> int64_t;
+
+  // The first receipt of `key`, or null.
+  [[nodiscard]] auto Find(const Key &key) const
+      -> const BeginProcessingRecord *;
+
+  // Calls fn(receipt) for each receipt of `key`, in the order they were added.
+  template <class Fn> void ForEach(const Key &key, Fn &&fn) const {
+    const auto it = entries_.find(key);
+    if (it != entries_.end())
+      Walk(it->second, fn);
+  }
+
+  // Calls fn(key, receipt) for every receipt, each key's in order.
+  template <class Fn> void ForEachReceipt(Fn &&fn) const {
+    for (const auto &[key, entry] : entries_)
+      Walk(entry, [&](const BeginProcessingRecord &r) { fn(key, r); });
+  }
+
+  // Moves every receipt of `other` in, after this map's own under a key both
+  // hold.
+  void Merge(BeginProcessingMap &&other);
+
+  // The number of keys, and of receipts under them.
+  [[nodiscard]] auto size() const -> size_t { return entries_.size(); }
+  [[nodiscard]] auto receipts() const -> size_t {
+    return entries_.size() + arena_.size();
+  }
+
+private:
+  static constexpr int64_t kNone = -1;
+  struct Slot {
+    BeginProcessingRecord receipt;
+    int64_t next = kNone;
+  };
+  // The first receipt, and the arena index of the last when there are more.
+  struct Entry {
+    Slot first;
+    int64_t last = kNone;
+  };
+
+  template <class Fn> void Walk(const Entry &entry, Fn &&fn) const {
+    fn(entry.first.receipt);
+    for (int64_t at = entry.first.next; at != kNone; at = arena_[at].next)
+      fn(arena_[at].receipt);
+  }
+
+  std::unordered_map<Key, Entry, TupleHash> entries_;
+  std::vector<Slot> arena_;
+};
+
+// The message_id of the message keyed (src_pe, event): the sender in the high
+// 32 bits and the event in the low. The sender's CREATION and the receiver's
+// BEGIN_PROCESSING both carry the key, so execution rows get the id in Stage 2
+// without waiting for Stage 3 to see the send.
+constexpr auto make_message_id(int32_t src_pe, int32_t event) -> int64_t {
+  return static_cast<int64_t>(src_pe) << 32 | static_cast<uint32_t>(event);
+}
+
+class SpillStore;
+
 struct LogParserResult {
-  std::unordered_map<std::tuple<int32_t, int32_t>, CreationRecord, TupleHash>
-      creation_map;
+  CreationMap creation_map;
   std::vector<InstanceLocationRecord> instance_locations;
   std::vector<ProcessingElementRecord> pes;
-  // Keyed on (collection_id, index_0 .. index_5) -- the chare instance's
-  // natural key.
-  std::unordered_map<
-      std::tuple<int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t>,
-      ChareInstanceRecord, TupleHash>
+  // Keyed on the chare instance's natural key.
+  std::unordered_map<ChareInstanceKey, ChareInstanceRecord, TupleHash>
       chare_instances;
-  std::unordered_map<std::tuple<int32_t, int32_t>, BeginProcessingRecord,
-                     TupleHash>
-      begin_processing_map;
+  BeginProcessingMap begin_processing_map;
   // Empty unless a step-boundary user event was configured and found. Small by
   // construction -- one entry per (timestep, PE) -- so it is accumulated in
   // memory rather than streamed.
   std::vector<StepBoundaryRecord> step_boundaries;
+  // Every execution, for the critical path and the execution graph; empty
+  // unless OutputOptions asked for either.
+  std::vector<ExecutionSpanRecord> executions;
+  // Set when OutputOptions::max_memory_bytes made Stage 2 spill. The store
+  // then holds all of creation_map, begin_processing_map and
+  // instance_locations, which are left empty, for Stage 3 to read back one
+  // partition at a time.
+  std::shared_ptr<SpillStore> spill;
 };
 
 // `step_event_id` selects the registered user event whose brackets delimit a
@@ -164,6 +301,11 @@ constexpr int32_t NO_STEP_EVENT = -1;
 auto process_logs(const std::vector<std::string> &log_file_paths,
                   const StsData &sts_data, const RcData &rc_data,
                   const std::string &output_dir,
-                  int32_t step_event_id = NO_STEP_EVENT) -> LogParserResult;
+                  int32_t step_event_id = NO_STEP_EVENT,
+                  const OutputOptions &options = {}) -> LogParserResult;
+
+// The PE a per-PE log belongs to, from its `<pgm>.<pe>.log[.gz]` name; -1 when
+// the name carries no PE.
+auto pe_from_log_name(const std::string &log_path) -> int32_t;
 
 } // namespace charmvz
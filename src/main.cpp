@@ -1,10 +1,18 @@
 #include "CLI/CLI.hpp"
+#include "critical_path.h"
+#include "execution_graph.h"
+#ifdef CHARMVZ_WITH_FLIGHT
+#include "flight_server.h"
+#endif
 #include "log_parser.h"
-#include "parquet_writer.h"
+#include "memory_pool.h"
+#include "output_options.h"
+#include "output_writer.h"
 #include "rc_parser.h"
 #include "reconstruction.h"
 #include "schema.h"
 #include "spdlog/cfg/env.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
 #include "sts_parser.h"
 #include <arrow/builder.h>
@@ -22,25 +30,181 @@ auto main(int argc, char **argv) -> int {
   // bracketed event that delimits one timestep. Configurable because the name
   // is the application's choice, not the runtime's.
   std::string step_event_name = "SimulationStep";
+  charmvz::OutputOptions output_options;
+  std::string format_name = "parquet";
+  std::string ipc_compression_name = "none";
+  std::string memory_pool_name = "default";
+#ifdef CHARMVZ_WITH_FLIGHT
+  bool serve_requested = false;
+  std::filesystem::path serve_path;
+  int serve_port = 8815;
+#endif
 
   try {
     CLI::App app{"Parser for Charm++ files to Apache Arrow"};
+    // Required unless a subcommand is given; checked after parsing, since
+    // CLI11 would otherwise demand them of `charmvz serve` too.
     app.add_option("-l,--logs", logs_path, "Logs Directory Path")
-        ->required()
         ->check(CLI::ExistingDirectory);
-    app.add_option("-o,--output", out_path, "Output Directory Path")
-        ->required();
+    app.add_option("-o,--output", out_path,
+                   "Output Directory Path, or - with --stream");
     app.add_option("-s,--step-event", step_event_name,
                    "Name of the registered bracketed user event that delimits "
                    "a timestep; its nestedID carries the step index")
         ->capture_default_str();
+    app.add_flag("--sorted", output_options.sorted,
+                 "Write execution ordered by (pe_id, start_time_us) and "
+                 "message by (src_pe, send_time_us), declared as the files' "
+                 "sorting_columns");
+    auto *partition_option =
+        app.add_option("--partition-buckets", output_options.partition_buckets,
+                       "Write execution, idle_interval, user_event and "
+                       "message as <table>/pe_bucket=K/ datasets with K = "
+                       "pe_id % N (src_pe for message), parsing and linking "
+                       "the N buckets in parallel; 0 writes single files")
+            ->check(CLI::NonNegativeNumber)
+            ->capture_default_str();
+    app.add_option("--format", format_name,
+                   "Output file format: parquet, or arrow for Arrow IPC files "
+                   "that can be memory-mapped and read with no decoding")
+        ->check(CLI::IsMember({"parquet", "arrow"}))
+        ->capture_default_str();
+    app.add_option("--ipc-compression", ipc_compression_name,
+                   "Buffer compression for --format arrow; none keeps the "
+                   "files zero-copy readable")
+        ->check(CLI::IsMember({"none", "lz4"}))
+        ->capture_default_str();
+    app.add_flag("--papi-samples", output_options.papi_samples,
+                 "Also write papi_sample, one row per PAPI counter per "
+                 "execution, for traces with any number of counters");
+    app.add_option("--time-bin-us", output_options.time_bin_us,
+                   "Also write time_profile, each PE's busy time per entry "
+                   "method and idle time in bins of this many microseconds, "
+                   "and bin pe_comm_matrix by send time at the same width")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--timeline-levels", output_options.timeline_levels,
+                   "Also write a timeline pyramid of this many levels under "
+                   "timeline/level=K/, each four times coarser than the last")
+        ->check(CLI::NonNegativeNumber);
+    app.add_option("--timeline-pixel-us", output_options.timeline_pixel_us,
+                   "Pixel width of the finest timeline level; executions "
+                   "shorter than a level's pixel are merged")
+        ->check(CLI::PositiveNumber)
+        ->capture_default_str();
+    app.add_flag("--interval-index", output_options.interval_index,
+                 "Also write execution_index and idle_interval_index, "
+                 "sidecars that answer which rows of a PE overlap a time "
+                 "window without scanning it");
+    app.add_flag("--critical-path", output_options.critical_path,
+                 "Also write critical_path, each simulation step's longest "
+                 "chain of executions and messages, and execution_slack");
+    app.add_flag("--execution-graph", output_options.execution_graph,
+                 "Also write execution_graph/, the executions linked by "
+                 "messages and same-PE succession as memory-mappable CSR "
+                 ".npy arrays with a node table");
+    app.add_option("--memory-pool", memory_pool_name,
+                   "Allocator behind the per-table memory accounting; "
+                   "jemalloc and mimalloc need an Arrow built with them")
+        ->check(CLI::IsMember({"default", "system", "jemalloc", "mimalloc"}))
+        ->capture_default_str();
+    app.add_option("--max-memory", output_options.max_memory_bytes,
+                   "Memory budget such as 4G for staged rows, Arrow buffers "
+                   "and the reconstruction maps; near it row groups are "
+                   "flushed early and the largest maps spill to disk")
+        ->transform(CLI::AsSizeValue(false));
+    app.add_flag("--compact-types", output_options.compact_types,
+                 "Write ep_id and msg_idx as uint16 and durations as int32 in "
+                 "execution and message, with delta-encoded timestamps; a "
+                 "value out of range stops the run");
+    // The buckets are written concurrently, and interleaving their batches on
+    // one stdout would need a writer shared across threads for no gain.
+    app.add_option("--stream", output_options.stream_table,
+                   "Write this table to stdout as an Arrow IPC stream while "
+                   "parsing; with -o - no other table is written")
+        ->check(CLI::IsMember(
+            {"processing_element", "chare_collection", "entry_method",
+             "chare_instance", "execution", "message", "message_delivery",
+             "idle_interval", "migration_episode", "user_event",
+             "simulation_step", "message_type", "user_stat", "memory_sample",
+             "papi_sample", "ep_pe_summary", "time_profile",
+             "ep_comm_graph", "pe_comm_matrix"}))
+        ->excludes(partition_option);
+#ifdef CHARMVZ_WITH_FLIGHT
+    auto *serve = app.add_subcommand(
+        "serve", "Serve a converted output directory over Arrow Flight on "
+                 "localhost, filtering by pe_id, ep_id and time on the server");
+    serve->add_option("-d,--dir", serve_path, "Output Directory Path to serve")
+        ->required()
+        ->check(CLI::ExistingDirectory);
+    serve->add_option("-p,--port", serve_port, "Port to listen on; 0 picks one")
+        ->check(CLI::Range(0, 65535))
+        ->capture_default_str();
+#endif
     CLI11_PARSE(app, argc, argv);
+#ifdef CHARMVZ_WITH_FLIGHT
+    serve_requested = serve->parsed();
+#endif
   } catch (const std::exception &e) {
     spdlog::error("Error: {}", e.what());
     return 1;
   }
 
-  if (!std::filesystem::exists(out_path)) {
+#ifdef CHARMVZ_WITH_FLIGHT
+  if (serve_requested) {
+    try {
+      charmvz::serve_tables(serve_path.string(), serve_port);
+    } catch (const std::exception &e) {
+      spdlog::error("Error: {}", e.what());
+      return 1;
+    }
+    return 0;
+  }
+#endif
+  if (logs_path.empty() || out_path.empty()) {
+    spdlog::error("--logs and --output are required");
+    return 1;
+  }
+
+  try {
+    charmvz::memory_accounting().SetBackend(memory_pool_name);
+  } catch (const std::exception &e) {
+    spdlog::error("Error: {}", e.what());
+    return 1;
+  }
+
+  if (format_name == "arrow") {
+    output_options.format = charmvz::OutputFormat::ArrowIpc;
+  }
+  if (ipc_compression_name == "lz4") {
+    output_options.ipc_compression = charmvz::IpcCompression::Lz4;
+  }
+
+  if (output_options.stream_table == "papi_sample") {
+    output_options.papi_samples = true;
+  }
+  if (output_options.stream_table == "time_profile" &&
+      output_options.time_bin_us == 0) {
+    spdlog::error("--stream time_profile needs --time-bin-us");
+    return 1;
+  }
+  if (!output_options.stream_table.empty()) {
+    // stdout now carries the table, so the log has to go somewhere else or
+    // the consumer reads log lines as IPC messages.
+    spdlog::set_default_logger(spdlog::stderr_color_mt("charmvz"));
+    spdlog::cfg::load_env_levels();
+  }
+
+  if (out_path == charmvz::kStdoutPath) {
+    if (output_options.stream_table.empty()) {
+      spdlog::error("-o - writes only the table selected with --stream");
+      return 1;
+    }
+    if (output_options.execution_graph) {
+      // A directory of its own, which stdout has no room for.
+      spdlog::error("--execution-graph cannot be written to -o -");
+      return 1;
+    }
+  } else if (!std::filesystem::exists(out_path)) {
     std::filesystem::create_directories(out_path);
   }
 
@@ -74,13 +238,14 @@ auto main(int argc, char **argv) -> int {
   spdlog::info("Total logs: {}", traces_paths.size());
 
   // Stage 1
+  charmvz::memory_accounting().EnterStage("sts");
   auto sts_data = charmvz::parse_sts_file(sts_file_path);
   auto rc_data = charmvz::parse_rc_file(rc_file_path);
 
   if (!sts_data.chares.empty()) {
-    charmvz::ParquetWriter chare_writer(charmvz::schema::chare_collection(),
-                                        out_path.string() +
-                                            "/chare_collection.parquet");
+    auto chare_writer = charmvz::open_table_writer(
+        out_path.string(), "chare_collection",
+        charmvz::schema::chare_collection(), output_options);
     arrow::Int32Builder c_id, ndims;
     arrow::StringBuilder c_name;
     for (const auto &c : sts_data.chares) {
@@ -95,13 +260,13 @@ auto main(int argc, char **argv) -> int {
     auto batch =
         arrow::RecordBatch::Make(charmvz::schema::chare_collection(),
                                  a_cid->length(), {a_cid, a_name, a_ndims});
-    chare_writer.WriteBatch(batch);
+    chare_writer->WriteBatch(batch);
   }
 
   if (!sts_data.entries.empty()) {
-    charmvz::ParquetWriter ep_writer(charmvz::schema::entry_method(),
-                                     out_path.string() +
-                                         "/entry_method.parquet");
+    auto ep_writer = charmvz::open_table_writer(
+        out_path.string(), "entry_method", charmvz::schema::entry_method(),
+        output_options);
     arrow::Int32Builder ep_id, c_id_ep, msg_idx;
     arrow::StringBuilder ep_name;
     for (const auto &ep : sts_data.entries) {
@@ -118,13 +283,13 @@ auto main(int argc, char **argv) -> int {
     auto batch = arrow::RecordBatch::Make(
         charmvz::schema::entry_method(), a_ep_id->length(),
         {a_ep_id, a_ep_name, a_cid_ep, a_msg_idx});
-    ep_writer.WriteBatch(batch);
+    ep_writer->WriteBatch(batch);
   }
 
   if (!sts_data.messages.empty()) {
-    charmvz::ParquetWriter msg_type_writer(charmvz::schema::message_type(),
-                                           out_path.string() +
-                                               "/message_type.parquet");
+    auto msg_type_writer = charmvz::open_table_writer(
+        out_path.string(), "message_type", charmvz::schema::message_type(),
+        output_options);
     arrow::Int32Builder mt_idx;
     arrow::Int64Builder mt_size;
     for (const auto &m : sts_data.messages) {
@@ -137,7 +302,7 @@ auto main(int argc, char **argv) -> int {
     auto batch =
         arrow::RecordBatch::Make(charmvz::schema::message_type(),
                                  a_mt_idx->length(), {a_mt_idx, a_mt_size});
-    msg_type_writer.WriteBatch(batch);
+    msg_type_writer->WriteBatch(batch);
   }
 
   const int32_t step_event_id =
@@ -152,14 +317,28 @@ auto main(int argc, char **argv) -> int {
   }
 
   // Stage 2
+  charmvz::memory_accounting().EnterStage("logs");
   auto log_result = charmvz::process_logs(traces_paths, sts_data, rc_data,
-                                          out_path.string(), step_event_id);
+                                          out_path.string(), step_event_id,
+                                          output_options);
 
   // Stage 3 & 4
+  charmvz::memory_accounting().EnterStage("reconstruction");
   charmvz::reconstruct_message_and_migration(log_result, sts_data, rc_data,
-                                             out_path.string());
-  charmvz::reconstruct_simulation_steps(log_result, out_path.string());
+                                             out_path.string(),
+                                             output_options);
+  if (output_options.critical_path) {
+    charmvz::reconstruct_critical_path(log_result, rc_data, out_path.string(),
+                                       output_options);
+  }
+  if (output_options.execution_graph) {
+    charmvz::write_execution_graph(log_result, rc_data, out_path.string(),
+                                   output_options);
+  }
+  charmvz::reconstruct_simulation_steps(log_result, out_path.string(),
+                                        output_options);
 
+  charmvz::memory_accounting().Report();
   spdlog::info("Pipeline successfully finished.");
   return 0;
 }
@@ -0,0 +1,153 @@
+#include "memory_pool.h"
+#include <array>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace charmvz {
+
+namespace {
+
+void update_max(std::atomic<int64_t> &max, int64_t value) {
+  int64_t seen = max.load();
+  while (value > seen && !max.compare_exchange_weak(seen, value)) {
+  }
+}
+
+} // namespace
+
+TablePool::TablePool(std::string table, arrow::MemoryPool *backend,
+                     MemoryAccounting &accounting)
+    : table_(std::move(table)), backend_(backend), accounting_(accounting) {}
+
+auto TablePool::Allocate(int64_t size, int64_t alignment, uint8_t **out)
+    -> arrow::Status {
+  ARROW_RETURN_NOT_OK(backend_->Allocate(size, alignment, out));
+  total_ += size;
+  ++allocations_;
+  Account(size);
+  return arrow::Status::OK();
+}
+
+auto TablePool::Reallocate(int64_t old_size, int64_t new_size,
+                           int64_t alignment, uint8_t **ptr) -> arrow::Status {
+  ARROW_RETURN_NOT_OK(backend_->Reallocate(old_size, new_size, alignment, ptr));
+  if (new_size > old_size)
+    total_ += new_size - old_size;
+  Account(new_size - old_size);
+  return arrow::Status::OK();
+}
+
+void TablePool::Free(uint8_t *buffer, int64_t size, int64_t alignment) {
+  backend_->Free(buffer, size, alignment);
+  Account(-size);
+}
+
+void TablePool::Account(int64_t delta) {
+  update_max(peak_, bytes_ += delta);
+  accounting_.Account(delta);
+}
+
+void MemoryAccounting::SetBackend(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!pools_.empty()) {
+    spdlog::error("The memory pool backend must be chosen before any table "
+                  "allocates");
+    throw std::runtime_error("Memory pool backend set too late");
+  }
+  arrow::Status status;
+  if (name == "default") {
+    backend_ = arrow::default_memory_pool();
+  } else if (name == "system") {
+    backend_ = arrow::system_memory_pool();
+  } else if (name == "jemalloc") {
+    status = arrow::jemalloc_memory_pool(&backend_);
+  } else if (name == "mimalloc") {
+    status = arrow::mimalloc_memory_pool(&backend_);
+  } else {
+    spdlog::error("Unknown memory pool backend {}", name);
+    throw std::runtime_error("Unknown memory pool backend");
+  }
+  if (!status.ok()) {
+    spdlog::error("The {} memory pool is not available: {}", name,
+                  status.ToString());
+    throw std::runtime_error("Memory pool backend not available");
+  }
+}
+
+auto MemoryAccounting::pool(const std::string &table) -> TablePool * {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &pool = pools_[table];
+  if (!pool)
+    pool = std::make_unique<TablePool>(table, backend_, *this);
+  return pool.get();
+}
+
+void MemoryAccounting::EnterStage(const std::string &stage) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!stage_.empty())
+    finished_stages_.emplace_back(stage_, stage_peak_.load());
+  stage_ = stage;
+  stage_peak_.store(bytes_.load());
+}
+
+void MemoryAccounting::set_budget(int64_t bytes) {
+  budget_.store(bytes);
+  set_flush_threshold(bytes / 4 * 3);
+  spill_threshold_.store(bytes / 10 * 9);
+}
+
+auto MemoryAccounting::stage_peaks() const
+    -> std::vector<std::pair<std::string, int64_t>> {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto peaks = finished_stages_;
+  if (!stage_.empty())
+    peaks.emplace_back(stage_, stage_peak_.load());
+  return peaks;
+}
+
+void MemoryAccounting::Account(int64_t delta) {
+  const int64_t now = bytes_ += delta;
+  update_max(peak_, now);
+  update_max(stage_peak_, now);
+}
+
+void MemoryAccounting::Report() const {
+  spdlog::info("Memory: peak {} in Arrow pools and staged rows ({} backend)",
+               format_bytes(peak()), backend_->backend_name());
+  if (budget() > 0)
+    spdlog::info("  budget {}", format_bytes(budget()));
+  for (const auto &[stage, peak] : stage_peaks())
+    spdlog::info("  stage {}: peak {}", stage, format_bytes(peak));
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[table, pool] : pools_) {
+    std::string notes;
+    if (pool->early_flushes() > 0)
+      notes += fmt::format(", {} row groups flushed early",
+                           pool->early_flushes());
+    if (pool->spills() > 0)
+      notes += fmt::format(", spilled to disk {} times", pool->spills());
+    spdlog::info("  {}: peak {}{}", table, format_bytes(pool->max_memory()),
+                 notes);
+  }
+}
+
+auto memory_accounting() -> MemoryAccounting & {
+  static MemoryAccounting accounting;
+  return accounting;
+}
+
+auto format_bytes(int64_t bytes) -> std::string {
+  static constexpr std::array<const char *, 4> kUnits = {"KiB", "MiB", "GiB",
+                                                         "TiB"};
+  if (bytes < 1024)
+    return std::to_string(bytes) + " B";
+  auto value = static_cast<double>(bytes) / 1024;
+  size_t unit = 0;
+  while (value >= 1024 && unit + 1 < kUnits.size()) {
+    value /= 1024;
+    ++unit;
+  }
+  return fmt::format("{:.1f} {}", value, kUnits[unit]);
+}
+
+} // namespace charmvz
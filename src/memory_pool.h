@@ -0,0 +1,158 @@
+#pragma once
+#include <arrow/api.h>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace charmvz {
+
+class MemoryAccounting;
+
+// The arrow::MemoryPool every writer and builder of one output table
+// allocates from. It forwards to the run's backend and keeps the bytes the
+// table holds now and at its peak, so the report can say which table the
+// memory went to. The parts of a partitioned table share one pool.
+class TablePool : public arrow::MemoryPool {
+public:
+  TablePool(std::string table, arrow::MemoryPool *backend,
+            MemoryAccounting &accounting);
+
+  // The overloads without an alignment stay visible.
+  using arrow::MemoryPool::Allocate;
+  using arrow::MemoryPool::Free;
+  using arrow::MemoryPool::Reallocate;
+
+  auto Allocate(int64_t size, int64_t alignment, uint8_t **out)
+      -> arrow::Status override;
+  auto Reallocate(int64_t old_size, int64_t new_size, int64_t alignment,
+                  uint8_t **ptr) -> arrow::Status override;
+  void Free(uint8_t *buffer, int64_t size, int64_t alignment) override;
+  void ReleaseUnused() override { backend_->ReleaseUnused(); }
+
+  [[nodiscard]] auto bytes_allocated() const -> int64_t override {
+    return bytes_.load();
+  }
+  [[nodiscard]] auto max_memory() const -> int64_t override {
+    return peak_.load();
+  }
+  [[nodiscard]] auto total_bytes_allocated() const -> int64_t override {
+    return total_.load();
+  }
+  [[nodiscard]] auto num_allocations() const -> int64_t override {
+    return allocations_.load();
+  }
+  [[nodiscard]] auto backend_name() const -> std::string override {
+    return backend_->backend_name();
+  }
+
+  [[nodiscard]] auto table() const -> const std::string & { return table_; }
+  // Row groups a builder cut short because the run was under pressure.
+  [[nodiscard]] auto early_flushes() const -> int64_t {
+    return early_flushes_.load();
+  }
+  // Returns the count including this one.
+  auto NoteEarlyFlush() -> int64_t { return ++early_flushes_; }
+
+  // Counts `delta` bytes held outside Arrow against this pool, for the parser
+  // maps that share the budget with the tables. Negative gives them back.
+  void Charge(int64_t delta) { Account(delta); }
+  // Times what this pool counts was moved to disk.
+  [[nodiscard]] auto spills() const -> int64_t { return spills_.load(); }
+  void NoteSpill() { ++spills_; }
+
+private:
+  void Account(int64_t delta);
+
+  std::string table_;
+  arrow::MemoryPool *backend_;
+  MemoryAccounting &accounting_;
+  std::atomic<int64_t> bytes_{0};
+  std::atomic<int64_t> peak_{0};
+  std::atomic<int64_t> total_{0};
+  std::atomic<int64_t> allocations_{0};
+  std::atomic<int64_t> early_flushes_{0};
+  std::atomic<int64_t> spills_{0};
+};
+
+// The run's memory, as its pools see it: current and peak bytes across all
+// of them, the peak within each stage, and the thresholds past which
+// builders flush their row groups early and the parser spills its maps.
+// What is counted is Arrow's allocations, the rows builders have staged and
+// the parser maps' estimated size, which are charged to pools of their own.
+class MemoryAccounting {
+public:
+  // Picks the allocator every pool forwards to: "default" (Arrow's own
+  // choice), "system", "jemalloc" or "mimalloc", the last two only where Arrow
+  // was built with them. Must come before the first pool is handed out.
+  void SetBackend(const std::string &name);
+
+  // The pool for `table`, made on first use; the pointer stays valid for the
+  // life of the process.
+  auto pool(const std::string &table) -> TablePool *;
+
+  // Closes the current stage's peak and starts measuring the next one's.
+  void EnterStage(const std::string &stage);
+
+  // Bytes across all pools past which under_pressure() holds; 0 never does.
+  void set_flush_threshold(int64_t bytes) { flush_threshold_.store(bytes); }
+  [[nodiscard]] auto flush_threshold() const -> int64_t {
+    return flush_threshold_.load();
+  }
+  [[nodiscard]] auto under_pressure() const -> bool {
+    const int64_t threshold = flush_threshold_.load();
+    return threshold > 0 && bytes_.load() >= threshold;
+  }
+
+  // The --max-memory budget; 0 is unbounded. Builders flush early from 3/4 of
+  // it and the parser spills from 9/10, which leaves room for what is not
+  // counted.
+  void set_budget(int64_t bytes);
+  [[nodiscard]] auto budget() const -> int64_t { return budget_.load(); }
+  [[nodiscard]] auto over_spill_threshold() const -> bool {
+    const int64_t threshold = spill_threshold_.load();
+    return threshold > 0 && bytes_.load() >= threshold;
+  }
+
+  [[nodiscard]] auto bytes_allocated() const -> int64_t {
+    return bytes_.load();
+  }
+  [[nodiscard]] auto peak() const -> int64_t { return peak_.load(); }
+
+  // The peak of each stage entered so far, the current one last.
+  [[nodiscard]] auto stage_peaks() const
+      -> std::vector<std::pair<std::string, int64_t>>;
+
+  // Logs the peaks: the run's, each stage's and each pool's, with the
+  // budget and the pools' early flushes and spills.
+  void Report() const;
+
+private:
+  friend class TablePool;
+  void Account(int64_t delta);
+
+  mutable std::mutex mutex_;
+  arrow::MemoryPool *backend_ = arrow::default_memory_pool();
+  std::map<std::string, std::unique_ptr<TablePool>> pools_;
+  std::vector<std::pair<std::string, int64_t>> finished_stages_;
+  std::string stage_;
+  std::atomic<int64_t> bytes_{0};
+  std::atomic<int64_t> peak_{0};
+  std::atomic<int64_t> stage_peak_{0};
+  std::atomic<int64_t> flush_threshold_{0};
+  std::atomic<int64_t> budget_{0};
+  std::atomic<int64_t> spill_threshold_{0};
+};
+
+// The process's accounting. Writers take their pools from it; main sets its
+// backend and stages, and process_logs its budget from OutputOptions.
+auto memory_accounting() -> MemoryAccounting &;
+
+// `bytes` as a short human-readable size, "512 B" up to "3.2 GiB".
+auto format_bytes(int64_t bytes) -> std::string;
+
+} // namespace charmvz
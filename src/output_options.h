@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace charmvz {
+
+enum class OutputFormat {
+  Parquet,
+  // The Arrow IPC file format, also known as Feather v2.
+  ArrowIpc,
+};
+
+enum class IpcCompression {
+  // Buffers are written as they sit in memory, so a reader that memory-maps
+  // the file uses them in place with nothing to decode.
+  None,
+  // LZ4 frame per buffer: smaller files, but every read decompresses, which
+  // gives up the zero-copy mmap.
+  Lz4,
+};
+
+// Switches that change how the output tables are laid out, or add a table
+// derived from the others, but never change what a table contains. Each one
+// defaults to the pipeline's original behaviour, so a caller that passes `{}`
+// gets exactly the files it always got.
+struct OutputOptions {
+  // Write execution ordered by (pe_id, start_time_us) and message by
+  // (src_pe, send_time_us), and declare that order in each file's Parquet
+  // `sorting_columns`. Clustered rows give min/max statistics something to
+  // prune and leave the delta encodings small differences to pack.
+  bool sorted = false;
+  // When positive, write execution, idle_interval and user_event as Hive-style
+  // datasets, `<table>/pe_bucket=K/part-0.parquet` with K = pe_id % buckets,
+  // each with a `_metadata` summary, and parse the buckets' logs concurrently,
+  // one thread and one writer per bucket. Stage 3 splits message the same way
+  // by src_pe and links the buckets concurrently. Zero keeps the single-file
+  // tables.
+  int32_t partition_buckets = 0;
+  // Parquet is the default. ArrowIpc trades file size for reads with no
+  // decode step; ipc_compression applies only to it.
+  OutputFormat format = OutputFormat::Parquet;
+  IpcCompression ipc_compression = IpcCompression::None;
+  // When set, this table goes to stdout as an Arrow IPC stream, one message
+  // per builder flush, so a consumer downstream of a pipe starts on the first
+  // batch while parsing continues. Every other table is written as usual,
+  // unless the output directory is kStdoutPath, in which case it is dropped.
+  std::string stream_table{};
+  // Also write papi_sample, execution's PAPI counters in long format: one row
+  // per counter per execution, whatever the number of counters.
+  bool papi_samples = false;
+  // Write execution and message with the narrowest types their values need:
+  // ep_id and msg_idx as uint16, durations and queue waits as int32, and
+  // absolute timestamps int64 but delta-encoded. Each row group is checked
+  // against the narrow ranges before it is written; a value that does not fit
+  // stops the run rather than wrapping.
+  bool compact_types = false;
+  // Also write time_profile, each PE's busy time per entry method and idle
+  // time in bins of this many microseconds; 0 writes no profile.
+  int64_t time_bin_us = 0;
+  // Also write a timeline pyramid of this many levels, the finest drawn with
+  // pixels of timeline_pixel_us microseconds and each next one four times
+  // coarser; 0 writes none.
+  int32_t timeline_levels = 0;
+  int64_t timeline_pixel_us = 10;
+  // Also write execution_index and idle_interval_index, per PE the rows'
+  // spans sorted by start with a running maximum end, so IntervalIndex can
+  // find the rows overlapping a window without scanning the PE.
+  bool interval_index = false;
+  // Also write critical_path and execution_slack: the longest chain of
+  // executions and messages in each simulation step, and how far every
+  // execution could slip without lengthening it. Keeps a span per execution
+  // in memory until Stage 3.
+  bool critical_path = false;
+  // Also write execution_graph/, the executions as a CSR graph whose edges are
+  // messages and same-PE succession, as .npy arrays with a node table. Keeps
+  // the same per-execution spans as critical_path.
+  bool execution_graph = false;
+  // The --max-memory budget in bytes, shared by the builders' staged rows and
+  // Arrow buffers and the parser's reconstruction maps; 0 is unbounded. Near
+  // it, builders flush row groups early and the parser moves its largest maps
+  // to disk, so Stage 3 reads them back a partition at a time.
+  int64_t max_memory_bytes = 0;
+};
+
+// The output "directory" that means: write nothing to disk, only the
+// streamed table.
+inline constexpr auto kStdoutPath = "-";
+
+} // namespace charmvz
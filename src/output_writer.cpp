@@ -0,0 +1,54 @@
+#include "output_writer.h"
+#include "ipc_writer.h"
+#include "memory_pool.h"
+#include <arrow/io/stdio.h>
+
+namespace charmvz {
+
+auto table_extension(OutputFormat format) -> std::string {
+  switch (format) {
+  case OutputFormat::ArrowIpc:
+    return ".arrow";
+  case OutputFormat::Parquet:
+    break;
+  }
+  return ".parquet";
+}
+
+auto open_table_writer(const std::string &output_dir, const std::string &table,
+                       std::shared_ptr<arrow::Schema> schema,
+                       const OutputOptions &options,
+                       const ParquetWriterOptions &parquet_options)
+    -> std::unique_ptr<TableWriter> {
+  arrow::MemoryPool *pool =
+      memory_accounting().pool(table.substr(0, table.find('/')));
+  if (!options.stream_table.empty() && table == options.stream_table) {
+    return std::make_unique<IpcWriter>(
+        std::move(schema), std::make_shared<arrow::io::StdoutStream>(),
+        IpcFraming::Stream, options.ipc_compression, pool);
+  }
+  if (output_dir == kStdoutPath) {
+    return std::make_unique<NullWriter>();
+  }
+
+  const std::string path =
+      output_dir + "/" + table + table_extension(options.format);
+  if (options.format == OutputFormat::ArrowIpc) {
+    return std::make_unique<IpcWriter>(std::move(schema), path,
+                                       options.ipc_compression, pool);
+  }
+  return std::make_unique<ParquetWriter>(std::move(schema), path,
+                                         parquet_options, pool);
+}
+
+auto bucket_part(int32_t bucket) -> std::string {
+  return "pe_bucket=" + std::to_string(bucket) + "/part-0";
+}
+
+auto parquet_footer(const TableWriter &writer)
+    -> std::shared_ptr<parquet::FileMetaData> {
+  const auto *parquet_writer = dynamic_cast<const ParquetWriter *>(&writer);
+  return parquet_writer ? parquet_writer->Metadata() : nullptr;
+}
+
+} // namespace charmvz
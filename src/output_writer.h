@@ -0,0 +1,38 @@
+#pragma once
+#include "output_options.h"
+#include "parquet_writer.h"
+#include "table_writer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace charmvz {
+
+// The file extension for a table written in `format`, with the leading dot.
+auto table_extension(OutputFormat format) -> std::string;
+
+// Opens the writer for `<output_dir>/<table>` in the format `options` selects,
+// adding the format's extension. `table` may carry a subdirectory, as the
+// parts of a partitioned dataset do. `parquet_options` apply only when the
+// format is Parquet: bloom filters, page indexes and sorting_columns have no
+// counterpart in Arrow IPC.
+//
+// The table named by `options.stream_table` goes to stdout instead, and when
+// `output_dir` is kStdoutPath every other table is discarded. The writer, and
+// the builders that take their pool from it, allocate from the table's pool
+// in memory_accounting(); the parts of a partitioned table share one.
+auto open_table_writer(const std::string &output_dir, const std::string &table,
+                       std::shared_ptr<arrow::Schema> schema,
+                       const OutputOptions &options,
+                       const ParquetWriterOptions &parquet_options = {})
+    -> std::unique_ptr<TableWriter>;
+
+// One bucket's part of a partitioned table, relative to the table's dataset
+// directory and without the format's extension.
+auto bucket_part(int32_t bucket) -> std::string;
+
+// The footer of a closed writer when it wrote Parquet; nullptr otherwise.
+auto parquet_footer(const TableWriter &writer)
+    -> std::shared_ptr<parquet::FileMetaData>;
+
+} // namespace charmvz
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace charmvz {
+
+// Runs `link(bucket)` for every bucket, each on a thread of its own when there
+// is more than one, and rethrows the first failure once all have finished.
+template <class Link> void for_each_bucket(int32_t buckets, Link link) {
+  if (buckets == 1) {
+    link(0);
+    return;
+  }
+  std::vector<std::exception_ptr> errors(buckets);
+  std::vector<std::thread> threads;
+  threads.reserve(buckets);
+  for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+    threads.emplace_back([&, bucket] {
+      try {
+        link(bucket);
+      } catch (...) {
+        errors[bucket] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (const auto &error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+}
+
+} // namespace charmvz
@@ -1,9 +1,12 @@
 #pragma once
+#include "table_writer.h"
 #include <arrow/api.h>
 #include <arrow/io/file.h>
 #include <memory>
 #include <parquet/arrow/writer.h>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace charmvz {
 
@@ -14,21 +17,66 @@ namespace charmvz {
 // pyarrow/polars without extra configuration.
 inline constexpr auto kDefaultCompression = parquet::Compression::ZSTD;
 
-class ParquetWriter {
+// Parquet's default data page is 1 MiB, which holds an entire 100,000-row
+// column chunk of int32 or int64 in a single page. The page index can only
+// skip pages, so at that size it has nothing to skip. 64 KiB splits a row
+// group's chunk into roughly 6-12 pages.
+inline constexpr int64_t kDataPageSize = 64 * 1024;
+
+// A bloom filter is sized up front from the number of distinct values it
+// expects per column chunk. A row group never holds more than ROW_GROUP_SIZE
+// rows, so that is the most distinct ids a chunk can carry.
+inline constexpr int32_t kBloomFilterNdv = 100000;
+
+struct ParquetWriterOptions {
+  parquet::Compression::type compression = kDefaultCompression;
+  // Columns that get a split-block bloom filter in every row group. Meant for
+  // high-cardinality ids that are filtered by equality and are not clustered,
+  // where min/max statistics span the whole domain and prune nothing.
+  std::vector<std::string> bloom_filter_columns;
+  // Columns the rows are ordered by, most significant first, recorded as the
+  // row groups' `sorting_columns`. The writer declares the order; it does not
+  // impose it, so the caller must already be emitting rows in this order.
+  std::vector<std::string> sorted_by;
+  // Integer columns written DELTA_BINARY_PACKED instead of dictionary/plain:
+  // timestamps that climb within a PE, whose successive differences are small.
+  std::vector<std::string> delta_encoded_columns;
+};
+
+class ParquetWriter : public TableWriter {
 public:
   ParquetWriter(std::shared_ptr<arrow::Schema> schema,
                 const std::string &file_path,
-                parquet::Compression::type compression = kDefaultCompression);
-  ~ParquetWriter();
+                const ParquetWriterOptions &options = {},
+                arrow::MemoryPool *pool = arrow::default_memory_pool());
+  ~ParquetWriter() override;
 
-  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch);
-  void Close();
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) override;
+  void Close() override;
+  [[nodiscard]] auto pool() const -> arrow::MemoryPool * override {
+    return pool_;
+  }
+  // The footer that was written, row-group statistics included. Only
+  // available once the writer is closed; nullptr before.
+  [[nodiscard]] auto Metadata() const -> std::shared_ptr<parquet::FileMetaData>;
 
 private:
   std::shared_ptr<arrow::Schema> schema_;
+  arrow::MemoryPool *pool_;
   std::shared_ptr<arrow::io::FileOutputStream> out_stream_;
   std::unique_ptr<parquet::arrow::FileWriter> writer_;
   bool closed_ = false;
 };
 
+// Writes `<dataset_dir>/_metadata`: the footers of every part of a
+// partitioned table merged into one, each row group pointing at its part by a
+// path relative to `dataset_dir`. A reader plans a scan over the whole dataset
+// from this single file instead of opening every part for its footer. `parts`
+// pairs each relative path with the Metadata() of the closed writer for it.
+void write_metadata_summary(
+    const std::string &dataset_dir,
+    const std::vector<std::pair<std::string,
+                                std::shared_ptr<parquet::FileMetaData>>>
+        &parts);
+
 } // namespace charmvz
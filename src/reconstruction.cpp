@@ -1,161 +1,309 @@
 #include "reconstruction.h"
-#include "parquet_writer.h"
+#include "comm_graph.h"
+#include "output_writer.h"
+#include "parallel.h"
 #include "schema.h"
+#include "spill.h"
+#include "table_builder.h"
 #include <algorithm>
-#include <arrow/builder.h>
+#include <deque>
+#include <filesystem>
 #include <map>
+#include <optional>
 #include <spdlog/spdlog.h>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace charmvz {
 
-void reconstruct_message_and_migration(const LogParserResult &log_data,
-                                       const StsData &sts_data,
-                                       const RcData &rc_data,
-                                       const std::string &output_dir) {
-  spdlog::info("Starting Stage 3 reconstruction message and migrations");
+namespace {
 
-  // ProcessingElements
-  ParquetWriter pe_writer(charmvz::schema::processing_element(),
-                          output_dir + "/processing_element.parquet");
-  arrow::Int32Builder pe_pe_id, pe_total_pes;
-  arrow::Int64Builder pe_begin, pe_end, pe_global, pe_dur, pe_align;
+// The Stage 3 tables' rows, one field per column of the matching schema::
+// function.
 
-  for (const auto &pe : log_data.pes) {
-    PARQUET_THROW_NOT_OK(pe_pe_id.Append(pe.pe_id));
-    PARQUET_THROW_NOT_OK(pe_total_pes.Append(pe.total_pes));
-    PARQUET_THROW_NOT_OK(
-        pe_begin.Append(pe.begin_time_us - rc_data.global_start_time_us));
-    if (pe.end_time_us > 0) {
-      PARQUET_THROW_NOT_OK(
-          pe_end.Append(pe.end_time_us - rc_data.global_start_time_us));
-      PARQUET_THROW_NOT_OK(pe_dur.Append(pe.end_time_us - pe.begin_time_us));
-    } else {
-      PARQUET_THROW_NOT_OK(pe_end.AppendNull());
-      PARQUET_THROW_NOT_OK(pe_dur.AppendNull());
-    }
-    PARQUET_THROW_NOT_OK(pe_global.Append(pe.global_start_us));
-    PARQUET_THROW_NOT_OK(
-        pe_align.Append(pe.begin_time_us - pe.global_start_us));
+struct ProcessingElementRow {
+  int32_t pe_id;
+  int32_t total_pes;
+  int64_t begin_time_us;
+  std::optional<int64_t> end_time_us;
+  int64_t global_start_us;
+  std::optional<int64_t> computation_duration_us;
+  int64_t aligned_begin_us;
+};
+
+struct MessageRow {
+  int64_t message_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t ep_id;
+  int32_t msg_idx;
+  int32_t msg_len;
+  int64_t send_time_us;
+  std::optional<int64_t> enqueue_time_us;
+  bool is_broadcast;
+  std::optional<int32_t> broadcast_fanout;
+  std::optional<int32_t> dst_pe;
+  std::optional<int64_t> recv_time_us;
+  std::optional<int64_t> exec_start_time_us;
+  std::optional<int64_t> send_to_enqueue_us;
+  std::optional<int64_t> enqueue_to_exec_us;
+  std::optional<int64_t> end_to_end_us;
+  std::optional<int32_t> step_id;
+  std::optional<int32_t> sender_event;
+  std::optional<int32_t> sender_ep_id;
+  std::optional<int64_t> sender_instance_id;
+};
+
+struct MessageDeliveryRow {
+  int64_t message_id;
+  int32_t src_pe;
+  int32_t event;
+  int32_t dst_pe;
+  int64_t send_time_us;
+  std::optional<int64_t> recv_time_us;
+  std::optional<int64_t> exec_start_time_us;
+};
+
+struct MigrationEpisodeRow {
+  int64_t migration_id;
+  int64_t instance_id;
+  int32_t collection_id;
+  int32_t src_pe;
+  int32_t dst_pe;
+  int64_t last_exec_end_src_us;
+  int64_t first_exec_start_dst_us;
+  int64_t gap_us;
+  int32_t migration_seq;
+};
+
+struct SimulationStepRow {
+  int32_t step_id;
+  int32_t pe_id;
+  int64_t start_time_us;
+  std::optional<int64_t> end_time_us;
+  std::optional<int64_t> duration_us;
+  int64_t global_start_time_us;
+  std::optional<int64_t> global_end_time_us;
+  int32_t pe_count;
+};
+
+} // namespace
+
+template <> struct builders::RowDescriptor<ProcessingElementRow> {
+  using R = ProcessingElementRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::pe_id, &R::total_pes, &R::begin_time_us, &R::end_time_us,
+      &R::global_start_us, &R::computation_duration_us, &R::aligned_begin_us);
+};
+
+template <> struct builders::RowDescriptor<MessageRow> {
+  using R = MessageRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::message_id, &R::src_pe, &R::event, &R::ep_id, &R::msg_idx,
+      &R::msg_len, &R::send_time_us, &R::enqueue_time_us, &R::is_broadcast,
+      &R::broadcast_fanout, &R::dst_pe, &R::recv_time_us,
+      &R::exec_start_time_us, &R::send_to_enqueue_us, &R::enqueue_to_exec_us,
+      &R::end_to_end_us, &R::step_id, &R::sender_event, &R::sender_ep_id,
+      &R::sender_instance_id);
+};
+
+template <> struct builders::RowDescriptor<MessageDeliveryRow> {
+  using R = MessageDeliveryRow;
+  static constexpr auto columns =
+      std::make_tuple(&R::message_id, &R::src_pe, &R::event, &R::dst_pe,
+                      &R::send_time_us, &R::recv_time_us,
+                      &R::exec_start_time_us);
+};
+
+template <> struct builders::RowDescriptor<MigrationEpisodeRow> {
+  using R = MigrationEpisodeRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::migration_id, &R::instance_id, &R::collection_id, &R::src_pe,
+      &R::dst_pe, &R::last_exec_end_src_us, &R::first_exec_start_dst_us,
+      &R::gap_us, &R::migration_seq);
+};
+
+template <> struct builders::RowDescriptor<SimulationStepRow> {
+  using R = SimulationStepRow;
+  static constexpr auto columns = std::make_tuple(
+      &R::step_id, &R::pe_id, &R::start_time_us, &R::end_time_us,
+      &R::duration_us, &R::global_start_time_us, &R::global_end_time_us,
+      &R::pe_count);
+};
+
+namespace {
+
+using CreationEntry = CreationMap::value_type;
+
+// The communication totals one linking thread fills on its own.
+struct BucketComm {
+  EpCommGraph ep;
+  PeCommMatrix pe;
+};
+
+// Holds one linking thread's batches of a single-file table until the
+// threads before it have written theirs, so the file is in sender order
+// whichever thread finishes first.
+class StagedBatches : public TableWriter {
+public:
+  explicit StagedBatches(TableWriter &target) : target_(target) {}
+
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) override {
+    batches_.push_back(std::move(batch));
   }
-  if (pe_pe_id.length() > 0) {
-    std::shared_ptr<arrow::Array> a_pe, a_total, a_b, a_e, a_g, a_d, a_a;
-    PARQUET_THROW_NOT_OK(pe_pe_id.Finish(&a_pe));
-    PARQUET_THROW_NOT_OK(pe_total_pes.Finish(&a_total));
-    PARQUET_THROW_NOT_OK(pe_begin.Finish(&a_b));
-    PARQUET_THROW_NOT_OK(pe_end.Finish(&a_e));
-    PARQUET_THROW_NOT_OK(pe_global.Finish(&a_g));
-    PARQUET_THROW_NOT_OK(pe_dur.Finish(&a_d));
-    PARQUET_THROW_NOT_OK(pe_align.Finish(&a_a));
-    auto batch = arrow::RecordBatch::Make(
-        charmvz::schema::processing_element(), a_pe->length(),
-        {a_pe, a_total, a_b, a_e, a_g, a_d, a_a});
-    pe_writer.WriteBatch(batch);
+  void Close() override {}
+  [[nodiscard]] auto pool() const -> arrow::MemoryPool * override {
+    return target_.pool();
   }
 
-  // Messages
-  ParquetWriter msg_writer(charmvz::schema::message(),
-                           output_dir + "/message.parquet");
-  arrow::Int64Builder m_id, m_send, m_enq, m_recv, m_exec, m_s2e, m_e2e,
-      m_end2end;
-  arrow::Int32Builder m_src, m_evt, m_ep, m_idx, m_len, m_fan, m_dst;
-  arrow::BooleanBuilder m_bcast;
+  // Writes the batches held so far to the table's writer.
+  void Forward() {
+    for (auto &batch : batches_)
+      target_.WriteBatch(std::move(batch));
+    batches_.clear();
+  }
 
-  int64_t msg_count = 0;
-  auto flush_msg = [&]() {
-    if (m_id.length() == 0)
-      return;
-    std::vector<std::shared_ptr<arrow::Array>> arrs(16);
-    PARQUET_THROW_NOT_OK(m_id.Finish(&arrs[0]));
-    PARQUET_THROW_NOT_OK(m_src.Finish(&arrs[1]));
-    PARQUET_THROW_NOT_OK(m_evt.Finish(&arrs[2]));
-    PARQUET_THROW_NOT_OK(m_ep.Finish(&arrs[3]));
-    PARQUET_THROW_NOT_OK(m_idx.Finish(&arrs[4]));
-    PARQUET_THROW_NOT_OK(m_len.Finish(&arrs[5]));
-    PARQUET_THROW_NOT_OK(m_send.Finish(&arrs[6]));
-    PARQUET_THROW_NOT_OK(m_enq.Finish(&arrs[7]));
-    PARQUET_THROW_NOT_OK(m_bcast.Finish(&arrs[8]));
-    PARQUET_THROW_NOT_OK(m_fan.Finish(&arrs[9]));
-    PARQUET_THROW_NOT_OK(m_dst.Finish(&arrs[10]));
-    PARQUET_THROW_NOT_OK(m_recv.Finish(&arrs[11]));
-    PARQUET_THROW_NOT_OK(m_exec.Finish(&arrs[12]));
-    PARQUET_THROW_NOT_OK(m_s2e.Finish(&arrs[13]));
-    PARQUET_THROW_NOT_OK(m_e2e.Finish(&arrs[14]));
-    PARQUET_THROW_NOT_OK(m_end2end.Finish(&arrs[15]));
-    auto batch = arrow::RecordBatch::Make(charmvz::schema::message(),
-                                          arrs[0]->length(), arrs);
-    msg_writer.WriteBatch(batch);
-  };
+private:
+  TableWriter &target_;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches_;
+};
 
-  for (const auto &kv : log_data.creation_map) {
-    msg_count++;
+// Splits `creations` among `threads` linking threads by the thread
+// `thread_of` gives each src_pe. The one pass over the map that stays serial;
+// the lookups and rows are left to the threads.
+template <class ThreadOf>
+auto plan_messages(const CreationMap &creations, int32_t threads,
+                   ThreadOf thread_of)
+    -> std::vector<std::vector<const CreationEntry *>> {
+  std::vector<std::vector<const CreationEntry *>> plan(threads);
+  for (const auto &kv : creations)
+    plan[thread_of(std::get<0>(kv.first))].push_back(&kv);
+  return plan;
+}
+
+// Appends a row per creation of one thread's share to `builder`, and one per
+// PE it reached to `deliveries`, and adds each to the thread's `comm` totals.
+// The creation map is a hash map, so its iteration
+// order is arbitrary. Sorted output orders the share by sender and send time;
+// the event id breaks ties so the order is the same on every run. message_id
+// comes from the key alone, so it is the same in any order and matches the
+// execution rows that received the message.
+void append_messages(std::vector<const CreationEntry *> &creations,
+                     const BeginProcessingMap &begins, const RcData &rc_data,
+                     bool sorted, builders::TableBuilder<MessageRow> &builder,
+                     builders::TableBuilder<MessageDeliveryRow> &deliveries,
+                     BucketComm &comm) {
+  if (sorted) {
+    std::sort(creations.begin(), creations.end(),
+              [](const CreationEntry *a, const CreationEntry *b) {
+                return std::make_tuple(std::get<0>(a->first),
+                                       a->second.send_time_us,
+                                       std::get<1>(a->first)) <
+                       std::make_tuple(std::get<0>(b->first),
+                                       b->second.send_time_us,
+                                       std::get<1>(b->first));
+              });
+  }
+
+  std::vector<MessageDeliveryRow> reached;
+  for (const CreationEntry *entry : creations) {
+    const auto &kv = *entry;
     auto src_pe = std::get<0>(kv.first);
     auto event = std::get<1>(kv.first);
     const auto &cr = kv.second;
 
-    PARQUET_THROW_NOT_OK(m_id.Append(msg_count));
-    PARQUET_THROW_NOT_OK(m_src.Append(src_pe));
-    PARQUET_THROW_NOT_OK(m_evt.Append(event));
-    PARQUET_THROW_NOT_OK(m_ep.Append(cr.ep_id));
-    PARQUET_THROW_NOT_OK(m_idx.Append(cr.msg_idx));
-    PARQUET_THROW_NOT_OK(m_len.Append(cr.msg_len));
-    PARQUET_THROW_NOT_OK(
-        m_send.Append(cr.send_time_us - rc_data.global_start_time_us));
-    if (cr.enqueue_time_us > 0) {
-      PARQUET_THROW_NOT_OK(
-          m_enq.Append(cr.enqueue_time_us - rc_data.global_start_time_us));
-    } else {
-      PARQUET_THROW_NOT_OK(m_enq.AppendNull());
+    MessageRow row{};
+    row.message_id = make_message_id(src_pe, event);
+    row.src_pe = src_pe;
+    row.event = event;
+    row.ep_id = cr.ep_id;
+    row.msg_idx = cr.msg_idx;
+    row.msg_len = cr.msg_len;
+    row.send_time_us = cr.send_time_us - rc_data.global_start_time_us;
+    if (cr.enqueue_time_us > 0)
+      row.enqueue_time_us = cr.enqueue_time_us - rc_data.global_start_time_us;
+    row.is_broadcast = cr.is_broadcast;
+    row.broadcast_fanout = cr.broadcast_fanout;
+    row.step_id = cr.step_id;
+    if (cr.sender) {
+      row.sender_event = cr.sender->event;
+      row.sender_ep_id = cr.sender->ep_id;
+      if (cr.sender->instance_id >= 0)
+        row.sender_instance_id = cr.sender->instance_id;
     }
-    PARQUET_THROW_NOT_OK(m_bcast.Append(cr.is_broadcast));
-    PARQUET_THROW_NOT_OK(m_fan.Append(cr.broadcast_fanout));
-
-    auto bp_it = log_data.begin_processing_map.find(kv.first);
-    if (bp_it != log_data.begin_processing_map.end()) {
-      PARQUET_THROW_NOT_OK(m_dst.Append(bp_it->second.dst_pe));
-      PARQUET_THROW_NOT_OK(m_recv.Append(bp_it->second.recv_time_us -
-                                         rc_data.global_start_time_us));
-      PARQUET_THROW_NOT_OK(m_exec.Append(bp_it->second.exec_start_time_us -
-                                         rc_data.global_start_time_us));
-      PARQUET_THROW_NOT_OK(m_s2e.AppendNull());
-      PARQUET_THROW_NOT_OK(m_e2e.AppendNull());
-      PARQUET_THROW_NOT_OK(m_end2end.AppendNull());
-    } else {
-      PARQUET_THROW_NOT_OK(m_dst.AppendNull());
-      PARQUET_THROW_NOT_OK(m_recv.AppendNull());
-      PARQUET_THROW_NOT_OK(m_exec.AppendNull());
-      PARQUET_THROW_NOT_OK(m_s2e.AppendNull());
-      PARQUET_THROW_NOT_OK(m_e2e.AppendNull());
-      PARQUET_THROW_NOT_OK(m_end2end.AppendNull());
+
+    // Every PE that ran the message, and those a multicast listed that did
+    // not; ordered by PE, with a PE's receipt ahead of its listing and its
+    // earliest receipt first, so the first row of each PE is the one kept.
+    reached.clear();
+    begins.ForEach(kv.first, [&](const BeginProcessingRecord &bp) {
+      reached.push_back({row.message_id, src_pe, event, bp.dst_pe,
+                         row.send_time_us,
+                         bp.recv_time_us - rc_data.global_start_time_us,
+                         bp.exec_start_time_us - rc_data.global_start_time_us});
+    });
+    for (const int32_t pe : cr.dst_pes) {
+      reached.push_back({row.message_id, src_pe, event, pe, row.send_time_us,
+                         std::nullopt, std::nullopt});
     }
+    std::sort(reached.begin(), reached.end(),
+              [](const MessageDeliveryRow &a, const MessageDeliveryRow &b) {
+                return std::make_tuple(a.dst_pe, !a.exec_start_time_us,
+                                       a.exec_start_time_us) <
+                       std::make_tuple(b.dst_pe, !b.exec_start_time_us,
+                                       b.exec_start_time_us);
+              });
 
-    if (m_id.length() >= 100000)
-      flush_msg();
+    // message names the receiver that ran the message first, the lowest PE
+    // among those that started it at once. The receipts reach the map in the
+    // order the shards merged or spilled, which varies between runs.
+    const MessageDeliveryRow *first = nullptr;
+    for (const MessageDeliveryRow &delivery : reached) {
+      if (delivery.exec_start_time_us &&
+          (first == nullptr ||
+           *delivery.exec_start_time_us < *first->exec_start_time_us))
+        first = &delivery;
+    }
+    if (first != nullptr) {
+      row.dst_pe = first->dst_pe;
+      row.recv_time_us = first->recv_time_us;
+      row.exec_start_time_us = first->exec_start_time_us;
+    }
+    builder.Append(row);
+    CommTotals &totals = comm.ep.At(
+        cr.sender ? cr.sender->ep_id : EpCommGraph::kNoSender, cr.ep_id);
+    totals.AddMessage(cr.msg_len);
+    for (size_t i = 0; i < reached.size(); ++i) {
+      const MessageDeliveryRow &delivery = reached[i];
+      if (i > 0 && delivery.dst_pe == reached[i - 1].dst_pe)
+        continue;
+      deliveries.Append(delivery);
+      std::optional<int64_t> latency_us;
+      if (delivery.exec_start_time_us) {
+        latency_us = *delivery.exec_start_time_us - delivery.send_time_us;
+        totals.AddDelivery(*latency_us);
+      }
+      comm.pe.Add(src_pe, delivery.dst_pe, delivery.send_time_us, cr.msg_len,
+                  latency_us);
+    }
   }
-  flush_msg();
-
-  // MigrationEpisode (Rule 9): a migration is a change of PE between two
-  // consecutive executions of the same chare-array instance. Pack/unpack events
-  // are not involved -- see the comment on schema::migration_episode().
-  ParquetWriter mig_writer(charmvz::schema::migration_episode(),
-                           output_dir + "/migration_episode.parquet");
-  spdlog::info("Writing MigrationEpisode.parquet");
-
-  arrow::Int64Builder mig_id, mig_inst, src_end, dst_start, gap;
-  arrow::Int32Builder mig_coll, mig_src, mig_dst, mig_seq;
+}
 
-  // Group executions by instance, then order each instance's executions in
-  // time. Timestamps are already aligned to the global start, so they are
-  // comparable across PEs.
+// Appends a row per migration among `instance_locations` to `builder`,
+// numbering from `migration_id`. Executions are grouped by instance, then each
+// instance's are ordered in time. Timestamps are already aligned to the global
+// start, so they are comparable across PEs.
+void append_migrations(
+    const std::vector<InstanceLocationRecord> &instance_locations,
+    builders::TableBuilder<MigrationEpisodeRow> &builder,
+    int64_t &migration_id) {
   std::unordered_map<int64_t, std::vector<const InstanceLocationRecord *>>
       by_instance;
-  for (const auto &loc : log_data.instance_locations)
+  for (const auto &loc : instance_locations)
     by_instance[loc.instance_id].push_back(&loc);
 
-  int64_t migration_id = 0;
-
   for (auto &[instance_id, locations] : by_instance) {
     std::sort(
         locations.begin(), locations.end(),
@@ -172,40 +320,237 @@ void reconstruct_message_and_migration(const LogParserResult &log_data,
 
       ++migration_id;
       ++sequence;
-      PARQUET_THROW_NOT_OK(mig_id.Append(migration_id));
-      PARQUET_THROW_NOT_OK(mig_inst.Append(instance_id));
-      PARQUET_THROW_NOT_OK(mig_coll.Append(current->collection_id));
-      PARQUET_THROW_NOT_OK(mig_src.Append(previous->pe_id));
-      PARQUET_THROW_NOT_OK(mig_dst.Append(current->pe_id));
-      PARQUET_THROW_NOT_OK(src_end.Append(previous->end_time_us));
-      PARQUET_THROW_NOT_OK(dst_start.Append(current->start_time_us));
-      PARQUET_THROW_NOT_OK(
-          gap.Append(current->start_time_us - previous->end_time_us));
-      PARQUET_THROW_NOT_OK(mig_seq.Append(sequence));
+      builder.Append({migration_id, instance_id, current->collection_id,
+                      previous->pe_id, current->pe_id, previous->end_time_us,
+                      current->start_time_us,
+                      current->start_time_us - previous->end_time_us,
+                      sequence});
     }
   }
+}
+
+} // namespace
+
+void reconstruct_message_and_migration(const LogParserResult &log_data,
+                                       const StsData &sts_data,
+                                       const RcData &rc_data,
+                                       const std::string &output_dir,
+                                       const OutputOptions &options) {
+  spdlog::info("Starting Stage 3 reconstruction message and migrations");
+
+  // ProcessingElements
+  auto pe_writer =
+      open_table_writer(output_dir, "processing_element",
+                        charmvz::schema::processing_element(), options);
+  builders::TableBuilder<ProcessingElementRow> pe_builder(
+      *pe_writer, charmvz::schema::processing_element());
+
+  for (const auto &pe : log_data.pes) {
+    ProcessingElementRow row{};
+    row.pe_id = pe.pe_id;
+    row.total_pes = pe.total_pes;
+    row.begin_time_us = pe.begin_time_us - rc_data.global_start_time_us;
+    if (pe.end_time_us > 0) {
+      row.end_time_us = pe.end_time_us - rc_data.global_start_time_us;
+      row.computation_duration_us = pe.end_time_us - pe.begin_time_us;
+    }
+    row.global_start_us = pe.global_start_us;
+    row.aligned_begin_us = pe.begin_time_us - pe.global_start_us;
+    pe_builder.Append(row);
+  }
+  pe_builder.Flush();
+
+  // Messages
+  ParquetWriterOptions msg_options;
+  msg_options.bloom_filter_columns =
+      charmvz::schema::message_bloom_filter_columns();
+  if (options.sorted) {
+    msg_options.sorted_by = {"src_pe", "send_time_us"};
+  }
+  if (options.compact_types) {
+    msg_options.delta_encoded_columns =
+        charmvz::schema::message_delta_columns();
+  }
+  ParquetWriterOptions delivery_options;
+  if (options.sorted) {
+    delivery_options.sorted_by = {"src_pe", "send_time_us"};
+  }
+  const auto msg_schema = charmvz::schema::message(options.compact_types);
+  const auto delivery_schema = charmvz::schema::message_delivery();
+  // Under --partition-buckets message and message_delivery are split by
+  // src_pe like execution is by pe_id, and each bucket is linked on its own
+  // thread into its own writers. A single file is linked on as many threads
+  // as the hardware runs, each taking a contiguous range of senders and
+  // staging its batches, which are written in thread order.
+  const bool partitioned = options.partition_buckets > 0;
+  const int32_t buckets = partitioned ? options.partition_buckets : 1;
+  const int32_t threads =
+      partitioned ? buckets
+                  : static_cast<int32_t>(
+                        std::max(1U, std::thread::hardware_concurrency()));
+  auto thread_of = [&](int32_t src_pe) -> size_t {
+    if (partitioned)
+      return static_cast<uint32_t>(src_pe) % buckets;
+    const int64_t range = static_cast<int64_t>(src_pe) * threads /
+                          std::max(1, sts_data.total_pes);
+    return static_cast<size_t>(std::clamp<int64_t>(range, 0, threads - 1));
+  };
+  auto open_buckets = [&](const std::string &name, const auto &schema,
+                          const ParquetWriterOptions &writer_options,
+                          auto &writers, auto &staged, auto &table_builders) {
+    for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+      std::string table = name;
+      if (partitioned) {
+        table += "/" + bucket_part(bucket);
+        if (output_dir != kStdoutPath) {
+          std::filesystem::create_directories(
+              (std::filesystem::path(output_dir) / table).parent_path());
+        }
+      }
+      writers.push_back(open_table_writer(output_dir, table, schema, options,
+                                          writer_options));
+      if (partitioned)
+        table_builders.emplace_back(*writers.back(), schema);
+    }
+    for (int32_t thread = 0; !partitioned && thread < threads; ++thread) {
+      staged.emplace_back(*writers.front());
+      table_builders.emplace_back(staged.back(), schema);
+    }
+  };
+  // A single file's threads have already forwarded everything they staged.
+  auto close_buckets = [&](const std::string &name, auto &writers,
+                           auto &table_builders) {
+    std::vector<
+        std::pair<std::string, std::shared_ptr<parquet::FileMetaData>>>
+        parts;
+    for (int32_t bucket = 0; bucket < buckets; ++bucket) {
+      if (partitioned)
+        table_builders[bucket].Flush();
+      writers[bucket]->Close();
+      parts.emplace_back(bucket_part(bucket) + ".parquet",
+                         parquet_footer(*writers[bucket]));
+    }
+    if (partitioned && options.format == OutputFormat::Parquet)
+      write_metadata_summary(output_dir + "/" + name, parts);
+  };
+  std::vector<std::unique_ptr<TableWriter>> msg_writers;
+  std::vector<std::unique_ptr<TableWriter>> delivery_writers;
+  // Deques, so a builder stays where its thread finds it and a staged
+  // writer where its builder does.
+  std::deque<StagedBatches> msg_staged;
+  std::deque<StagedBatches> delivery_staged;
+  std::deque<builders::TableBuilder<MessageRow>> msg_builders;
+  std::deque<builders::TableBuilder<MessageDeliveryRow>> delivery_builders;
+  open_buckets("message", msg_schema, msg_options, msg_writers, msg_staged,
+               msg_builders);
+  open_buckets("message_delivery", delivery_schema, delivery_options,
+               delivery_writers, delivery_staged, delivery_builders);
+  // Each linking thread totals its messages per entry-method pair and per PE
+  // pair on its own.
+  const int32_t dense_pes = PeCommMatrix::DensePes(
+      sts_data.total_pes, threads, options.time_bin_us);
+  std::vector<BucketComm> comm;
+  comm.reserve(static_cast<size_t>(threads));
+  for (int32_t thread = 0; thread < threads; ++thread) {
+    comm.push_back(
+        {EpCommGraph(), PeCommMatrix(dense_pes, options.time_bin_us)});
+  }
+  int64_t msg_count = 0;
+  auto link = [&](const CreationMap &creations,
+                  const BeginProcessingMap &begins) {
+    auto plan = plan_messages(creations, threads, thread_of);
+    msg_count += static_cast<int64_t>(creations.size());
+    for_each_bucket(threads, [&](int32_t thread) {
+      append_messages(plan[thread], begins, rc_data, options.sorted,
+                      msg_builders[thread], delivery_builders[thread],
+                      comm[thread]);
+    });
+    for (int32_t thread = 0; !partitioned && thread < threads; ++thread) {
+      msg_builders[thread].Flush();
+      msg_staged[thread].Forward();
+      delivery_builders[thread].Flush();
+      delivery_staged[thread].Forward();
+    }
+  };
+
+  // A spilled parse left its inputs on disk, partitioned by contiguous ranges
+  // of sender; walking the partitions in order keeps the sorted order as it
+  // would be in memory.
+  if (log_data.spill) {
+    for (int32_t part = 0; part < SpillStore::kPartitions; ++part) {
+      CreationMap creations;
+      BeginProcessingMap begins;
+      log_data.spill->Load(part, creations);
+      log_data.spill->Load(part, begins);
+      link(creations, begins);
+    }
+  } else {
+    link(log_data.creation_map, log_data.begin_processing_map);
+  }
+  close_buckets("message", msg_writers, msg_builders);
+  close_buckets("message_delivery", delivery_writers, delivery_builders);
+  int64_t delivery_count = 0;
+  for (const auto &builder : delivery_builders)
+    delivery_count += builder.total_rows();
+  spdlog::info("Linked {} messages in {} bucket(s) on {} thread(s), {} "
+               "deliveries",
+               msg_count, buckets, threads, delivery_count);
+
+  for (int32_t thread = 1; thread < threads; ++thread) {
+    comm[0].ep.Merge(comm[thread].ep);
+    comm[0].pe.Merge(comm[thread].pe);
+  }
+  const auto comm_schema = charmvz::schema::ep_comm_graph();
+  auto comm_writer =
+      open_table_writer(output_dir, "ep_comm_graph", comm_schema, options);
+  builders::TableBuilder<EpCommGraphRow> comm_builder(*comm_writer,
+                                                      comm_schema);
+  comm[0].ep.AppendTo(sts_data, comm_builder);
+  comm_builder.Flush();
+
+  const auto matrix_schema =
+      charmvz::schema::pe_comm_matrix(options.time_bin_us);
+  auto matrix_writer =
+      open_table_writer(output_dir, "pe_comm_matrix", matrix_schema, options);
+  builders::TableBuilder<PeCommMatrixRow> matrix_builder(*matrix_writer,
+                                                         matrix_schema);
+  for (const PeCommMatrixRow &row : comm[0].pe.Rows())
+    matrix_builder.Append(row);
+  matrix_builder.Flush();
+  spdlog::info("Wrote pe_comm_matrix, {} rows ({})",
+               matrix_builder.total_rows(),
+               dense_pes > 0 ? "dense" : "sparse");
+
+  // MigrationEpisode (Rule 9): a migration is a change of PE between two
+  // consecutive executions of the same chare-array instance. Pack/unpack events
+  // are not involved -- see the comment on schema::migration_episode().
+  auto mig_writer =
+      open_table_writer(output_dir, "migration_episode",
+                        charmvz::schema::migration_episode(), options);
+  spdlog::info("Writing MigrationEpisode");
 
-  if (mig_id.length() > 0) {
-    std::vector<std::shared_ptr<arrow::Array>> arrays(9);
-    PARQUET_THROW_NOT_OK(mig_id.Finish(&arrays[0]));
-    PARQUET_THROW_NOT_OK(mig_inst.Finish(&arrays[1]));
-    PARQUET_THROW_NOT_OK(mig_coll.Finish(&arrays[2]));
-    PARQUET_THROW_NOT_OK(mig_src.Finish(&arrays[3]));
-    PARQUET_THROW_NOT_OK(mig_dst.Finish(&arrays[4]));
-    PARQUET_THROW_NOT_OK(src_end.Finish(&arrays[5]));
-    PARQUET_THROW_NOT_OK(dst_start.Finish(&arrays[6]));
-    PARQUET_THROW_NOT_OK(gap.Finish(&arrays[7]));
-    PARQUET_THROW_NOT_OK(mig_seq.Finish(&arrays[8]));
-    auto batch = arrow::RecordBatch::Make(charmvz::schema::migration_episode(),
-                                          arrays[0]->length(), arrays);
-    mig_writer.WriteBatch(batch);
+  builders::TableBuilder<MigrationEpisodeRow> mig_builder(
+      *mig_writer, charmvz::schema::migration_episode());
+
+  int64_t migration_id = 0;
+  if (log_data.spill) {
+    for (int32_t part = 0; part < SpillStore::kPartitions; ++part) {
+      std::vector<InstanceLocationRecord> locations;
+      log_data.spill->Load(part, locations);
+      append_migrations(locations, mig_builder, migration_id);
+    }
+  } else {
+    append_migrations(log_data.instance_locations, mig_builder, migration_id);
   }
+  mig_builder.Flush();
 }
 
 void reconstruct_simulation_steps(const LogParserResult &log_data,
-                                  const std::string &output_dir) {
-  ParquetWriter step_writer(charmvz::schema::simulation_step(),
-                            output_dir + "/simulation_step.parquet");
+                                  const std::string &output_dir,
+                                  const OutputOptions &options) {
+  auto step_writer =
+      open_table_writer(output_dir, "simulation_step",
+                        charmvz::schema::simulation_step(), options);
 
   if (log_data.step_boundaries.empty()) {
     spdlog::info("No step-boundary user events found; "
@@ -268,44 +613,26 @@ void reconstruct_simulation_steps(const LogParserResult &log_data,
     ++it->second.pe_count;
   }
 
-  arrow::Int32Builder step_id, pe_id, pe_count;
-  arrow::Int64Builder start_us, end_us, duration_us, global_start_us,
-      global_end_us;
+  builders::TableBuilder<SimulationStepRow> step_builder(
+      *step_writer, charmvz::schema::simulation_step());
 
   for (const auto &[key, extent] : per_pe) {
     const auto &global = per_step.at(key.first);
-    PARQUET_THROW_NOT_OK(step_id.Append(key.first));
-    PARQUET_THROW_NOT_OK(pe_id.Append(key.second));
-    PARQUET_THROW_NOT_OK(start_us.Append(extent.start_us));
+    SimulationStepRow row{};
+    row.step_id = key.first;
+    row.pe_id = key.second;
+    row.start_time_us = extent.start_us;
     if (extent.has_end) {
-      PARQUET_THROW_NOT_OK(end_us.Append(extent.end_us));
-      PARQUET_THROW_NOT_OK(duration_us.Append(extent.end_us - extent.start_us));
-    } else {
-      PARQUET_THROW_NOT_OK(end_us.AppendNull());
-      PARQUET_THROW_NOT_OK(duration_us.AppendNull());
+      row.end_time_us = extent.end_us;
+      row.duration_us = extent.end_us - extent.start_us;
     }
-    PARQUET_THROW_NOT_OK(global_start_us.Append(global.start_us));
-    if (global.has_end) {
-      PARQUET_THROW_NOT_OK(global_end_us.Append(global.end_us));
-    } else {
-      PARQUET_THROW_NOT_OK(global_end_us.AppendNull());
-    }
-    PARQUET_THROW_NOT_OK(pe_count.Append(global.pe_count));
+    row.global_start_time_us = global.start_us;
+    if (global.has_end)
+      row.global_end_time_us = global.end_us;
+    row.pe_count = global.pe_count;
+    step_builder.Append(row);
   }
-
-  std::vector<std::shared_ptr<arrow::Array>> arrays(8);
-  PARQUET_THROW_NOT_OK(step_id.Finish(&arrays[0]));
-  PARQUET_THROW_NOT_OK(pe_id.Finish(&arrays[1]));
-  PARQUET_THROW_NOT_OK(start_us.Finish(&arrays[2]));
-  PARQUET_THROW_NOT_OK(end_us.Finish(&arrays[3]));
-  PARQUET_THROW_NOT_OK(duration_us.Finish(&arrays[4]));
-  PARQUET_THROW_NOT_OK(global_start_us.Finish(&arrays[5]));
-  PARQUET_THROW_NOT_OK(global_end_us.Finish(&arrays[6]));
-  PARQUET_THROW_NOT_OK(pe_count.Finish(&arrays[7]));
-
-  auto batch = arrow::RecordBatch::Make(charmvz::schema::simulation_step(),
-                                        arrays[0]->length(), arrays);
-  step_writer.WriteBatch(batch);
+  step_builder.Flush();
   spdlog::info("Wrote {} simulation_step rows across {} timesteps",
                per_pe.size(), per_step.size());
 }
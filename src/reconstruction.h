@@ -1,5 +1,6 @@
 #pragma once
 #include "log_parser.h"
+#include "output_options.h"
 #include <string>
 
 namespace charmvz {
@@ -7,12 +8,14 @@ namespace charmvz {
 void reconstruct_message_and_migration(const LogParserResult &log_data,
                                        const StsData &sts_data,
                                        const RcData &rc_data,
-                                       const std::string &output_dir);
+                                       const std::string &output_dir,
+                                       const OutputOptions &options = {});
 
 // Writes simulation_step.parquet from the step boundaries collected in Stage 2.
 // Always writes the file, even when no boundaries were found, so a consumer can
 // distinguish "no step instrumentation" from "the pipeline was not run".
 void reconstruct_simulation_steps(const LogParserResult &log_data,
-                                  const std::string &output_dir);
+                                  const std::string &output_dir,
+                                  const OutputOptions &options = {});
 
 } // namespace charmvz
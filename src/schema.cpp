@@ -39,47 +39,16 @@ auto chare_instance() -> std::shared_ptr<arrow::Schema> {
                         arrow::field("index_5", arrow::int32(), false)});
 }
 
-auto execution(const std::vector<std::string> &papi_event_names)
-    -> std::shared_ptr<arrow::Schema> {
-  auto schema =
-      arrow::schema({arrow::field("pe_id", arrow::int32(), false),
-                     arrow::field("event", arrow::int32(), false),
-                     arrow::field("instance_id", arrow::int64(), true),
-                     arrow::field("ep_id", arrow::int32(), false),
-                     arrow::field("src_pe", arrow::int32(), false),
-                     arrow::field("msg_idx", arrow::int32(), false),
-                     arrow::field("msg_len", arrow::int32(), false),
-                     arrow::field("start_time_us", arrow::int64(), false),
-                     arrow::field("recv_time_us", arrow::int64(), true),
-                     arrow::field("start_cpu_us", arrow::int64(), false),
-                     arrow::field("end_time_us", arrow::int64(), true),
-                     arrow::field("end_cpu_us", arrow::int64(), true),
-                     arrow::field("papi_begin_0", arrow::int64(), true),
-                     arrow::field("papi_begin_1", arrow::int64(), true),
-                     arrow::field("papi_begin_2", arrow::int64(), true),
-                     arrow::field("papi_begin_3", arrow::int64(), true),
-                     arrow::field("papi_begin_4", arrow::int64(), true),
-                     arrow::field("papi_begin_5", arrow::int64(), true),
-                     arrow::field("papi_end_0", arrow::int64(), true),
-                     arrow::field("papi_end_1", arrow::int64(), true),
-                     arrow::field("papi_end_2", arrow::int64(), true),
-                     arrow::field("papi_end_3", arrow::int64(), true),
-                     arrow::field("papi_end_4", arrow::int64(), true),
-                     arrow::field("papi_end_5", arrow::int64(), true),
-                     arrow::field("wall_duration_us", arrow::int64(), true),
-                     arrow::field("cpu_duration_us", arrow::int64(), true),
-                     arrow::field("queue_wait_us", arrow::int64(), true),
-                     arrow::field("papi_delta_0", arrow::int64(), true),
-                     arrow::field("papi_delta_1", arrow::int64(), true),
-                     arrow::field("papi_delta_2", arrow::int64(), true),
-                     arrow::field("papi_delta_3", arrow::int64(), true),
-                     arrow::field("papi_delta_4", arrow::int64(), true),
-                     arrow::field("papi_delta_5", arrow::int64(), true)});
-
-  if (papi_event_names.empty()) {
-    return schema;
-  }
+auto chare_instance_bloom_filter_columns() -> std::vector<std::string> {
+  return {"instance_id"};
+}
 
+namespace {
+
+// The counter names as schema metadata, `papi_event_<i>` -> name, skipping
+// counters the .sts left unnamed; nullptr when none are named.
+auto papi_metadata(const std::vector<std::string> &papi_event_names)
+    -> std::shared_ptr<arrow::KeyValueMetadata> {
   std::vector<std::string> keys;
   std::vector<std::string> values;
   keys.reserve(papi_event_names.size());
@@ -91,22 +60,95 @@ auto execution(const std::vector<std::string> &papi_event_names)
     keys.push_back("papi_event_" + std::to_string(i));
     values.push_back(papi_event_names[i]);
   }
-
   if (keys.empty()) {
-    return schema;
+    return nullptr;
   }
+  return std::make_shared<arrow::KeyValueMetadata>(keys, values);
+}
+
+// Under compact types, ep_id and msg_idx are the uint16 LogEntry reads them
+// as, and durations int32: 2^31 us is over half an hour for one execution.
+auto id16_type(bool compact_types) -> std::shared_ptr<arrow::DataType> {
+  return compact_types ? arrow::uint16() : arrow::int32();
+}
+
+auto duration_type(bool compact_types) -> std::shared_ptr<arrow::DataType> {
+  return compact_types ? arrow::int32() : arrow::int64();
+}
+
+// A name column dictionary-encoded in the file as well as in Parquet: readers
+// get the .sts names once and an int32 code per row.
+auto name_type() -> std::shared_ptr<arrow::DataType> {
+  return arrow::dictionary(arrow::int32(), arrow::utf8());
+}
+
+void add_papi_fields(arrow::FieldVector &fields, const std::string &prefix,
+                     size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    fields.push_back(
+        arrow::field(prefix + std::to_string(i), arrow::int64(), true));
+  }
+}
+
+} // namespace
+
+// The papi_begin_<i>, papi_end_<i> and papi_delta_<i> columns exist only for
+// the counters the trace has, so a trace collected without PAPI carries none
+// and one with more than six keeps them all.
+auto execution(const std::vector<std::string> &papi_event_names,
+               bool compact_types) -> std::shared_ptr<arrow::Schema> {
+  const size_t counters = papi_event_names.size();
+  arrow::FieldVector fields = {
+      arrow::field("pe_id", arrow::int32(), false),
+      arrow::field("event", arrow::int32(), false),
+      arrow::field("instance_id", arrow::int64(), true),
+      arrow::field("ep_id", id16_type(compact_types), false),
+      arrow::field("src_pe", arrow::int32(), false),
+      arrow::field("msg_idx", id16_type(compact_types), false),
+      arrow::field("msg_len", arrow::int32(), false),
+      arrow::field("start_time_us", arrow::int64(), false),
+      arrow::field("recv_time_us", arrow::int64(), true),
+      arrow::field("start_cpu_us", arrow::int64(), false),
+      arrow::field("end_time_us", arrow::int64(), true),
+      arrow::field("end_cpu_us", arrow::int64(), true)};
+  add_papi_fields(fields, "papi_begin_", counters);
+  add_papi_fields(fields, "papi_end_", counters);
+  const auto duration = duration_type(compact_types);
+  fields.push_back(arrow::field("wall_duration_us", duration, true));
+  fields.push_back(arrow::field("cpu_duration_us", duration, true));
+  fields.push_back(arrow::field("queue_wait_us", duration, true));
+  add_papi_fields(fields, "papi_delta_", counters);
+  fields.push_back(arrow::field("step_id", arrow::int32(), true));
+  fields.push_back(arrow::field("message_id", arrow::int64(), true));
+  return arrow::schema(fields, papi_metadata(papi_event_names));
+}
+
+// The ids analysts filter execution by with equality predicates. pe_id is left
+// out on purpose: rows arrive one PE log at a time, so each row group spans one
+// or two PEs and min/max statistics already prune it exactly, while a filter
+// sized for a row group's worth of distinct values would be almost empty.
+auto execution_bloom_filter_columns() -> std::vector<std::string> {
+  return {"ep_id", "instance_id", "message_id"};
+}
 
-  return schema->WithMetadata(
-      std::make_shared<arrow::KeyValueMetadata>(keys, values));
+// Absolute timestamps stay int64 under compact types; what shrinks them is
+// DELTA_BINARY_PACKED, which stores each value's difference from the last.
+// Within a PE's rows they climb steadily, so the differences bit-pack far
+// tighter than the dictionary-then-plain fallback high-cardinality columns
+// otherwise get.
+auto execution_delta_columns() -> std::vector<std::string> {
+  return {"start_time_us", "recv_time_us", "start_cpu_us", "end_time_us",
+          "end_cpu_us"};
 }
 
-auto message() -> std::shared_ptr<arrow::Schema> {
+auto message(bool compact_types) -> std::shared_ptr<arrow::Schema> {
+  const auto duration = duration_type(compact_types);
   return arrow::schema(
       {arrow::field("message_id", arrow::int64(), false),
        arrow::field("src_pe", arrow::int32(), false),
        arrow::field("event", arrow::int32(), false),
-       arrow::field("ep_id", arrow::int32(), false),
-       arrow::field("msg_idx", arrow::int32(), false),
+       arrow::field("ep_id", id16_type(compact_types), false),
+       arrow::field("msg_idx", id16_type(compact_types), false),
        arrow::field("msg_len", arrow::int32(), false),
        arrow::field("send_time_us", arrow::int64(), false),
        arrow::field("enqueue_time_us", arrow::int64(), true),
@@ -115,16 +157,85 @@ auto message() -> std::shared_ptr<arrow::Schema> {
        arrow::field("dst_pe", arrow::int32(), true),
        arrow::field("recv_time_us", arrow::int64(), true),
        arrow::field("exec_start_time_us", arrow::int64(), true),
-       arrow::field("send_to_enqueue_us", arrow::int64(), true),
-       arrow::field("enqueue_to_exec_us", arrow::int64(), true),
-       arrow::field("end_to_end_us", arrow::int64(), true)});
+       arrow::field("send_to_enqueue_us", duration, true),
+       arrow::field("enqueue_to_exec_us", duration, true),
+       arrow::field("end_to_end_us", duration, true),
+       arrow::field("step_id", arrow::int32(), true),
+       arrow::field("sender_event", arrow::int32(), true),
+       arrow::field("sender_ep_id", id16_type(compact_types), true),
+       arrow::field("sender_instance_id", arrow::int64(), true)});
+}
+
+// Messages are written in hash-map order, so no column is clustered and the
+// PEs need a filter as much as the ids do.
+auto message_bloom_filter_columns() -> std::vector<std::string> {
+  return {"message_id", "src_pe", "dst_pe", "ep_id"};
+}
+
+auto message_delta_columns() -> std::vector<std::string> {
+  return {"send_time_us", "enqueue_time_us", "recv_time_us",
+          "exec_start_time_us"};
+}
+
+// One row per (sender_ep_id, receiver_ep_id), with the two entry methods'
+// collections alongside so a collection-to-collection view is a group-by.
+// message_count and total_bytes count sends; the latencies, from send to the
+// start of the receiving execution, count deliveries, and are null for an
+// edge none of whose messages was seen to run.
+auto ep_comm_graph() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("sender_ep_id", arrow::int32(), true),
+       arrow::field("receiver_ep_id", arrow::int32(), false),
+       arrow::field("sender_collection_id", arrow::int32(), true),
+       arrow::field("receiver_collection_id", arrow::int32(), true),
+       arrow::field("message_count", arrow::int64(), false),
+       arrow::field("total_bytes", arrow::int64(), false),
+       arrow::field("delivery_count", arrow::int64(), false),
+       arrow::field("min_latency_us", arrow::int64(), true),
+       arrow::field("mean_latency_us", arrow::float64(), true),
+       arrow::field("max_latency_us", arrow::int64(), true)});
+}
+
+// One row per (src_pe, dst_pe) with a delivery, or per (src_pe, dst_pe, bin)
+// binned by send time, bin_start_us being null when unbinned. Deliveries are
+// message_delivery's rows, so a broadcast counts its bytes once per receiver.
+// total_latency_us sums, over the latency_count deliveries seen to run, the
+// time from send to the start of the receiving execution.
+auto pe_comm_matrix(int64_t bin_us) -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("src_pe", arrow::int32(), false),
+       arrow::field("dst_pe", arrow::int32(), false),
+       arrow::field("bin_start_us", arrow::int64(), true),
+       arrow::field("message_count", arrow::int64(), false),
+       arrow::field("total_bytes", arrow::int64(), false),
+       arrow::field("total_latency_us", arrow::int64(), false),
+       arrow::field("latency_count", arrow::int64(), false)},
+      std::make_shared<arrow::KeyValueMetadata>(
+          std::vector<std::string>{"time_bin_us"},
+          std::vector<std::string>{std::to_string(bin_us)}));
+}
+
+// message keeps a single dst_pe, the receiver that started the message first
+// (the lowest such PE on a tie); this has every receiver of a broadcast or
+// multicast. A PE a multicast listed but that never ran it still has a row,
+// with null receive times.
+auto message_delivery() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("message_id", arrow::int64(), false),
+       arrow::field("src_pe", arrow::int32(), false),
+       arrow::field("event", arrow::int32(), false),
+       arrow::field("dst_pe", arrow::int32(), false),
+       arrow::field("send_time_us", arrow::int64(), false),
+       arrow::field("recv_time_us", arrow::int64(), true),
+       arrow::field("exec_start_time_us", arrow::int64(), true)});
 }
 
 auto idle_interval() -> std::shared_ptr<arrow::Schema> {
   return arrow::schema({arrow::field("pe_id", arrow::int32(), false),
                         arrow::field("start_time_us", arrow::int64(), false),
                         arrow::field("end_time_us", arrow::int64(), true),
-                        arrow::field("duration_us", arrow::int64(), true)});
+                        arrow::field("duration_us", arrow::int64(), true),
+                        arrow::field("step_id", arrow::int32(), true)});
 }
 
 // A migration is derived from a change of PE between consecutive executions of
@@ -153,7 +264,8 @@ auto migration_episode() -> std::shared_ptr<arrow::Schema> {
 // ones (USER_SUPPLIED_BRACKETED_NOTE 29, BEGIN/END_USER_EVENT_PAIR 98/99,
 // USER_EVENT_PAIR 100). `record_type` keeps the originating Charm++ type code
 // so a consumer can tell the forms apart without reverse-engineering which
-// columns happen to be NULL.
+// columns happen to be NULL. `name` is dictionary<int32, utf8> over the STS
+// EVENT table, null for an id the table does not register.
 //
 // `pe_id` comes from the log file name, never from the record's own `pe` field:
 // the bracketed forms are constructed by a LogEntry constructor that never sets
@@ -162,7 +274,7 @@ auto user_event() -> std::shared_ptr<arrow::Schema> {
   return arrow::schema({arrow::field("pe_id", arrow::int32(), false),
                         arrow::field("record_type", arrow::int32(), false),
                         arrow::field("user_event_id", arrow::int32(), true),
-                        arrow::field("name", arrow::utf8(), true),
+                        arrow::field("name", name_type(), true),
                         arrow::field("event", arrow::int32(), true),
                         arrow::field("nested_id", arrow::int32(), true),
                         arrow::field("start_time_us", arrow::int64(), false),
@@ -207,9 +319,10 @@ auto message_type() -> std::shared_ptr<arrow::Schema> {
 // emitted by updateStat() / updateStatPair().
 //
 // `stat_id` indexes the STS `STAT` registry populated by
-// traceRegisterUserStat(); the registered name is denormalized into every row,
-// as UserEvent does, because a stat has no attribute beyond its name and
-// Parquet dictionary-encodes the repetition away.
+// traceRegisterUserStat(); the registered name is carried on every row, as
+// UserEvent does, because a stat has no attribute beyond its name. It is a
+// dictionary<int32, utf8> column over the STAT table, so the repetition costs
+// a code per row.
 //
 // `user_time_s` is the one time field in this schema that is *not* aligned
 // microseconds. USER_STAT writes the `cputime` member raw
@@ -225,7 +338,7 @@ auto message_type() -> std::shared_ptr<arrow::Schema> {
 auto user_stat() -> std::shared_ptr<arrow::Schema> {
   return arrow::schema({arrow::field("pe_id", arrow::int32(), false),
                         arrow::field("stat_id", arrow::int32(), false),
-                        arrow::field("name", arrow::utf8(), true),
+                        arrow::field("name", name_type(), true),
                         arrow::field("time_us", arrow::int64(), false),
                         arrow::field("stat_value", arrow::float64(), false),
                         arrow::field("user_time_s", arrow::float64(), true)});
@@ -250,4 +363,151 @@ auto memory_sample() -> std::shared_ptr<arrow::Schema> {
                         arrow::field("bytes", arrow::int64(), false)});
 }
 
+// One PAPI counter of one execution, long format: a row per (pe_id, event,
+// counter_id), joining execution on (pe_id, event). Written only on request,
+// since it repeats what execution's papi_* columns hold; it is the shape for
+// grouping or pivoting by counter without knowing how many a trace has.
+// `counter` is the .sts name, dictionary-encoded with counter_id as its code,
+// and null where the .sts left the counter unnamed.
+auto papi_sample(const std::vector<std::string> &papi_event_names)
+    -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema({arrow::field("pe_id", arrow::int32(), false),
+                        arrow::field("event", arrow::int32(), false),
+                        arrow::field("counter_id", arrow::int32(), false),
+                        arrow::field("counter", name_type(), true),
+                        arrow::field("begin_value", arrow::int64(), false),
+                        arrow::field("end_value", arrow::int64(), false),
+                        arrow::field("delta", arrow::int64(), false)},
+                       papi_metadata(papi_event_names));
+}
+
+// Totals over execution's rows for one (pe_id, ep_id), so a profile reads a
+// row per entry method per PE rather than scanning every execution. Means are
+// a total over execution_count, except the queue wait's, which is over
+// queue_wait_count: an execution with no recorded receive time has none.
+auto ep_pe_summary(const std::vector<std::string> &papi_event_names)
+    -> std::shared_ptr<arrow::Schema> {
+  arrow::FieldVector fields = {
+      arrow::field("pe_id", arrow::int32(), false),
+      arrow::field("ep_id", arrow::int32(), false),
+      arrow::field("execution_count", arrow::int64(), false),
+      arrow::field("total_wall_us", arrow::int64(), false),
+      arrow::field("min_wall_us", arrow::int64(), false),
+      arrow::field("max_wall_us", arrow::int64(), false),
+      arrow::field("total_cpu_us", arrow::int64(), false),
+      arrow::field("min_cpu_us", arrow::int64(), false),
+      arrow::field("max_cpu_us", arrow::int64(), false),
+      arrow::field("total_queue_wait_us", arrow::int64(), false),
+      arrow::field("queue_wait_count", arrow::int64(), false),
+      arrow::field("total_msg_bytes", arrow::int64(), false)};
+  add_papi_fields(fields, "papi_delta_sum_", papi_event_names.size());
+  return arrow::schema(fields, papi_metadata(papi_event_names));
+}
+
+// Each PE's time per bin: one row per entry method it ran in the bin, with
+// busy_us, and one with a null ep_id and idle_us for its idle time. A bin
+// holds [bin_start_us, bin_start_us + time_bin_us), and a span crossing an
+// edge is split at it, so each bin counts exactly the part inside it. Bins
+// where the PE has no span have no row.
+auto time_profile(int64_t bin_us) -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("bin_start_us", arrow::int64(), false),
+       arrow::field("pe_id", arrow::int32(), false),
+       arrow::field("ep_id", arrow::int32(), true),
+       arrow::field("busy_us", arrow::int64(), true),
+       arrow::field("idle_us", arrow::int64(), true)},
+      std::make_shared<arrow::KeyValueMetadata>(
+          std::vector<std::string>{"time_bin_us"},
+          std::vector<std::string>{std::to_string(bin_us)}));
+}
+
+// A level of the timeline pyramid: per PE, per tile, the segments to draw at
+// the level's pixel width. `merged` rows stand for a pixel of executions each
+// shorter than it; their ep_id is the entry method with the most busy time in
+// the pixel and busy_us / (end_us - start_us) the fraction of it the PE was
+// busy. Other rows are one execution, cut at tile edges.
+auto timeline_level(int32_t level, int64_t pixel_us, int64_t tile_us)
+    -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("pe_id", arrow::int32(), false),
+       arrow::field("tile", arrow::int64(), false),
+       arrow::field("start_us", arrow::int64(), false),
+       arrow::field("end_us", arrow::int64(), false),
+       arrow::field("ep_id", arrow::int32(), false),
+       arrow::field("busy_us", arrow::int64(), false),
+       arrow::field("execution_count", arrow::int32(), false),
+       arrow::field("merged", arrow::boolean(), false)},
+      std::make_shared<arrow::KeyValueMetadata>(
+          std::vector<std::string>{"level", "pixel_us", "tile_us"},
+          std::vector<std::string>{std::to_string(level),
+                                   std::to_string(pixel_us),
+                                   std::to_string(tile_us)}));
+}
+
+// The interval index of execution or idle_interval: per PE, its rows' spans
+// sorted by start_us, each with the running maximum of end_us and the row's
+// offset in the table file the index file sits beside.
+auto interval_index(const std::string &table)
+    -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("pe_id", arrow::int32(), false),
+       arrow::field("start_us", arrow::int64(), false),
+       arrow::field("end_us", arrow::int64(), false),
+       arrow::field("max_end_us", arrow::int64(), false),
+       arrow::field("row_offset", arrow::int64(), false)},
+      std::make_shared<arrow::KeyValueMetadata>(
+          std::vector<std::string>{"indexed_table"},
+          std::vector<std::string>{table}));
+}
+
+// A critical path in order of its segments. An `execution` segment is the
+// part of an execution on the path, up to where a message sent from it takes
+// over; a `message` segment is that message's flight, from its send on src_pe
+// to its receive on pe_id. Both carry the (src_pe, event) of a message: the
+// one the execution ran, or the one in flight. path_us is the path's length
+// at end_us, so the last segment's is the step's critical path length. Runs
+// with no simulation steps have one path with a null step_id.
+auto critical_path() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema({arrow::field("step_id", arrow::int32(), true),
+                        arrow::field("segment", arrow::int32(), false),
+                        arrow::field("kind", arrow::utf8(), false),
+                        arrow::field("pe_id", arrow::int32(), false),
+                        arrow::field("src_pe", arrow::int32(), false),
+                        arrow::field("event", arrow::int32(), false),
+                        arrow::field("ep_id", arrow::int32(), false),
+                        arrow::field("start_us", arrow::int64(), false),
+                        arrow::field("end_us", arrow::int64(), false),
+                        arrow::field("path_us", arrow::int64(), false)});
+}
+
+// Every execution with slack_us, how much longer it could take before its
+// step's critical path grows: the path length less the longest path through
+// the execution. Executions on the critical path have none.
+auto execution_slack() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema({arrow::field("step_id", arrow::int32(), true),
+                        arrow::field("pe_id", arrow::int32(), false),
+                        arrow::field("src_pe", arrow::int32(), false),
+                        arrow::field("event", arrow::int32(), false),
+                        arrow::field("ep_id", arrow::int32(), false),
+                        arrow::field("start_us", arrow::int64(), false),
+                        arrow::field("end_us", arrow::int64(), false),
+                        arrow::field("slack_us", arrow::int64(), false),
+                        arrow::field("on_critical_path", arrow::boolean(),
+                                     false)});
+}
+
+// The id map of execution_graph's CSR arrays: node_id is the row, in
+// (start_time_us, end_time_us, pe_id) order, and (pe_id, event) finds the
+// execution's row in execution.
+auto execution_graph_nodes() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema(
+      {arrow::field("node_id", arrow::int32(), false),
+       arrow::field("pe_id", arrow::int32(), false),
+       arrow::field("src_pe", arrow::int32(), false),
+       arrow::field("event", arrow::int32(), false),
+       arrow::field("ep_id", arrow::int32(), false),
+       arrow::field("start_time_us", arrow::int64(), false),
+       arrow::field("end_time_us", arrow::int64(), false)});
+}
+
 } // namespace charmvz::schema
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <arrow/api.h>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,15 +29,115 @@ auto entry_method() -> std::shared_ptr<arrow::Schema>;
 auto chare_instance() -> std::shared_ptr<arrow::Schema>;
 
 /**
- * Returns the formal Arrow schema for the Execution entity.
+ * Returns the ChareInstance columns written with a Parquet bloom filter.
  */
-auto execution(const std::vector<std::string> &papi_event_names = {})
+auto chare_instance_bloom_filter_columns() -> std::vector<std::string>;
+
+/**
+ * Returns the formal Arrow schema for the Execution entity, with one
+ * papi_begin/end/delta column per named PAPI counter. With `compact_types`,
+ * ep_id and msg_idx are uint16 and the durations int32.
+ */
+auto execution(const std::vector<std::string> &papi_event_names = {},
+               bool compact_types = false) -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the Execution columns written with a Parquet bloom filter.
+ */
+auto execution_bloom_filter_columns() -> std::vector<std::string>;
+
+/**
+ * Returns the Execution timestamp columns delta-encoded under compact types.
+ */
+auto execution_delta_columns() -> std::vector<std::string>;
+
+/**
+ * Returns the formal Arrow schema for the long-format PapiSample table.
+ */
+auto papi_sample(const std::vector<std::string> &papi_event_names = {})
+    -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the EpPeSummary table: one row per
+ * (pe_id, ep_id) with its executions' totals, and one papi_delta_sum column
+ * per named PAPI counter.
+ */
+auto ep_pe_summary(const std::vector<std::string> &papi_event_names = {})
     -> std::shared_ptr<arrow::Schema>;
 
 /**
- * Returns the formal Arrow schema for the Message entity.
+ * Returns the formal Arrow schema for the TimeProfile table at a bin width of
+ * `bin_us`, which the schema metadata records as time_bin_us.
+ */
+auto time_profile(int64_t bin_us) -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for one level of the Timeline pyramid, whose
+ * metadata records the level and its pixel and tile widths.
+ */
+auto timeline_level(int32_t level, int64_t pixel_us, int64_t tile_us)
+    -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the interval index sidecar of
+ * `table`, execution or idle_interval, which the schema metadata records as
+ * indexed_table.
+ */
+auto interval_index(const std::string &table)
+    -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the CriticalPath table: each simulation
+ * step's longest chain of executions and messages, one row per segment.
+ */
+auto critical_path() -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the ExecutionSlack table: one row per
+ * execution with its slack against its step's critical path.
+ */
+auto execution_slack() -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the node table of the execution graph,
+ * which maps each node id to its execution.
+ */
+auto execution_graph_nodes() -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for the Message entity. With
+ * `compact_types`, ep_id and msg_idx are uint16 and the durations int32.
+ */
+auto message(bool compact_types = false) -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the Message columns written with a Parquet bloom filter.
+ */
+auto message_bloom_filter_columns() -> std::vector<std::string>;
+
+/**
+ * Returns the Message timestamp columns delta-encoded under compact types.
+ */
+auto message_delta_columns() -> std::vector<std::string>;
+
+/**
+ * Returns the formal Arrow schema for the MessageDelivery entity, one row per
+ * PE a message reached.
+ */
+auto message_delivery() -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for ep_comm_graph: message totals per
+ * sending and receiving entry method.
+ */
+auto ep_comm_graph() -> std::shared_ptr<arrow::Schema>;
+
+/**
+ * Returns the formal Arrow schema for pe_comm_matrix: delivery totals per
+ * sending and receiving PE, per bin of `bin_us` when that is not 0. The
+ * schema metadata records the width as time_bin_us.
  */
-auto message() -> std::shared_ptr<arrow::Schema>;
+auto pe_comm_matrix(int64_t bin_us) -> std::shared_ptr<arrow::Schema>;
 
 /**
  * Returns the formal Arrow schema for the IdleInterval entity.
@@ -0,0 +1,248 @@
+#include "spill.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace charmvz {
+
+namespace {
+
+// The files of one kind a single Spill() call appends to, opened as the
+// records first reach them, with the bytes written through them.
+class PartitionWriter {
+public:
+  PartitionWriter(const std::filesystem::path &dir, const std::string &kind)
+      : dir_(dir), kind_(kind) {}
+
+  auto at(int32_t partition) -> PartitionWriter & {
+    auto &out = files_[static_cast<size_t>(partition)];
+    if (!out) {
+      out.emplace(dir_ / (kind_ + "-" + std::to_string(partition) + ".bin"),
+                  std::ios::binary | std::ios::app);
+      if (!*out) {
+        spdlog::error("Cannot open spill file {}-{} in {}", kind_, partition,
+                      dir_.string());
+        throw std::runtime_error("Could not open spill file");
+      }
+    }
+    current_ = &*out;
+    return *this;
+  }
+
+  template <class T> auto put(const T &value) -> PartitionWriter & {
+    current_->write(reinterpret_cast<const char *>(&value), sizeof(T));
+    bytes_ += static_cast<int64_t>(sizeof(T));
+    return *this;
+  }
+
+  // Flushes every file, so a full disk surfaces here rather than as records
+  // silently missing from Stage 3.
+  auto Finish() -> int64_t {
+    for (auto &out : files_) {
+      if (out && !out->flush()) {
+        spdlog::error("Failed writing {} spill files in {}", kind_,
+                      dir_.string());
+        throw std::runtime_error("Could not write spill file");
+      }
+    }
+    return bytes_;
+  }
+
+private:
+  std::filesystem::path dir_;
+  std::string kind_;
+  std::array<std::optional<std::ofstream>, SpillStore::kPartitions> files_;
+  std::ofstream *current_ = nullptr;
+  int64_t bytes_ = 0;
+};
+
+// A directory under `parent` that did not exist before, named for this
+// process and a random suffix. create_directory fails on an existing path, so
+// two runs can never end up sharing one.
+auto create_spill_dir(const std::filesystem::path &parent)
+    -> std::filesystem::path {
+  constexpr int kAttempts = 16;
+  std::filesystem::create_directories(parent);
+  std::random_device seed;
+  std::mt19937_64 random((static_cast<uint64_t>(seed()) << 32) ^ seed());
+  for (int attempt = 0; attempt < kAttempts; ++attempt) {
+    const auto dir = parent / fmt::format(".charmvz-spill-{}-{:016x}",
+                                          ::getpid(), random());
+    if (std::filesystem::create_directory(dir))
+      return dir;
+  }
+  spdlog::error("Cannot create a spill directory in {}", parent.string());
+  throw std::runtime_error("Could not create spill directory");
+}
+
+template <class T> auto get(std::istream &in, T &value) -> bool {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+} // namespace
+
+SpillStore::SpillStore(const std::filesystem::path &parent,
+                       int32_t total_pes)
+    : dir_(create_spill_dir(parent)), total_pes_(total_pes) {}
+
+SpillStore::~SpillStore() {
+  std::error_code error;
+  std::filesystem::remove_all(dir_, error);
+  if (error)
+    spdlog::warn("Could not remove spill directory {}: {}", dir_.string(),
+                 error.message());
+}
+
+auto SpillStore::pe_partition(int32_t pe) const -> int32_t {
+  if (total_pes_ <= 0 || pe < 0)
+    return 0;
+  const int64_t partition =
+      static_cast<int64_t>(pe) * kPartitions / total_pes_;
+  return static_cast<int32_t>(std::min<int64_t>(partition, kPartitions - 1));
+}
+
+auto SpillStore::file(const std::string &kind, int32_t partition) const
+    -> std::filesystem::path {
+  return dir_ / (kind + "-" + std::to_string(partition) + ".bin");
+}
+
+auto SpillStore::Spill(const CreationMap &creations) -> int64_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PartitionWriter out(dir_, "creation");
+  for (const auto &[key, cr] : creations) {
+    out.at(pe_partition(std::get<0>(key)))
+        .put(std::get<0>(key))
+        .put(std::get<1>(key))
+        .put(cr.ep_id)
+        .put(cr.msg_idx)
+        .put(cr.msg_len)
+        .put(cr.send_time_us)
+        .put(cr.enqueue_time_us)
+        .put(static_cast<uint8_t>(cr.is_broadcast))
+        .put(cr.broadcast_fanout)
+        .put(cr.src_pe)
+        .put(static_cast<uint8_t>(cr.step_id.has_value()))
+        .put(cr.step_id.value_or(0))
+        .put(static_cast<uint8_t>(cr.sender.has_value()))
+        .put(cr.sender.value_or(SenderRecord{}))
+        .put(static_cast<int32_t>(cr.dst_pes.size()));
+    for (const int32_t pe : cr.dst_pes)
+      out.put(pe);
+  }
+  const int64_t bytes = out.Finish();
+  bytes_written_ += bytes;
+  return bytes;
+}
+
+auto SpillStore::Spill(const BeginProcessingMap &begins) -> int64_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PartitionWriter out(dir_, "begin");
+  begins.ForEachReceipt([&](const BeginProcessingMap::Key &key,
+                            const BeginProcessingRecord &bp) {
+    out.at(pe_partition(std::get<0>(key)))
+        .put(std::get<0>(key))
+        .put(std::get<1>(key))
+        .put(bp.dst_pe)
+        .put(bp.recv_time_us)
+        .put(bp.exec_start_time_us);
+  });
+  const int64_t bytes = out.Finish();
+  bytes_written_ += bytes;
+  return bytes;
+}
+
+auto SpillStore::Spill(const std::vector<InstanceLocationRecord> &locations)
+    -> int64_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PartitionWriter out(dir_, "location");
+  for (const auto &loc : locations) {
+    out.at(static_cast<int32_t>(loc.instance_id % kPartitions))
+        .put(loc.instance_id)
+        .put(loc.collection_id)
+        .put(loc.pe_id)
+        .put(loc.start_time_us)
+        .put(loc.end_time_us);
+  }
+  const int64_t bytes = out.Finish();
+  bytes_written_ += bytes;
+  return bytes;
+}
+
+void SpillStore::Load(int32_t partition, CreationMap &creations) const {
+  std::ifstream in(file("creation", partition), std::ios::binary);
+  std::tuple<int32_t, int32_t> key;
+  while (get(in, std::get<0>(key)) && get(in, std::get<1>(key))) {
+    CreationRecord cr;
+    uint8_t is_broadcast = 0;
+    uint8_t has_step = 0;
+    int32_t step_id = 0;
+    uint8_t has_sender = 0;
+    SenderRecord sender{};
+    int32_t pes = 0;
+    get(in, cr.ep_id);
+    get(in, cr.msg_idx);
+    get(in, cr.msg_len);
+    get(in, cr.send_time_us);
+    get(in, cr.enqueue_time_us);
+    get(in, is_broadcast);
+    get(in, cr.broadcast_fanout);
+    get(in, cr.src_pe);
+    get(in, has_step);
+    get(in, step_id);
+    get(in, has_sender);
+    get(in, sender);
+    get(in, pes);
+    cr.is_broadcast = is_broadcast != 0;
+    if (has_step != 0)
+      cr.step_id = step_id;
+    if (has_sender != 0)
+      cr.sender = sender;
+    cr.dst_pes.resize(static_cast<size_t>(pes));
+    for (auto &pe : cr.dst_pes)
+      get(in, pe);
+    creations.insert_or_assign(key, std::move(cr));
+  }
+}
+
+void SpillStore::Load(int32_t partition, BeginProcessingMap &begins) const {
+  std::ifstream in(file("begin", partition), std::ios::binary);
+  std::tuple<int32_t, int32_t> key;
+  while (get(in, std::get<0>(key)) && get(in, std::get<1>(key))) {
+    BeginProcessingRecord bp{};
+    get(in, bp.dst_pe);
+    get(in, bp.recv_time_us);
+    get(in, bp.exec_start_time_us);
+    begins.Add(key, bp);
+  }
+}
+
+void SpillStore::Load(int32_t partition,
+                      std::vector<InstanceLocationRecord> &locations) const {
+  std::ifstream in(file("location", partition), std::ios::binary);
+  InstanceLocationRecord loc{};
+  while (get(in, loc.instance_id)) {
+    get(in, loc.collection_id);
+    get(in, loc.pe_id);
+    get(in, loc.start_time_us);
+    get(in, loc.end_time_us);
+    locations.push_back(loc);
+  }
+}
+
+auto SpillStore::used() const -> bool {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_written_ > 0;
+}
+
+auto SpillStore::bytes_written() const -> int64_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_written_;
+}
+
+} // namespace charmvz
@@ -0,0 +1,69 @@
+#pragma once
+#include "log_parser.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace charmvz {
+
+// Stage 3's inputs, moved to disk when Stage 2 outgrows --max-memory. Records
+// are appended to one file per partition and kind, and Stage 3 loads a single
+// partition of each kind at a time, so it never holds more than a
+// 1/kPartitions share of any of them.
+//
+// Messages are partitioned by contiguous ranges of src_pe. Walking the
+// partitions in order and sorting within each therefore gives the same
+// (src_pe, send_time_us) order as sorting everything at once. Instance
+// locations are partitioned by instance_id, which keeps each instance's
+// executions together for migration detection.
+//
+// Appends are serialised, so the shards of a partitioned parse share one
+// store. Each store creates a directory of its own, so neither the files of
+// a run that was killed before removing them nor those of a run sharing the
+// parent are ever read back. The directory is removed with the store.
+class SpillStore {
+public:
+  static constexpr int32_t kPartitions = 32;
+
+  // Creates the store's directory, `.charmvz-spill-<pid>-<random>`, under
+  // `parent`.
+  SpillStore(const std::filesystem::path &parent, int32_t total_pes);
+  ~SpillStore();
+  SpillStore(const SpillStore &) = delete;
+  auto operator=(const SpillStore &) -> SpillStore & = delete;
+
+  // Each appends every entry to its partition's file and returns the bytes
+  // written; the caller then clears what it spilled.
+  auto Spill(const CreationMap &creations) -> int64_t;
+  auto Spill(const BeginProcessingMap &begins) -> int64_t;
+  auto Spill(const std::vector<InstanceLocationRecord> &locations) -> int64_t;
+
+  // Each reads one partition back in the order it was spilled, so an entry
+  // spilled later replaces an earlier one under the same key, as it would
+  // have in memory. Receipts are the exception: like the map, a later one
+  // adds a receiver to the message.
+  void Load(int32_t partition, CreationMap &creations) const;
+  void Load(int32_t partition, BeginProcessingMap &begins) const;
+  void Load(int32_t partition,
+            std::vector<InstanceLocationRecord> &locations) const;
+
+  [[nodiscard]] auto used() const -> bool;
+  [[nodiscard]] auto bytes_written() const -> int64_t;
+  [[nodiscard]] auto dir() const -> const std::filesystem::path & {
+    return dir_;
+  }
+
+private:
+  [[nodiscard]] auto pe_partition(int32_t pe) const -> int32_t;
+  [[nodiscard]] auto file(const std::string &kind, int32_t partition) const
+      -> std::filesystem::path;
+
+  std::filesystem::path dir_;
+  int32_t total_pes_;
+  mutable std::mutex mutex_;
+  int64_t bytes_written_ = 0;
+};
+
+} // namespace charmvz
@@ -0,0 +1,461 @@
+#pragma once
+#include "memory_pool.h"
+#include "table_writer.h"
+#include <arrow/api.h>
+#include <arrow/stl_allocator.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <parquet/exception.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace charmvz::builders {
+
+const int ROW_GROUP_SIZE = 100000;
+
+// How many rows a builder stages between asking memory_accounting() whether
+// the run is over its flush threshold. Often enough to react within a few
+// hundred KiB per table, rarely enough that the atomic load is noise.
+const int PRESSURE_CHECK_ROWS = 4096;
+
+// A table is described to TableBuilder by specialising RowDescriptor for the
+// record type it is built from:
+//
+//   template <> struct RowDescriptor<MemorySample> {
+//     static constexpr auto columns = std::make_tuple(
+//         &MemorySample::pe_id, &MemorySample::time_us,
+//         &MemorySample::bytes);
+//   };
+//
+// Each entry yields one column, in schema order, as a value of the record:
+// a data member pointer, or a function of the record for a derived value.
+// The value's type picks the Arrow builder; std::optional<T> makes the
+// column nullable and is the only thing that does. A column_group() entry
+// yields a run of columns whose width is fixed when the builder is made. A
+// DictionaryCode value makes a dictionary column, whose values the builder is
+// given when it is made. An int32 or int64 value may be written to a narrower
+// integer field -- uint16, or int32 from int64 -- and is range-checked first.
+template <class Row> struct RowDescriptor;
+
+// A row's entry in a dictionary column: the position of its value in the
+// dictionary, which is shared by every row group the builder writes.
+struct DictionaryCode {
+  int32_t code;
+};
+
+// A run of adjacent columns of one type, such as papi_delta_0..N-1. `cell`
+// is called as cell(row, i) for each i below the builder's group width.
+template <class F> struct ColumnGroup {
+  F cell;
+};
+
+template <class F> constexpr auto column_group(F cell) -> ColumnGroup<F> {
+  return ColumnGroup<F>{cell};
+}
+
+// The staged C++ type and the Arrow builder for each column value type.
+template <class T> struct ColumnType;
+template <> struct ColumnType<int32_t> {
+  using stored = int32_t;
+  using builder = arrow::Int32Builder;
+};
+template <> struct ColumnType<int64_t> {
+  using stored = int64_t;
+  using builder = arrow::Int64Builder;
+};
+template <> struct ColumnType<double> {
+  using stored = double;
+  using builder = arrow::DoubleBuilder;
+};
+// Staged as bytes: std::vector<bool> is bit-packed and has no data().
+template <> struct ColumnType<bool> {
+  using stored = uint8_t;
+  using builder = arrow::BooleanBuilder;
+};
+// Staged as the end offset of each value in the column's character buffer,
+// so the characters are allocated from the table's pool too.
+template <> struct ColumnType<std::string> {
+  using stored = int64_t;
+  using builder = arrow::StringBuilder;
+};
+// Staged and built as the int32 indices; Finish pairs them with the values.
+template <> struct ColumnType<DictionaryCode> {
+  using stored = int32_t;
+  using builder = arrow::Int32Builder;
+};
+
+template <class T> struct CellType {
+  using value = T;
+  static constexpr bool nullable = false;
+};
+template <class T> struct CellType<std::optional<T>> {
+  using value = T;
+  static constexpr bool nullable = true;
+};
+
+// What a builder hands its columns as it makes them: the pool they stage and
+// build in, the schema's fields one by one, the width of its column groups,
+// and the values of its dictionary columns in descriptor order.
+class ColumnContext {
+public:
+  ColumnContext(arrow::MemoryPool *pool, std::shared_ptr<arrow::Schema> schema,
+                size_t group_width,
+                std::vector<std::shared_ptr<arrow::Array>> dictionaries)
+      : pool_(pool), schema_(std::move(schema)), group_width_(group_width),
+        dictionaries_(std::move(dictionaries)) {}
+
+  [[nodiscard]] auto pool() const -> arrow::MemoryPool * { return pool_; }
+  [[nodiscard]] auto group_width() const -> size_t { return group_width_; }
+
+  // The field of the next column, or nullptr past the schema's end; the
+  // builder reports that mismatch once every column is made.
+  auto NextField() -> std::shared_ptr<arrow::Field> {
+    if (next_field_ >= schema_->num_fields()) {
+      ++next_field_;
+      return nullptr;
+    }
+    return schema_->field(next_field_++);
+  }
+
+  auto NextDictionary() -> std::shared_ptr<arrow::Array> {
+    if (used_ == dictionaries_.size()) {
+      spdlog::error("Row descriptor has more dictionary columns than the {} "
+                    "dictionaries given",
+                    dictionaries_.size());
+      throw std::runtime_error("Missing dictionary");
+    }
+    return dictionaries_[used_++];
+  }
+
+  [[nodiscard]] auto unused_dictionaries() const -> size_t {
+    return dictionaries_.size() - used_;
+  }
+
+private:
+  arrow::MemoryPool *pool_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int next_field_ = 0;
+  size_t group_width_;
+  std::vector<std::shared_ptr<arrow::Array>> dictionaries_;
+  size_t used_ = 0;
+};
+
+// One column's rows between flushes, as a plain vector of values and, only
+// for a nullable column, a vector of validity bytes; a string column keeps
+// its characters back to back in a third. Appending a row is a push_back;
+// the Arrow builder is touched once per flush, with the whole vector. The
+// vectors keep their capacity across flushes, so after the first row group a
+// table stages without allocating. They allocate from the table's pool, so
+// its accounting includes the rows not yet flushed.
+template <class Cell> class StagedColumn {
+public:
+  using Value = typename CellType<Cell>::value;
+  using Stored = typename ColumnType<Value>::stored;
+  static constexpr bool kNullable = CellType<Cell>::nullable;
+  static constexpr bool kDictionary = std::is_same_v<Value, DictionaryCode>;
+  static constexpr bool kString = std::is_same_v<Value, std::string>;
+  static constexpr bool kNarrowable =
+      std::is_same_v<Value, int32_t> || std::is_same_v<Value, int64_t>;
+
+  explicit StagedColumn(ColumnContext &context)
+      : pool_(context.pool()), values_(Allocator<Stored>(pool_)),
+        validity_(Allocator<uint8_t>(pool_)), chars_(Allocator<char>(pool_)),
+        field_(context.NextField()) {
+    if constexpr (kDictionary)
+      dictionary_ = context.NextDictionary();
+    if constexpr (kNarrowable) {
+      const auto target = field_ ? field_->type()->id() : arrow::Type::NA;
+      if (target == arrow::Type::UINT16 ||
+          (target == arrow::Type::INT32 && std::is_same_v<Value, int64_t>))
+        narrow_to_ = target;
+    }
+  }
+
+  void Push(Cell cell) {
+    if constexpr (kNullable) {
+      validity_.push_back(cell.has_value() ? 1 : 0);
+      values_.push_back(cell ? ToStored(std::move(*cell)) : NullStored());
+    } else {
+      values_.push_back(ToStored(std::move(cell)));
+    }
+  }
+
+  template <class Entry, class Row>
+  void Stage(const Entry &entry, const Row &row) {
+    Push(std::invoke(entry, row));
+  }
+
+  [[nodiscard]] auto width() const -> size_t { return 1; }
+
+  void Finish(std::vector<std::shared_ptr<arrow::Array>> &arrays) {
+    if constexpr (kNarrowable) {
+      if (narrow_to_ == arrow::Type::UINT16) {
+        arrays.push_back(FinishNarrowed<uint16_t, arrow::UInt16Builder>());
+        return;
+      }
+      if (narrow_to_ == arrow::Type::INT32) {
+        arrays.push_back(FinishNarrowed<int32_t, arrow::Int32Builder>());
+        return;
+      }
+    }
+    typename ColumnType<Value>::builder builder(pool_);
+    const auto length = static_cast<int64_t>(values_.size());
+    PARQUET_THROW_NOT_OK(builder.Reserve(length));
+    const uint8_t *valid = kNullable ? validity_.data() : nullptr;
+    if constexpr (kString) {
+      PARQUET_THROW_NOT_OK(
+          builder.ReserveData(static_cast<int64_t>(chars_.size())));
+      // Both reserves are made, so nothing below can allocate or fail.
+      int64_t begin = 0;
+      for (size_t i = 0; i < values_.size(); ++i) {
+        if (valid != nullptr && valid[i] == 0)
+          builder.UnsafeAppendNull();
+        else
+          builder.UnsafeAppend(std::string_view(
+              chars_.data() + begin, static_cast<size_t>(values_[i] - begin)));
+        begin = values_[i];
+      }
+      chars_.clear();
+    } else {
+      PARQUET_THROW_NOT_OK(builder.AppendValues(values_.data(), length, valid));
+    }
+    std::shared_ptr<arrow::Array> array;
+    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    if constexpr (kDictionary) {
+      // FromArrays checks every code against the dictionary's length.
+      PARQUET_ASSIGN_OR_THROW(
+          array, arrow::DictionaryArray::FromArrays(
+                     arrow::dictionary(arrow::int32(), dictionary_->type()),
+                     array, dictionary_));
+    }
+    arrays.push_back(std::move(array));
+    values_.clear();
+    validity_.clear();
+  }
+
+  // Hands the staging capacity back to the pool, for when memory is short.
+  void Release() {
+    values_.shrink_to_fit();
+    validity_.shrink_to_fit();
+    chars_.shrink_to_fit();
+  }
+
+private:
+  template <class T> using Allocator = arrow::stl::allocator<T>;
+
+  // Checks every present value against Target's range, then builds the
+  // narrower array. A value that does not fit throws before the row group is
+  // written, rather than wrapping into a plausible wrong number.
+  template <class Target, class Builder>
+  auto FinishNarrowed() -> std::shared_ptr<arrow::Array> {
+    std::vector<Target, Allocator<Target>> narrowed(values_.size(),
+                                                   Allocator<Target>(pool_));
+    for (size_t i = 0; i < values_.size(); ++i) {
+      if ((!kNullable || validity_[i] != 0) &&
+          !std::in_range<Target>(values_[i])) {
+        spdlog::error("Value {} does not fit column {} of type {}", values_[i],
+                      field_->name(), field_->type()->ToString());
+        throw std::runtime_error("Value out of range for its column");
+      }
+      narrowed[i] = static_cast<Target>(values_[i]);
+    }
+    Builder builder(pool_);
+    const auto length = static_cast<int64_t>(narrowed.size());
+    PARQUET_THROW_NOT_OK(builder.Reserve(length));
+    PARQUET_THROW_NOT_OK(builder.AppendValues(
+        narrowed.data(), length, kNullable ? validity_.data() : nullptr));
+    std::shared_ptr<arrow::Array> array;
+    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    values_.clear();
+    validity_.clear();
+    return array;
+  }
+
+  auto ToStored(Value value) -> Stored {
+    if constexpr (kDictionary) {
+      return value.code;
+    } else if constexpr (kString) {
+      chars_.insert(chars_.end(), value.begin(), value.end());
+      return static_cast<Stored>(chars_.size());
+    } else {
+      return static_cast<Stored>(std::move(value));
+    }
+  }
+
+  // A null string ends where the value before it did.
+  auto NullStored() const -> Stored {
+    if constexpr (kString)
+      return static_cast<Stored>(chars_.size());
+    else
+      return Stored{};
+  }
+
+  arrow::MemoryPool *pool_;
+  std::vector<Stored, Allocator<Stored>> values_;
+  std::vector<uint8_t, Allocator<uint8_t>> validity_;
+  std::vector<char, Allocator<char>> chars_;
+  std::shared_ptr<arrow::Field> field_;
+  std::shared_ptr<arrow::Array> dictionary_;
+  std::optional<arrow::Type::type> narrow_to_;
+};
+
+template <class Cell> class StagedGroup {
+public:
+  static_assert(!StagedColumn<Cell>::kDictionary,
+                "A column group cannot hold dictionary columns");
+
+  explicit StagedGroup(ColumnContext &context) {
+    columns_.reserve(context.group_width());
+    for (size_t i = 0; i < context.group_width(); ++i)
+      columns_.emplace_back(context);
+  }
+
+  template <class F, class Row>
+  void Stage(const ColumnGroup<F> &group, const Row &row) {
+    for (size_t i = 0; i < columns_.size(); ++i)
+      columns_[i].Push(std::invoke(group.cell, row, i));
+  }
+
+  [[nodiscard]] auto width() const -> size_t { return columns_.size(); }
+
+  void Finish(std::vector<std::shared_ptr<arrow::Array>> &arrays) {
+    for (auto &column : columns_)
+      column.Finish(arrays);
+  }
+
+  void Release() {
+    for (auto &column : columns_)
+      column.Release();
+  }
+
+private:
+  std::vector<StagedColumn<Cell>> columns_;
+};
+
+template <class Row, class Entry> struct StagedFor {
+  using type = StagedColumn<
+      std::remove_cvref_t<std::invoke_result_t<const Entry &, const Row &>>>;
+};
+template <class Row, class F> struct StagedFor<Row, ColumnGroup<F>> {
+  using type = StagedGroup<std::remove_cvref_t<
+      std::invoke_result_t<const F &, const Row &, size_t>>>;
+};
+
+template <class Row, class Columns, class Indices> struct StagedTuple;
+template <class Row, class Columns, size_t... I>
+struct StagedTuple<Row, Columns, std::index_sequence<I...>> {
+  using type = std::tuple<
+      typename StagedFor<Row, std::tuple_element_t<I, Columns>>::type...>;
+
+  // Braced, so the columns are made, and take their dictionaries, in order.
+  static auto make(ColumnContext &context) -> type {
+    return type{
+        typename StagedFor<Row, std::tuple_element_t<I, Columns>>::type(
+            context)...};
+  }
+};
+
+// Builds one table from records of type Row, as RowDescriptor<Row> lays them
+// out, and hands it to `writer` one row group of ROW_GROUP_SIZE rows at a
+// time -- or fewer, when memory_accounting() reports the run under pressure,
+// in which case the staging vectors are released as well. It stages and
+// builds in the writer's pool.
+template <class Row> class TableBuilder {
+public:
+  // `schema` must have exactly the descriptor's columns; `group_width` is the
+  // width of every column_group() entry, and `dictionaries` holds the values
+  // of each dictionary column in turn.
+  TableBuilder(TableWriter &writer, std::shared_ptr<arrow::Schema> schema,
+               size_t group_width = 0,
+               std::vector<std::shared_ptr<arrow::Array>> dictionaries = {})
+      : writer_(writer), schema_(std::move(schema)),
+        staged_(MakeStaged(ColumnContext(writer.pool(), schema_, group_width,
+                                         std::move(dictionaries)))) {
+    size_t width = 0;
+    std::apply([&](const auto &...staged) { ((width += staged.width()), ...); },
+               staged_);
+    if (static_cast<int>(width) != schema_->num_fields()) {
+      spdlog::error("Row descriptor yields {} columns for a schema of {}",
+                    width, schema_->num_fields());
+      throw std::runtime_error("Row descriptor does not match schema");
+    }
+  }
+
+  void Append(const Row &row) {
+    StageAll(row, kIndices);
+    ++total_rows_;
+    if (++rows_ >= ROW_GROUP_SIZE) {
+      Flush();
+    } else if (rows_ % PRESSURE_CHECK_ROWS == 0 &&
+               memory_accounting().under_pressure()) {
+      const int64_t rows = rows_;
+      Flush();
+      std::apply([](auto &...staged) { (staged.Release(), ...); }, staged_);
+      auto *pool = dynamic_cast<TablePool *>(writer_.pool());
+      if (pool != nullptr && pool->NoteEarlyFlush() == 1) {
+        const auto &accounting = memory_accounting();
+        spdlog::info("Flushing {} row groups early, the first at {} rows: "
+                     "{} in use is past the flush threshold of {}",
+                     pool->table(), rows,
+                     format_bytes(accounting.bytes_allocated()),
+                     format_bytes(accounting.flush_threshold()));
+      }
+    }
+  }
+
+  void Flush() {
+    if (rows_ == 0)
+      return;
+    std::vector<std::shared_ptr<arrow::Array>> arrays;
+    arrays.reserve(static_cast<size_t>(schema_->num_fields()));
+    std::apply([&](auto &...staged) { (staged.Finish(arrays), ...); },
+               staged_);
+    writer_.WriteBatch(arrow::RecordBatch::Make(schema_, rows_, arrays));
+    rows_ = 0;
+  }
+
+  // Rows staged since the last flush.
+  [[nodiscard]] auto length() const -> int64_t { return rows_; }
+  // Rows appended in all, so the offset in the file of the next one.
+  [[nodiscard]] auto total_rows() const -> int64_t { return total_rows_; }
+
+private:
+  using Columns = std::remove_cvref_t<decltype(RowDescriptor<Row>::columns)>;
+  static constexpr auto kIndices =
+      std::make_index_sequence<std::tuple_size_v<Columns>>{};
+  using Make = StagedTuple<Row, Columns, std::decay_t<decltype(kIndices)>>;
+  using Staged = typename Make::type;
+
+  static auto MakeStaged(ColumnContext &&context) -> Staged {
+    auto staged = Make::make(context);
+    if (context.unused_dictionaries() != 0) {
+      spdlog::error("{} dictionaries given beyond the descriptor's columns",
+                    context.unused_dictionaries());
+      throw std::runtime_error("Unused dictionary");
+    }
+    return staged;
+  }
+
+  template <size_t... I>
+  void StageAll(const Row &row, std::index_sequence<I...>) {
+    (std::get<I>(staged_).Stage(std::get<I>(RowDescriptor<Row>::columns), row),
+     ...);
+  }
+
+  TableWriter &writer_;
+  std::shared_ptr<arrow::Schema> schema_;
+  Staged staged_;
+  int64_t rows_ = 0;
+  int64_t total_rows_ = 0;
+};
+
+} // namespace charmvz::builders
@@ -0,0 +1,530 @@
+#include "table_scan.h"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <parquet/file_reader.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace charmvz {
+
+namespace {
+
+template <class T>
+auto value_or_throw(arrow::Result<T> result, const std::string &what) -> T {
+  if (!result.ok()) {
+    spdlog::error("{}: {}", what, result.status().ToString());
+    throw std::runtime_error(what);
+  }
+  return std::move(*result);
+}
+
+void throw_not_ok(const arrow::Status &status, const std::string &what) {
+  if (!status.ok()) {
+    spdlog::error("{}: {}", what, status.ToString());
+    throw std::runtime_error(what);
+  }
+}
+
+auto split(const std::string &text, char separator)
+    -> std::vector<std::string> {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  while (true) {
+    const size_t end = text.find(separator, begin);
+    parts.push_back(text.substr(begin, end - begin));
+    if (end == std::string::npos)
+      return parts;
+    begin = end + 1;
+  }
+}
+
+auto parse_int(const std::string &text) -> int64_t {
+  size_t consumed = 0;
+  int64_t value = 0;
+  try {
+    value = std::stoll(text, &consumed);
+  } catch (const std::exception &) {
+    consumed = 0;
+  }
+  if (consumed == 0 || consumed != text.size()) {
+    spdlog::error("Scan request holds a non-integer value \"{}\"", text);
+    throw std::runtime_error("Invalid scan request");
+  }
+  return value;
+}
+
+auto join_ints(const std::vector<int32_t> &values) -> std::string {
+  std::string text;
+  for (const auto value : values) {
+    if (!text.empty())
+      text += ',';
+    text += std::to_string(value);
+  }
+  return text;
+}
+
+auto is_table_file(const std::filesystem::path &path) -> bool {
+  return path.extension() == ".parquet" || path.extension() == ".arrow";
+}
+
+auto open_table_file(const std::filesystem::path &path, CatalogTable &table)
+    -> TableFile {
+  TableFile file;
+  file.path = path.string();
+  file.file = value_or_throw(
+      arrow::io::MemoryMappedFile::Open(file.path, arrow::io::FileMode::READ),
+      "Could not map " + file.path);
+
+  std::shared_ptr<arrow::Schema> schema;
+  if (path.extension() == ".parquet") {
+    auto reader = value_or_throw(
+        parquet::arrow::OpenFile(file.file, arrow::default_memory_pool()),
+        "Could not open " + file.path);
+    throw_not_ok(reader->GetSchema(&schema),
+                 "Could not read the schema of " + file.path);
+    file.parquet_metadata = reader->parquet_reader()->metadata();
+    table.num_rows += file.parquet_metadata->num_rows();
+  } else {
+    auto reader =
+        value_or_throw(arrow::ipc::RecordBatchFileReader::Open(file.file),
+                       "Could not open " + file.path);
+    schema = reader->schema();
+    table.num_rows +=
+        value_or_throw(reader->CountRows(), "Could not count " + file.path);
+  }
+  // The parts of a partitioned table are written from one schema, so the
+  // first one speaks for all.
+  if (!table.schema)
+    table.schema = schema;
+  return file;
+}
+
+// The [min, max] of an integer column chunk, if its statistics carry one.
+auto int_range(const parquet::RowGroupMetaData &row_group, int column)
+    -> std::optional<std::pair<int64_t, int64_t>> {
+  const auto stats = row_group.ColumnChunk(column)->statistics();
+  if (!stats || !stats->HasMinMax())
+    return std::nullopt;
+  switch (stats->physical_type()) {
+  case parquet::Type::INT32: {
+    const auto &typed = static_cast<const parquet::Int32Statistics &>(*stats);
+    return std::pair<int64_t, int64_t>{typed.min(), typed.max()};
+  }
+  case parquet::Type::INT64: {
+    const auto &typed = static_cast<const parquet::Int64Statistics &>(*stats);
+    return std::pair<int64_t, int64_t>{typed.min(), typed.max()};
+  }
+  default:
+    return std::nullopt;
+  }
+}
+
+auto int_at(const arrow::Array &array, int64_t i) -> std::optional<int64_t> {
+  if (array.IsNull(i))
+    return std::nullopt;
+  switch (array.type_id()) {
+  case arrow::Type::INT8:
+    return static_cast<const arrow::Int8Array &>(array).Value(i);
+  case arrow::Type::INT16:
+    return static_cast<const arrow::Int16Array &>(array).Value(i);
+  // ep_id under --compact-types.
+  case arrow::Type::UINT16:
+    return static_cast<const arrow::UInt16Array &>(array).Value(i);
+  case arrow::Type::INT32:
+    return static_cast<const arrow::Int32Array &>(array).Value(i);
+  case arrow::Type::INT64:
+    return static_cast<const arrow::Int64Array &>(array).Value(i);
+  default:
+    return std::nullopt;
+  }
+}
+
+auto any_in_range(const std::vector<int32_t> &sorted_ids,
+                  const std::pair<int64_t, int64_t> &range) -> bool {
+  const auto it = std::lower_bound(sorted_ids.begin(), sorted_ids.end(),
+                                   range.first);
+  return it != sorted_ids.end() && *it <= range.second;
+}
+
+} // namespace
+
+auto encode_scan_request(const ScanRequest &request) -> std::string {
+  std::string text = "table=" + request.table;
+  if (!request.columns.empty()) {
+    text += ";columns=";
+    for (size_t i = 0; i < request.columns.size(); ++i) {
+      if (i > 0)
+        text += ',';
+      text += request.columns[i];
+    }
+  }
+  if (!request.pe_ids.empty())
+    text += ";pe_id=" + join_ints(request.pe_ids);
+  if (!request.ep_ids.empty())
+    text += ";ep_id=" + join_ints(request.ep_ids);
+  if (request.begin_us || request.end_us) {
+    text += ";time_us=";
+    if (request.begin_us)
+      text += std::to_string(*request.begin_us);
+    text += ',';
+    if (request.end_us)
+      text += std::to_string(*request.end_us);
+  }
+  return text;
+}
+
+auto decode_scan_request(const std::string &text) -> ScanRequest {
+  ScanRequest request;
+  for (const auto &pair : split(text, ';')) {
+    const size_t eq = pair.find('=');
+    if (eq == std::string::npos) {
+      spdlog::error("Scan request term \"{}\" is not key=value", pair);
+      throw std::runtime_error("Invalid scan request");
+    }
+    const std::string key = pair.substr(0, eq);
+    const std::string value = pair.substr(eq + 1);
+    if (key == "table") {
+      request.table = value;
+    } else if (key == "columns") {
+      request.columns = split(value, ',');
+    } else if (key == "pe_id" || key == "ep_id") {
+      auto &ids = key == "pe_id" ? request.pe_ids : request.ep_ids;
+      for (const auto &id : split(value, ','))
+        ids.push_back(static_cast<int32_t>(parse_int(id)));
+    } else if (key == "time_us") {
+      const auto bounds = split(value, ',');
+      if (bounds.size() != 2) {
+        spdlog::error("time_us takes <begin>,<end>, got \"{}\"", value);
+        throw std::runtime_error("Invalid scan request");
+      }
+      if (!bounds[0].empty())
+        request.begin_us = parse_int(bounds[0]);
+      if (!bounds[1].empty())
+        request.end_us = parse_int(bounds[1]);
+    } else {
+      spdlog::error("Unknown scan request key \"{}\"", key);
+      throw std::runtime_error("Invalid scan request");
+    }
+  }
+  if (request.table.empty()) {
+    spdlog::error("Scan request \"{}\" names no table", text);
+    throw std::runtime_error("Invalid scan request");
+  }
+  return request;
+}
+
+TableCatalog::TableCatalog(const std::string &output_dir) {
+  std::vector<std::filesystem::path> entries;
+  for (const auto &entry : std::filesystem::directory_iterator{output_dir})
+    entries.push_back(entry.path());
+  std::sort(entries.begin(), entries.end());
+
+  for (const auto &entry : entries) {
+    if (std::filesystem::is_directory(entry)) {
+      // A partitioned table. Its `_metadata` summary has no extension and is
+      // passed over; each part's own footer is read instead, since the parts
+      // are mapped one by one anyway.
+      std::vector<std::filesystem::path> parts;
+      for (const auto &part :
+           std::filesystem::recursive_directory_iterator{entry}) {
+        if (part.is_regular_file() && is_table_file(part.path()))
+          parts.push_back(part.path());
+      }
+      if (parts.empty())
+        continue;
+      std::sort(parts.begin(), parts.end());
+      CatalogTable table;
+      for (const auto &part : parts)
+        table.files.push_back(open_table_file(part, table));
+      tables_.emplace(entry.filename().string(), std::move(table));
+    } else if (is_table_file(entry)) {
+      CatalogTable table;
+      table.files.push_back(open_table_file(entry, table));
+      tables_.emplace(entry.stem().string(), std::move(table));
+    }
+  }
+  spdlog::info("Loaded {} tables from {}", tables_.size(), output_dir);
+}
+
+auto TableCatalog::table(const std::string &name) const
+    -> const CatalogTable & {
+  const auto it = tables_.find(name);
+  if (it == tables_.end()) {
+    spdlog::error("No table named {}", name);
+    throw std::runtime_error("Unknown table");
+  }
+  return it->second;
+}
+
+auto TableCatalog::Scan(const ScanRequest &request) const
+    -> std::shared_ptr<TableScanner> {
+  return std::make_shared<TableScanner>(table(request.table), request);
+}
+
+TableScanner::TableScanner(const CatalogTable &table,
+                           const ScanRequest &request)
+    : table_(table), request_(request) {
+  const auto &schema = *table_.schema;
+  auto require_column = [&](const std::string &name) -> int {
+    const int index = schema.GetFieldIndex(name);
+    if (index < 0) {
+      spdlog::error("Table {} has no column {}", request_.table, name);
+      throw std::runtime_error("Unknown column");
+    }
+    return index;
+  };
+  auto first_present = [&](std::initializer_list<const char *> names) {
+    for (const char *name : names) {
+      if (schema.GetFieldIndex(name) >= 0)
+        return std::string(name);
+    }
+    return std::string();
+  };
+
+  std::vector<std::shared_ptr<arrow::Field>> output_fields;
+  if (request_.columns.empty()) {
+    for (const auto &field : schema.fields())
+      request_.columns.push_back(field->name());
+  }
+  for (const auto &name : request_.columns) {
+    const int index = require_column(name);
+    read_columns_.push_back(index);
+    output_fields.push_back(schema.field(index));
+  }
+  output_schema_ = arrow::schema(output_fields, schema.metadata());
+
+  if (!request_.pe_ids.empty()) {
+    pe_column_ = first_present({"pe_id", "src_pe"});
+    if (pe_column_.empty()) {
+      spdlog::error("Table {} has no PE column to filter on", request_.table);
+      throw std::runtime_error("Unsupported scan filter");
+    }
+  }
+  if (!request_.ep_ids.empty()) {
+    ep_column_ = first_present({"ep_id"});
+    if (ep_column_.empty()) {
+      spdlog::error("Table {} has no ep_id column to filter on",
+                    request_.table);
+      throw std::runtime_error("Unsupported scan filter");
+    }
+  }
+  if (request_.begin_us || request_.end_us) {
+    time_start_column_ =
+        first_present({"start_time_us", "send_time_us", "time_us"});
+    if (time_start_column_ == "start_time_us")
+      time_end_column_ = first_present({"end_time_us"});
+    if (time_start_column_.empty()) {
+      spdlog::error("Table {} has no time column to filter on",
+                    request_.table);
+      throw std::runtime_error("Unsupported scan filter");
+    }
+  }
+  for (const auto *column :
+       {&pe_column_, &ep_column_, &time_start_column_, &time_end_column_}) {
+    if (column->empty())
+      continue;
+    const int index = require_column(*column);
+    if (std::find(read_columns_.begin(), read_columns_.end(), index) ==
+        read_columns_.end())
+      read_columns_.push_back(index);
+  }
+  std::sort(request_.pe_ids.begin(), request_.pe_ids.end());
+  std::sort(request_.ep_ids.begin(), request_.ep_ids.end());
+}
+
+auto TableScanner::ReadNext(std::shared_ptr<arrow::RecordBatch> *batch)
+    -> arrow::Status {
+  try {
+    if (pending_.empty() && !LoadNext()) {
+      *batch = nullptr;
+      return arrow::Status::OK();
+    }
+  } catch (const std::exception &e) {
+    return arrow::Status::IOError(e.what());
+  }
+  *batch = std::move(pending_.front());
+  pending_.pop_front();
+  return arrow::Status::OK();
+}
+
+auto TableScanner::LoadNext() -> bool {
+  while (file_index_ < table_.files.size()) {
+    const auto &file = table_.files[file_index_];
+    if (file.parquet_metadata) {
+      const auto &metadata = *file.parquet_metadata;
+      while (next_unit_ < metadata.num_row_groups()) {
+        const int row_group = next_unit_++;
+        if (!MayMatch(*metadata.RowGroup(row_group))) {
+          ++row_groups_skipped_;
+          continue;
+        }
+        // Opened on the first row group that survives, so a file whose row
+        // groups are all ruled out is never read past the cached footer.
+        if (!parquet_reader_) {
+          parquet_reader_ = value_or_throw(
+              parquet::arrow::OpenFile(file.file, arrow::default_memory_pool()),
+              "Could not open " + file.path);
+        }
+        ++row_groups_read_;
+        std::shared_ptr<arrow::Table> rows;
+        throw_not_ok(
+            parquet_reader_->ReadRowGroup(row_group, read_columns_, &rows),
+            "Could not read " + file.path);
+        arrow::TableBatchReader batches(*rows);
+        std::shared_ptr<arrow::RecordBatch> batch;
+        while (true) {
+          throw_not_ok(batches.ReadNext(&batch),
+                       "Could not read " + file.path);
+          if (!batch)
+            break;
+          Filter(batch);
+        }
+        if (!pending_.empty())
+          return true;
+      }
+      parquet_reader_.reset();
+    } else {
+      if (!ipc_reader_) {
+        auto options = arrow::ipc::IpcReadOptions::Defaults();
+        options.included_fields = read_columns_;
+        ipc_reader_ = value_or_throw(
+            arrow::ipc::RecordBatchFileReader::Open(file.file, options),
+            "Could not open " + file.path);
+      }
+      while (next_unit_ < ipc_reader_->num_record_batches()) {
+        Filter(value_or_throw(ipc_reader_->ReadRecordBatch(next_unit_++),
+                              "Could not read " + file.path));
+        if (!pending_.empty())
+          return true;
+      }
+      ipc_reader_.reset();
+    }
+    ++file_index_;
+    next_unit_ = 0;
+  }
+  return false;
+}
+
+auto TableScanner::MayMatch(const parquet::RowGroupMetaData &row_group) const
+    -> bool {
+  // The tables are flat, so a column's Arrow field index is also its Parquet
+  // leaf index.
+  auto range = [&](const std::string &column) {
+    return int_range(row_group, table_.schema->GetFieldIndex(column));
+  };
+  if (!pe_column_.empty()) {
+    const auto pes = range(pe_column_);
+    if (pes && !any_in_range(request_.pe_ids, *pes))
+      return false;
+  }
+  if (!ep_column_.empty()) {
+    const auto eps = range(ep_column_);
+    if (eps && !any_in_range(request_.ep_ids, *eps))
+      return false;
+  }
+  if (!time_start_column_.empty()) {
+    const auto starts = range(time_start_column_);
+    if (starts && request_.end_us && starts->first >= *request_.end_us)
+      return false;
+    if (request_.begin_us) {
+      if (time_end_column_.empty()) {
+        if (starts && starts->second < *request_.begin_us)
+          return false;
+      } else {
+        // A NULL end is an interval still open, which reaches every later
+        // begin, so the ends' max rules a row group out only if it has none.
+        const int end_index = table_.schema->GetFieldIndex(time_end_column_);
+        const auto stats = row_group.ColumnChunk(end_index)->statistics();
+        const auto ends = range(time_end_column_);
+        if (ends && stats->HasNullCount() && stats->null_count() == 0 &&
+            ends->second < *request_.begin_us)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+void TableScanner::Filter(const std::shared_ptr<arrow::RecordBatch> &batch) {
+  auto column = [&](const std::string &name) -> const arrow::Array * {
+    return name.empty() ? nullptr : batch->GetColumnByName(name).get();
+  };
+  const auto *pes = column(pe_column_);
+  const auto *eps = column(ep_column_);
+  const auto *starts = column(time_start_column_);
+  const auto *ends = column(time_end_column_);
+
+  auto keep = [&](int64_t row) {
+    auto in = [&](const arrow::Array *array, const std::vector<int32_t> &ids) {
+      const auto value = int_at(*array, row);
+      return value && std::binary_search(ids.begin(), ids.end(), *value);
+    };
+    if (pes && !in(pes, request_.pe_ids))
+      return false;
+    if (eps && !in(eps, request_.ep_ids))
+      return false;
+    if (starts) {
+      const auto start = int_at(*starts, row);
+      if (!start)
+        return false;
+      if (request_.end_us && *start >= *request_.end_us)
+        return false;
+      if (request_.begin_us) {
+        if (ends) {
+          const auto end = int_at(*ends, row);
+          if (end && *end < *request_.begin_us)
+            return false;
+        } else if (*start < *request_.begin_us) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  // Kept rows as runs of consecutive rows. On sorted output a filter keeps
+  // one long run, which is passed through as a zero-copy slice.
+  std::vector<std::pair<int64_t, int64_t>> runs;
+  for (int64_t row = 0; row < batch->num_rows(); ++row) {
+    if (!keep(row))
+      continue;
+    if (!runs.empty() && runs.back().first + runs.back().second == row) {
+      ++runs.back().second;
+    } else {
+      runs.emplace_back(row, 1);
+    }
+  }
+  if (runs.empty())
+    return;
+
+  std::vector<int> output_indices;
+  for (const auto &field : output_schema_->fields())
+    output_indices.push_back(batch->schema()->GetFieldIndex(field->name()));
+
+  if (runs.size() == 1) {
+    auto columns = value_or_throw(batch->SelectColumns(output_indices),
+                                  "Could not project batch");
+    auto slice = columns->Slice(runs[0].first, runs[0].second);
+    pending_.push_back(
+        arrow::RecordBatch::Make(output_schema_, slice->num_rows(),
+                                 slice->columns()));
+    return;
+  }
+
+  int64_t kept = 0;
+  for (const auto &run : runs)
+    kept += run.second;
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (const int index : output_indices) {
+    arrow::ArrayVector pieces;
+    for (const auto &[offset, length] : runs)
+      pieces.push_back(batch->column(index)->Slice(offset, length));
+    columns.push_back(value_or_throw(arrow::Concatenate(pieces),
+                                     "Could not gather filtered rows"));
+  }
+  pending_.push_back(
+      arrow::RecordBatch::Make(output_schema_, kept, std::move(columns)));
+}
+
+} // namespace charmvz
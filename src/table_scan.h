@@ -0,0 +1,142 @@
+#pragma once
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/reader.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <parquet/arrow/reader.h>
+#include <string>
+#include <vector>
+
+namespace charmvz {
+
+// One read of one output table: which columns, and which rows by PE, entry
+// method and time. An empty list or an unset bound means no restriction.
+//
+// The filters name concepts rather than columns, because the tables do not
+// agree on the column names: the PE is `pe_id` where a table has one and
+// `src_pe` otherwise, and the time is the [start_time_us, end_time_us]
+// interval where a table has one and its single timestamp (`send_time_us`,
+// `time_us`) otherwise. A filter on a table with no such column is an error,
+// not a no-op, so a typo'd request cannot silently return everything.
+struct ScanRequest {
+  std::string table;
+  std::vector<std::string> columns;
+  std::vector<int32_t> pe_ids;
+  std::vector<int32_t> ep_ids;
+  // Half-open [begin_us, end_us). An interval row is kept if it overlaps the
+  // range; a row whose end is NULL is still open and overlaps everything
+  // after its start.
+  std::optional<int64_t> begin_us;
+  std::optional<int64_t> end_us;
+};
+
+// The request as text, `key=value` pairs separated by `;`, with list values
+// comma-separated:
+//
+//   table=execution;columns=pe_id,ep_id;pe_id=0,3;ep_id=11;time_us=100,500
+//
+// Either time bound may be left empty (`time_us=,500`). This is the Flight
+// ticket and command body, chosen so that any client can build one by hand.
+auto encode_scan_request(const ScanRequest &request) -> std::string;
+auto decode_scan_request(const std::string &text) -> ScanRequest;
+
+// One file of a table: the table itself, or one part of a partitioned
+// dataset. Memory-mapped once when the catalog loads and shared read-only by
+// every scan, so repeated reads are served from the page cache.
+struct TableFile {
+  std::string path;
+  std::shared_ptr<arrow::io::MemoryMappedFile> file;
+  // Set for Parquet files, whose footer is parsed once here rather than on
+  // every request. Null for Arrow IPC files.
+  std::shared_ptr<parquet::FileMetaData> parquet_metadata;
+};
+
+struct CatalogTable {
+  std::shared_ptr<arrow::Schema> schema;
+  std::vector<TableFile> files;
+  int64_t num_rows = 0;
+};
+
+class TableScanner;
+
+// The tables of one output directory, in either format and either layout:
+// `<table>.parquet`, `<table>.arrow`, or a `<table>/` directory of
+// partitioned parts.
+class TableCatalog {
+public:
+  explicit TableCatalog(const std::string &output_dir);
+
+  [[nodiscard]] auto tables() const
+      -> const std::map<std::string, CatalogTable> & {
+    return tables_;
+  }
+  // Throws if the table is not in the catalog.
+  [[nodiscard]] auto table(const std::string &name) const
+      -> const CatalogTable &;
+  // Validates the request against the table's schema and returns a reader of
+  // the matching rows. Throws on an unknown table or column, or a filter the
+  // table has no column for.
+  [[nodiscard]] auto Scan(const ScanRequest &request) const
+      -> std::shared_ptr<TableScanner>;
+
+private:
+  std::map<std::string, CatalogTable> tables_;
+};
+
+// Reads the rows of a ScanRequest one batch at a time. Parquet row groups
+// whose min/max statistics rule out every requested PE, entry method or the
+// time range are skipped without being read; the rows of the remaining ones
+// are filtered exactly. Output batches hold only the requested columns.
+class TableScanner : public arrow::RecordBatchReader {
+public:
+  TableScanner(const CatalogTable &table, const ScanRequest &request);
+
+  [[nodiscard]] auto schema() const -> std::shared_ptr<arrow::Schema> override {
+    return output_schema_;
+  }
+  auto ReadNext(std::shared_ptr<arrow::RecordBatch> *batch)
+      -> arrow::Status override;
+
+  [[nodiscard]] auto row_groups_read() const -> int64_t {
+    return row_groups_read_;
+  }
+  [[nodiscard]] auto row_groups_skipped() const -> int64_t {
+    return row_groups_skipped_;
+  }
+
+private:
+  // Loads the next unit of the scan -- a Parquet row group that survives
+  // pruning, or an IPC record batch -- into pending_. False once every file
+  // is exhausted.
+  auto LoadNext() -> bool;
+  [[nodiscard]] auto MayMatch(const parquet::RowGroupMetaData &row_group) const
+      -> bool;
+  void Filter(const std::shared_ptr<arrow::RecordBatch> &batch);
+
+  // A copy, so a scan holds its files open even if the catalog goes away.
+  CatalogTable table_;
+  ScanRequest request_;
+  std::shared_ptr<arrow::Schema> output_schema_;
+  // The requested columns, then any filter column not requested.
+  std::vector<int> read_columns_;
+  // Names of the filter columns; empty when that filter is unused or, for
+  // time_end_column_, when the table has a single timestamp.
+  std::string pe_column_;
+  std::string ep_column_;
+  std::string time_start_column_;
+  std::string time_end_column_;
+
+  size_t file_index_ = 0;
+  int next_unit_ = 0;
+  std::unique_ptr<parquet::arrow::FileReader> parquet_reader_;
+  std::shared_ptr<arrow::ipc::RecordBatchFileReader> ipc_reader_;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> pending_;
+  int64_t row_groups_read_ = 0;
+  int64_t row_groups_skipped_ = 0;
+};
+
+} // namespace charmvz
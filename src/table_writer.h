@@ -0,0 +1,27 @@
+#pragma once
+#include <arrow/api.h>
+#include <memory>
+
+namespace charmvz {
+
+// A sink for one output table. The builders flush record batches into it
+// without knowing which file format is on the other end.
+class TableWriter {
+public:
+  virtual ~TableWriter() = default;
+  virtual void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) = 0;
+  virtual void Close() = 0;
+  // The pool the table's writer allocates from, and its builders should too.
+  [[nodiscard]] virtual auto pool() const -> arrow::MemoryPool * {
+    return arrow::default_memory_pool();
+  }
+};
+
+// Accepts batches and keeps none: the sink for a table that was not asked for.
+class NullWriter : public TableWriter {
+public:
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> /*batch*/) override {}
+  void Close() override {}
+};
+
+} // namespace charmvz
@@ -0,0 +1,127 @@
+#include "timeline.h"
+#include <algorithm>
+#include <map>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace charmvz {
+
+namespace {
+
+// Floor division, so a span before the global start lands in the pixel and
+// tile that hold it.
+auto floor_div(int64_t value, int64_t divisor) -> int64_t {
+  const int64_t quotient = value / divisor;
+  return value % divisor < 0 ? quotient - 1 : quotient;
+}
+
+// The executions shorter than a pixel that fall in one.
+struct Pixel {
+  std::map<int32_t, int64_t> busy_by_ep;
+  int64_t busy_us = 0;
+  int32_t execution_count = 0;
+};
+
+} // namespace
+
+TimelinePyramid::TimelinePyramid(int32_t levels, int64_t base_pixel_us)
+    : levels_(levels), base_pixel_us_(base_pixel_us) {
+  if (levels_ <= 0 || base_pixel_us_ <= 0) {
+    spdlog::error("A timeline needs at least one level and a positive pixel "
+                  "width, got {} levels of {} us",
+                  levels_, base_pixel_us_);
+    throw std::runtime_error("Invalid timeline pyramid");
+  }
+}
+
+auto TimelinePyramid::pixel_us(int32_t level) const -> int64_t {
+  int64_t pixel = base_pixel_us_;
+  for (int32_t i = 0; i < level; ++i)
+    pixel *= kLevelFactor;
+  return pixel;
+}
+
+void TimelinePyramid::Add(int32_t ep_id, int64_t start_us, int64_t end_us) {
+  spans_.push_back({start_us, std::max(start_us, end_us), ep_id});
+}
+
+void TimelinePyramid::Drain(int32_t pe_id,
+                            const std::vector<TimelineBuilder *> &levels) {
+  // Executions on a PE follow one another or nest, and a nested one arrives
+  // first, since it ends first. Only the outermost is drawn, so a pixel is
+  // never busier than its width and a caller is not credited with its
+  // callees' time twice. In start order, with the longer of two that start
+  // together first, a span is nested when it starts inside the last one
+  // kept.
+  std::sort(spans_.begin(), spans_.end(), [](const Span &a, const Span &b) {
+    return a.start_us != b.start_us ? a.start_us < b.start_us
+                                    : a.end_us > b.end_us;
+  });
+  size_t kept = 0;
+  for (const Span &span : spans_) {
+    if (kept > 0 && span.start_us < spans_[kept - 1].end_us)
+      continue;
+    spans_[kept++] = span;
+  }
+  spans_.resize(kept);
+
+  for (int32_t level = 0; level < levels_; ++level) {
+    for (const auto &segment : Segments(pe_id, level))
+      levels[static_cast<size_t>(level)]->Append(segment);
+  }
+  spans_.clear();
+}
+
+auto TimelinePyramid::Segments(int32_t pe_id, int32_t level) const
+    -> std::vector<TimelineSegment> {
+  const int64_t pixel = pixel_us(level);
+  const int64_t tile = tile_us(level);
+  std::vector<TimelineSegment> segments;
+  std::map<int64_t, Pixel> pixels;
+
+  for (const Span &span : spans_) {
+    if (span.end_us - span.start_us >= pixel) {
+      for (int64_t t = floor_div(span.start_us, tile); t * tile < span.end_us;
+           ++t) {
+        const int64_t from = std::max(span.start_us, t * tile);
+        const int64_t to = std::min(span.end_us, (t + 1) * tile);
+        segments.push_back(
+            {pe_id, t, from, to, span.ep_id, to - from, 1, false});
+      }
+      continue;
+    }
+    // Shorter than a pixel, so it touches at most two. It counts as an
+    // execution of the pixel it starts in, and its time goes to each pixel
+    // in the part that falls there.
+    const int64_t first = floor_div(span.start_us, pixel);
+    ++pixels[first].execution_count;
+    pixels[first].busy_by_ep[span.ep_id] += 0;
+    for (int64_t p = first; p * pixel < span.end_us; ++p) {
+      const int64_t from = std::max(span.start_us, p * pixel);
+      const int64_t to = std::min(span.end_us, (p + 1) * pixel);
+      pixels[p].busy_by_ep[span.ep_id] += to - from;
+      pixels[p].busy_us += to - from;
+    }
+  }
+
+  for (const auto &[p, merged] : pixels) {
+    auto dominant = merged.busy_by_ep.begin();
+    for (auto it = merged.busy_by_ep.begin(); it != merged.busy_by_ep.end();
+         ++it) {
+      if (it->second > dominant->second)
+        dominant = it;
+    }
+    segments.push_back({pe_id, floor_div(p, kTilePixels), p * pixel,
+                        (p + 1) * pixel, dominant->first, merged.busy_us,
+                        merged.execution_count, true});
+  }
+
+  std::sort(segments.begin(), segments.end(),
+            [](const TimelineSegment &a, const TimelineSegment &b) {
+              return std::tie(a.tile, a.start_us, a.end_us) <
+                     std::tie(b.tile, b.start_us, b.end_us);
+            });
+  return segments;
+}
+
+} // namespace charmvz
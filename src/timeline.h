@@ -0,0 +1,76 @@
+#pragma once
+#include "table_builder.h"
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace charmvz {
+
+// One segment of a timeline level. A segment is either a single execution at
+// least a pixel long, clipped to its tile, or one pixel's worth of shorter
+// executions merged, with the entry method that kept the PE busiest in it.
+struct TimelineSegment {
+  int32_t pe_id;
+  int64_t tile;
+  int64_t start_us;
+  int64_t end_us;
+  int32_t ep_id;
+  int64_t busy_us;
+  int32_t execution_count;
+  bool merged;
+};
+
+template <> struct builders::RowDescriptor<TimelineSegment> {
+  using R = TimelineSegment;
+  static constexpr auto columns =
+      std::make_tuple(&R::pe_id, &R::tile, &R::start_us, &R::end_us,
+                      &R::ep_id, &R::busy_us, &R::execution_count, &R::merged);
+};
+
+using TimelineBuilder = builders::TableBuilder<TimelineSegment>;
+
+// A PE's executions as a level-of-detail pyramid for zoomable rendering.
+// Level k draws with pixels of pixel_us(k) = base * 4^k microseconds and is
+// cut into tiles of kTilePixels pixels, so a viewer at any zoom picks the
+// level whose pixel is about one screen pixel and reads only the tiles in
+// view. Executions shorter than the level's pixel are merged per pixel; the
+// rest are kept, split where they cross a tile edge.
+class TimelinePyramid {
+public:
+  static constexpr int64_t kTilePixels = 1024;
+  static constexpr int64_t kLevelFactor = 4;
+
+  TimelinePyramid(int32_t levels, int64_t base_pixel_us);
+
+  [[nodiscard]] auto levels() const -> int32_t { return levels_; }
+  [[nodiscard]] auto pixel_us(int32_t level) const -> int64_t;
+  [[nodiscard]] auto tile_us(int32_t level) const -> int64_t {
+    return pixel_us(level) * kTilePixels;
+  }
+
+  // One execution of the PE being read, in microseconds from the global
+  // start. One nested in another is dropped when the PE is drained.
+  void Add(int32_t ep_id, int64_t start_us, int64_t end_us);
+
+  // Appends the PE's segments of level k to `levels[k]`, ordered by tile and
+  // start, and starts over for the next PE.
+  void Drain(int32_t pe_id, const std::vector<TimelineBuilder *> &levels);
+
+private:
+  struct Span {
+    int64_t start_us;
+    int64_t end_us;
+    int32_t ep_id;
+  };
+
+  // The level's segments for the spans, ordered by (tile, start_us).
+  [[nodiscard]] auto Segments(int32_t pe_id, int32_t level) const
+      -> std::vector<TimelineSegment>;
+
+  int32_t levels_;
+  int64_t base_pixel_us_;
+  std::vector<Span> spans_;
+};
+
+} // namespace charmvz
@@ -6,7 +6,6 @@
 #include <vector>
 
 constexpr int32_t IDLE_ENTRY = -1;
-constexpr size_t NUMPAPIEVENTS = 6;
 
 // Chare-index slots stored per chare instance. Matches the `int[6]` used by the
 // Projections Java reader (misc/LogEntry.java); Charm++ can in principle write
@@ -65,7 +64,9 @@ struct LogEntry {
   uint64_t irecvtime;
   uint64_t icputime;
   int32_t id[CHARE_INDEX_SLOTS];
-  uint64_t papiValues[NUMPAPIEVENTS];
+  // One value per TOTAL_PAPI_EVENTS counter, on BEGIN/END_PROCESSING only;
+  // empty when the trace was collected without PAPI.
+  std::vector<uint64_t> papiValues;
   int32_t numpes;
   std::vector<int32_t> pes;
   // End timestamp of a self-contained bracketed record
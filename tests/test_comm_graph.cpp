@@ -0,0 +1,183 @@
+// ep_comm_graph and pe_comm_matrix: message totals per sending and receiving
+// entry method and PE, the same whether one thread links every message or a
+// thread per bucket does.
+
+#include "comm_graph.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "reconstruction.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 2\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "CHARE 1 \"Other\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 21 \"three(dummyMsg*)\" 1 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+// PE 0's ep 11 sends twice to ep 12 and once to ep 21, which PE 1 runs 40,
+// 60 and 80 us after the sends, and PE 0 sends once to ep 12 outside any
+// execution, which never runs. PE 1's ep 11 sends to ep 12 on PE 0, 20 us.
+void build_trace(TempTrace &trace) {
+  trace.add_log(0, "2 0 11 100 1 1 64 90 0 0\n"
+                   "1 0 12 110 2 1 100 0\n"
+                   "1 0 21 120 3 1 40 0\n"
+                   "1 0 12 125 5 1 100 0\n"
+                   "3 0 11 130 1 1 64 0\n"
+                   "1 0 12 140 4 1 50 0\n"
+                   "2 0 12 330 7 1 100 320 0 0\n"
+                   "3 0 12 340 7 1 100 0\n");
+  trace.add_log(1, "2 0 12 150 2 0 100 145 0 0\n"
+                   "3 0 12 160 2 0 100 0\n"
+                   "2 0 12 185 5 0 100 180 0 0\n"
+                   "3 0 12 195 5 0 100 0\n"
+                   "2 0 21 200 3 0 40 190 0 0\n"
+                   "3 0 21 210 3 0 40 0\n"
+                   "2 0 11 300 6 0 64 290 0 0\n"
+                   "1 0 12 310 7 0 100 0\n"
+                   "3 0 11 320 6 0 64 0\n");
+}
+
+void run(const TempTrace &trace, const charmvz::OutputOptions &options) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  const auto result =
+      charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                            charmvz::NO_STEP_EVENT, options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+}
+
+} // namespace
+
+TEST_CASE("ep_comm_graph totals messages per entry-method pair",
+          "[comm_graph]") {
+  charmvz::OutputOptions options;
+  SECTION("linked on one thread") { options.partition_buckets = 0; }
+  // PE 0's and PE 1's sends to ep 12 are linked in different buckets and
+  // merged afterwards.
+  SECTION("linked a bucket per thread") { options.partition_buckets = 2; }
+
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, options);
+
+  ParquetTable graph(trace.out_dir() + "/ep_comm_graph.parquet");
+  REQUIRE(graph.rows() == 3);
+  CHECK(graph.ints("sender_ep_id") == V{std::nullopt, 11, 11});
+  CHECK(graph.ints("receiver_ep_id") == V{12, 12, 21});
+  CHECK(graph.ints("sender_collection_id") == V{std::nullopt, 0, 0});
+  CHECK(graph.ints("receiver_collection_id") == V{0, 0, 1});
+  CHECK(graph.ints("message_count") == V{1, 3, 1});
+  CHECK(graph.ints("total_bytes") == V{50, 300, 40});
+  CHECK(graph.ints("delivery_count") == V{0, 3, 1});
+  CHECK(graph.ints("min_latency_us") == V{std::nullopt, 20, 80});
+  CHECK(graph.ints("max_latency_us") == V{std::nullopt, 60, 80});
+  CHECK(graph.doubles("mean_latency_us") ==
+        std::vector<std::optional<double>>{std::nullopt, 40.0, 80.0});
+}
+
+TEST_CASE("pe_comm_matrix totals deliveries per PE pair", "[comm_graph]") {
+  charmvz::OutputOptions options;
+  SECTION("linked on one thread") { options.partition_buckets = 0; }
+  SECTION("linked a bucket per thread") { options.partition_buckets = 2; }
+
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, options);
+
+  // PE 0's send that never ran reached no PE, so it has no cell.
+  ParquetTable matrix(trace.out_dir() + "/pe_comm_matrix.parquet");
+  REQUIRE(matrix.rows() == 2);
+  CHECK(matrix.ints("src_pe") == V{0, 1});
+  CHECK(matrix.ints("dst_pe") == V{1, 0});
+  CHECK(matrix.ints("bin_start_us") == V{std::nullopt, std::nullopt});
+  CHECK(matrix.ints("message_count") == V{3, 1});
+  CHECK(matrix.ints("total_bytes") == V{240, 100});
+  CHECK(matrix.ints("total_latency_us") == V{180, 20});
+  CHECK(matrix.ints("latency_count") == V{3, 1});
+}
+
+TEST_CASE("pe_comm_matrix bins deliveries by send time", "[comm_graph]") {
+  charmvz::OutputOptions options;
+  options.time_bin_us = 10;
+
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, options);
+
+  // PE 0 sent to PE 1 at 110, 120 and 125.
+  ParquetTable matrix(trace.out_dir() + "/pe_comm_matrix.parquet");
+  REQUIRE(matrix.rows() == 3);
+  CHECK(matrix.ints("src_pe") == V{0, 0, 1});
+  CHECK(matrix.ints("dst_pe") == V{1, 1, 0});
+  CHECK(matrix.ints("bin_start_us") == V{110, 120, 310});
+  CHECK(matrix.ints("message_count") == V{1, 2, 1});
+  CHECK(matrix.ints("total_bytes") == V{100, 140, 100});
+  CHECK(matrix.ints("total_latency_us") == V{40, 140, 20});
+}
+
+TEST_CASE("A dense and a sparse pe_comm_matrix agree", "[comm_graph]") {
+  using charmvz::PeCommMatrix;
+  CHECK(PeCommMatrix::DensePes(64, 4, 0) == 64);
+  CHECK(PeCommMatrix::DensePes(64, 4, 1000) == 0);
+  CHECK(PeCommMatrix::DensePes(10000, 1, 0) == 0);
+
+  // PE 5 is past the dense matrix's side, so it falls back to the map there.
+  auto fill = [](PeCommMatrix &a, PeCommMatrix &b) {
+    a.Add(1, 0, 10, 8, 3);
+    a.Add(0, 1, 20, 16, std::nullopt);
+    a.Add(5, 0, 30, 4, 7);
+    b.Add(1, 0, 40, 8, 5);
+    b.Add(0, 5, 50, 2, 1);
+    a.Merge(b);
+  };
+  PeCommMatrix dense(4, 0);
+  PeCommMatrix dense_other(4, 0);
+  PeCommMatrix sparse(0, 0);
+  PeCommMatrix sparse_other(0, 0);
+  fill(dense, dense_other);
+  fill(sparse, sparse_other);
+
+  const auto rows = dense.Rows();
+  const auto expected = sparse.Rows();
+  REQUIRE(rows.size() == 4);
+  REQUIRE(expected.size() == 4);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    CHECK(rows[i].src_pe == expected[i].src_pe);
+    CHECK(rows[i].dst_pe == expected[i].dst_pe);
+    CHECK_FALSE(rows[i].bin_start_us);
+    CHECK(rows[i].message_count == expected[i].message_count);
+    CHECK(rows[i].total_bytes == expected[i].total_bytes);
+    CHECK(rows[i].total_latency_us == expected[i].total_latency_us);
+    CHECK(rows[i].latency_count == expected[i].latency_count);
+  }
+  CHECK(rows[0].src_pe == 0);
+  CHECK(rows[0].dst_pe == 1);
+  CHECK(rows[0].latency_count == 0);
+  CHECK(rows[2].src_pe == 1);
+  CHECK(rows[2].message_count == 2);
+  CHECK(rows[2].total_latency_us == 8);
+}
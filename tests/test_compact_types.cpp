@@ -0,0 +1,114 @@
+// --compact-types: execution and message keep their values in uint16 ids and
+// int32 durations, and a value that does not fit stops the write instead of
+// wrapping.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "sts_parser.h"
+#include "table_builder.h"
+#include "table_writer.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 1\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 65000 \"one(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+auto field_type(const std::string &path, const std::string &column)
+    -> arrow::Type::type {
+  auto infile = arrow::io::ReadableFile::Open(path).ValueOrDie();
+  auto reader = parquet::arrow::OpenFile(infile, arrow::default_memory_pool())
+                    .ValueOrDie();
+  std::shared_ptr<arrow::Schema> schema;
+  REQUIRE(reader->GetSchema(&schema).ok());
+  const auto field = schema->GetFieldByName(column);
+  REQUIRE(field != nullptr);
+  return field->type()->id();
+}
+
+struct Wide {
+  int64_t value;
+};
+
+class DiscardingWriter : public charmvz::TableWriter {
+public:
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> /*batch*/) override {
+    ++batches;
+  }
+  void Close() override {}
+
+  int batches = 0;
+};
+
+} // namespace
+
+template <> struct charmvz::builders::RowDescriptor<Wide> {
+  static constexpr auto columns = std::make_tuple(&Wide::value);
+};
+
+TEST_CASE("Compact types narrow ids and durations but keep their values",
+          "[compact_types]") {
+  TempTrace trace(kSts);
+  // An ep_id above INT16_MAX still fits uint16.
+  trace.add_log(0, "2 0 65000 100 1 0 64 900 7 0\n"
+                   "3 0 65000 300 1 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.compact_types = true;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+
+  const auto path = trace.out_dir() + "/execution.parquet";
+  CHECK(field_type(path, "ep_id") == arrow::Type::UINT16);
+  CHECK(field_type(path, "msg_idx") == arrow::Type::UINT16);
+  CHECK(field_type(path, "wall_duration_us") == arrow::Type::INT32);
+  CHECK(field_type(path, "start_time_us") == arrow::Type::INT64);
+
+  ParquetTable exec(path);
+  CHECK(exec.ints("ep_id") == V{65000});
+  CHECK(exec.ints("wall_duration_us") == V{200});
+  CHECK(exec.ints("start_time_us") == V{100});
+}
+
+TEST_CASE("A value outside a narrowed column's range is refused",
+          "[compact_types]") {
+  DiscardingWriter writer;
+  const auto schema =
+      arrow::schema({arrow::field("value", arrow::int32(), false)});
+  charmvz::builders::TableBuilder<Wide> builder(writer, schema);
+  builder.Append({int64_t{1} << 31});
+  CHECK_THROWS_AS(builder.Flush(), std::runtime_error);
+  CHECK(writer.batches == 0);
+
+  charmvz::builders::TableBuilder<Wide> fits(writer, schema);
+  fits.Append({-(int64_t{1} << 31)});
+  fits.Flush();
+  CHECK(writer.batches == 1);
+}
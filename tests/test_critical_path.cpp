@@ -0,0 +1,189 @@
+// The critical path: the longest chain of executions and messages in each
+// simulation step, and every execution's slack against it.
+
+#include "critical_path.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "table_writer.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::CapturingWriter;
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+using S = std::vector<std::optional<std::string>>;
+
+auto int64s(const arrow::RecordBatch &batch, const std::string &name) -> V {
+  const auto array = batch.GetColumnByName(name);
+  V values;
+  for (int64_t i = 0; i < array->length(); ++i) {
+    if (array->type_id() == arrow::Type::INT32) {
+      values.emplace_back(
+          std::static_pointer_cast<arrow::Int32Array>(array)->Value(i));
+    } else {
+      values.emplace_back(
+          std::static_pointer_cast<arrow::Int64Array>(array)->Value(i));
+    }
+  }
+  return values;
+}
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 1\n"
+                      "TOTAL_STATS 0\n"
+                      "EVENT 4 SimulationStep\n"
+                      "END\n";
+
+} // namespace
+
+TEST_CASE("The path follows the message that arrives last",
+          "[critical_path]") {
+  // A on PE 0 sends B's message at 50, and it takes 70us to arrive. B waits
+  // on it rather than on D, which ran before it on PE 1; C follows A on PE 0
+  // but ends the sooner.
+  charmvz::DependencyGraph graph(
+      {{0, 0, 1, 11, 0, 100, 0},
+       {1, 0, 2, 12, 150, 200, 120},
+       {0, 0, 3, 11, 100, 130, 95},
+       {1, 1, 4, 12, 10, 20, 5}},
+      {});
+  graph.AddMessage(0, 2, 50);
+  // No execution ran this message, and none was running to send this one.
+  graph.AddMessage(0, 9, 60);
+  graph.AddMessage(1, 3, 500);
+
+  CapturingWriter path_writer;
+  CapturingWriter slack_writer;
+  charmvz::CriticalPathBuilder path(path_writer,
+                                    charmvz::schema::critical_path());
+  charmvz::ExecutionSlackBuilder slack(slack_writer,
+                                       charmvz::schema::execution_slack());
+  graph.Solve(path, slack);
+  path.Flush();
+  slack.Flush();
+
+  REQUIRE(path_writer.batches.size() == 1);
+  const auto &segments = *path_writer.batches.front();
+  CHECK(segments.GetColumnByName("step_id")->null_count() == 3);
+  CHECK(int64s(segments, "segment") == V{0, 1, 2});
+  const auto kinds = std::static_pointer_cast<arrow::StringArray>(
+      segments.GetColumnByName("kind"));
+  CHECK(kinds->GetString(0) == "execution");
+  CHECK(kinds->GetString(1) == "message");
+  CHECK(kinds->GetString(2) == "execution");
+  CHECK(int64s(segments, "pe_id") == V{0, 1, 1});
+  CHECK(int64s(segments, "event") == V{1, 2, 2});
+  CHECK(int64s(segments, "start_us") == V{0, 50, 150});
+  CHECK(int64s(segments, "end_us") == V{50, 120, 200});
+  CHECK(int64s(segments, "path_us") == V{50, 120, 170});
+
+  // In start order: A, D, C, B.
+  REQUIRE(slack_writer.batches.size() == 1);
+  const auto &executions = *slack_writer.batches.front();
+  CHECK(int64s(executions, "event") == V{1, 4, 3, 2});
+  CHECK(int64s(executions, "slack_us") == V{0, 110, 40, 0});
+  const auto on_path = std::static_pointer_cast<arrow::BooleanArray>(
+      executions.GetColumnByName("on_critical_path"));
+  CHECK(on_path->Value(0));
+  CHECK_FALSE(on_path->Value(1));
+  CHECK_FALSE(on_path->Value(2));
+  CHECK(on_path->Value(3));
+}
+
+TEST_CASE("A nested execution continues its parent's path",
+          "[critical_path]") {
+  // B runs inside A, and C's message is sent from B.
+  charmvz::DependencyGraph graph({{0, 0, 1, 11, 0, 100, 0},
+                                  {0, 0, 2, 12, 20, 40, 0},
+                                  {1, 0, 3, 11, 60, 90, 50}},
+                                 {});
+  graph.AddMessage(0, 3, 30);
+
+  CapturingWriter path_writer;
+  CapturingWriter slack_writer;
+  charmvz::CriticalPathBuilder path(path_writer,
+                                    charmvz::schema::critical_path());
+  charmvz::ExecutionSlackBuilder slack(slack_writer,
+                                       charmvz::schema::execution_slack());
+  graph.Solve(path, slack);
+  path.Flush();
+  slack.Flush();
+
+  // A's 100us beat the 20 + 10 + 20 + 30 through B to C.
+  const auto &segments = *path_writer.batches.front();
+  CHECK(int64s(segments, "event") == V{1});
+  CHECK(int64s(segments, "path_us") == V{100});
+  const auto &executions = *slack_writer.batches.front();
+  CHECK(int64s(executions, "slack_us") == V{0, 20, 20});
+}
+
+TEST_CASE("critical_path is split by simulation step", "[critical_path]") {
+  TempTrace trace(kSts);
+  // PE 0 brackets steps 0 and 1; PE 1 spends the whole run in step 0. A's
+  // message to B is on step 0's path; C's to E crosses steps and is not an
+  // edge.
+  trace.add_log(0, "98 4 0 90 0 0\n"
+                   "2 0 11 100 1 0 64 90 7 0\n"
+                   "1 0 12 150 5 1 64 0\n"
+                   "3 0 11 200 1 0 64 0\n"
+                   "99 4 300 91 0 0\n"
+                   "98 4 300 92 0 1\n"
+                   "2 0 11 400 2 0 64 390 7 0\n"
+                   "1 0 12 420 6 1 64 0\n"
+                   "3 0 11 450 2 0 64 0\n"
+                   "99 4 500 93 0 1\n");
+  trace.add_log(1, "98 4 0 94 1 0\n"
+                   "2 0 12 10 7 1 64 5 7 0\n"
+                   "3 0 12 20 7 1 64 0\n"
+                   "2 0 12 250 5 0 64 230 7 0\n"
+                   "3 0 12 350 5 0 64 0\n"
+                   "2 0 12 600 6 0 64 430 7 0\n"
+                   "3 0 12 700 6 0 64 0\n"
+                   "99 4 1000 95 1 0\n");
+
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.critical_path = true;
+  const auto result = charmvz::process_logs(
+      trace.log_paths(), sts, rc, trace.out_dir(),
+      charmvz::find_user_event_id(sts, "SimulationStep"), options);
+  charmvz::reconstruct_critical_path(result, rc, trace.out_dir(), options);
+
+  ParquetTable path(trace.out_dir() + "/critical_path.parquet");
+  CHECK(path.ints("step_id") == V{0, 0, 0, 0, 1});
+  CHECK(path.ints("segment") == V{0, 1, 2, 3, 0});
+  CHECK(path.strings("kind") == S{"execution", "message", "execution",
+                                  "execution", "execution"});
+  CHECK(path.ints("pe_id") == V{0, 1, 1, 1, 0});
+  CHECK(path.ints("start_us") == V{100, 150, 250, 600, 400});
+  CHECK(path.ints("end_us") == V{150, 230, 350, 700, 450});
+  CHECK(path.ints("path_us") == V{50, 130, 230, 330, 50});
+
+  ParquetTable slack(trace.out_dir() + "/execution_slack.parquet");
+  CHECK(slack.ints("start_us") == V{10, 100, 250, 400, 600});
+  CHECK(slack.ints("step_id") == V{0, 0, 0, 1, 0});
+  CHECK(slack.ints("slack_us") == V{120, 0, 0, 0, 0});
+}
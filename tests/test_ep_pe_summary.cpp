@@ -0,0 +1,95 @@
+// ep_pe_summary: one row per (pe_id, ep_id) holding the totals of execution's
+// rows for it, in both output layouts.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "TOTAL_PAPI_EVENTS 1\n"
+                      "PAPI_EVENT 0 PAPI_TOT_INS\n"
+                      "END\n";
+
+// An execution of `ep` from `start` to `end`, received at `recv`, with
+// `cpu` microseconds of CPU time and one counter advancing by `counted`.
+auto execution(int ep, int event, int start, int end, int recv, int cpu,
+               int counted, int msglen = 64) -> std::string {
+  const auto e = std::to_string(event);
+  return "2 0 " + std::to_string(ep) + " " + std::to_string(start) + " " + e +
+         " 0 " + std::to_string(msglen) + " " + std::to_string(recv) +
+         " 7 0 1000\n" + "3 0 " + std::to_string(ep) + " " +
+         std::to_string(end) + " " + e + " 0 " + std::to_string(msglen) + " " +
+         std::to_string(cpu) + " " + std::to_string(1000 + counted) + "\n";
+}
+
+void run(const TempTrace &trace, const charmvz::OutputOptions &options = {}) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+}
+
+} // namespace
+
+TEST_CASE("ep_pe_summary totals each entry method on each PE",
+          "[ep_pe_summary]") {
+  TempTrace trace(kSts);
+  trace.add_log(0, execution(11, 1, 100, 300, 90, 150, 5) +
+                       execution(11, 2, 400, 450, 380, 40, 7, 32) +
+                       execution(12, 3, 500, 600, 500, 100, 1));
+  trace.add_log(1, execution(11, 1, 100, 200, 100, 50, 3));
+  run(trace);
+
+  ParquetTable summary(trace.out_dir() + "/ep_pe_summary.parquet");
+  REQUIRE(summary.rows() == 3);
+  CHECK(summary.ints("pe_id") == V{0, 0, 1});
+  CHECK(summary.ints("ep_id") == V{11, 12, 11});
+  CHECK(summary.ints("execution_count") == V{2, 1, 1});
+  CHECK(summary.ints("total_wall_us") == V{250, 100, 100});
+  CHECK(summary.ints("min_wall_us") == V{50, 100, 100});
+  CHECK(summary.ints("max_wall_us") == V{200, 100, 100});
+  CHECK(summary.ints("total_cpu_us") == V{190, 100, 50});
+  CHECK(summary.ints("max_cpu_us") == V{150, 100, 50});
+  CHECK(summary.ints("total_queue_wait_us") == V{30, 0, 0});
+  CHECK(summary.ints("queue_wait_count") == V{2, 1, 1});
+  CHECK(summary.ints("total_msg_bytes") == V{96, 64, 64});
+  CHECK(summary.ints("papi_delta_sum_0") == V{12, 1, 3});
+}
+
+TEST_CASE("ep_pe_summary is one file when execution is partitioned",
+          "[ep_pe_summary]") {
+  TempTrace trace(kSts);
+  trace.add_log(0, execution(11, 1, 100, 300, 90, 150, 5));
+  trace.add_log(1, execution(11, 1, 100, 200, 100, 50, 3));
+  charmvz::OutputOptions options;
+  options.partition_buckets = 2;
+  run(trace, options);
+
+  ParquetTable summary(trace.out_dir() + "/ep_pe_summary.parquet");
+  CHECK(summary.ints("pe_id") == V{0, 1});
+  CHECK(summary.ints("total_wall_us") == V{200, 100});
+}
@@ -0,0 +1,114 @@
+// The execution graph export: the parallel counting sort into CSR form, and
+// the .npy arrays and node table it writes.
+
+#include "execution_graph.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::GraphEdgeKind;
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+// Reads a one-dimensional .npy file the way a memory-mapping reader would:
+// the data starts right after the header, on a 64-byte boundary.
+template <class T>
+auto read_npy(const std::string &path, const std::string &descr)
+    -> std::vector<T> {
+  std::ifstream in(path, std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+  REQUIRE(bytes.substr(0, 8) == std::string("\x93NUMPY\x01\x00", 8));
+  const size_t header_len = static_cast<unsigned char>(bytes[8]) |
+                            static_cast<unsigned char>(bytes[9]) << 8;
+  const size_t offset = 10 + header_len;
+  CHECK(offset % 64 == 0);
+  CHECK(bytes.substr(10, header_len).find("'descr': '" + descr + "'") !=
+        std::string::npos);
+  std::vector<T> values((bytes.size() - offset) / sizeof(T));
+  std::memcpy(values.data(), bytes.data() + offset,
+              values.size() * sizeof(T));
+  return values;
+}
+
+} // namespace
+
+TEST_CASE("build_csr sorts every thread's edges into rows",
+          "[execution_graph]") {
+  const auto graph = charmvz::build_csr(
+      4, {{{2, 0, GraphEdgeKind::Message},
+           {0, 3, GraphEdgeKind::Succession},
+           {0, 1, GraphEdgeKind::Message}},
+          {{0, 1, GraphEdgeKind::Succession},
+           {2, 3, GraphEdgeKind::Succession}}});
+  CHECK(graph.indptr == std::vector<int64_t>{0, 3, 3, 5, 5});
+  CHECK(graph.indices == std::vector<int32_t>{1, 1, 3, 0, 3});
+  CHECK(graph.edge_kind == std::vector<uint8_t>{0, 1, 0, 1, 0});
+
+  const auto empty = charmvz::build_csr(2, {{}, {}});
+  CHECK(empty.indptr == std::vector<int64_t>{0, 0, 0});
+  CHECK(empty.indices.empty());
+}
+
+TEST_CASE("The execution graph is written as .npy arrays and a node table",
+          "[execution_graph]") {
+  TempTrace trace(kSts);
+  // A sends B's message while it runs, and C follows A on PE 0.
+  trace.add_log(0, "2 0 11 100 1 0 64 90 7 0\n"
+                   "1 0 12 150 5 1 64 0\n"
+                   "3 0 11 200 1 0 64 0\n"
+                   "2 0 11 300 2 0 64 290 7 0\n"
+                   "3 0 11 400 2 0 64 0\n");
+  trace.add_log(1, "2 0 12 250 5 0 64 230 7 0\n"
+                   "3 0 12 350 5 0 64 0\n");
+
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.execution_graph = true;
+  const auto result =
+      charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                            charmvz::NO_STEP_EVENT, options);
+  charmvz::write_execution_graph(result, rc, trace.out_dir(), options);
+
+  const auto dir = trace.out_dir() + "/execution_graph";
+  CHECK(read_npy<int64_t>(dir + "/indptr.npy", "<i8") ==
+        std::vector<int64_t>{0, 2, 2, 2});
+  CHECK(read_npy<int32_t>(dir + "/indices.npy", "<i4") ==
+        std::vector<int32_t>{1, 2});
+  CHECK(read_npy<uint8_t>(dir + "/edge_kind.npy", "<u1") ==
+        std::vector<uint8_t>{1, 0});
+
+  ParquetTable nodes(dir + "/nodes.parquet");
+  CHECK(nodes.ints("node_id") == V{0, 1, 2});
+  CHECK(nodes.ints("pe_id") == V{0, 1, 0});
+  CHECK(nodes.ints("event") == V{1, 5, 2});
+  CHECK(nodes.ints("start_time_us") == V{100, 250, 300});
+}
@@ -0,0 +1,122 @@
+// `charmvz serve` over loopback: a server on a free port of localhost and a
+// client in the same process, talking real gRPC.
+
+#include "flight_server.h"
+#include "parquet_writer.h"
+#include "schema.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/flight/api.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::TempTrace;
+
+// Two PEs' idle intervals, one row group each.
+void write_idle(const std::string &dir) {
+  const auto schema = charmvz::schema::idle_interval();
+  charmvz::ParquetWriter writer(schema, dir + "/idle_interval.parquet");
+  for (int32_t pe : {0, 1}) {
+    arrow::Int32Builder pe_builder;
+    arrow::Int64Builder start;
+    arrow::Int64Builder end;
+    arrow::Int64Builder duration;
+    arrow::Int32Builder step;
+    REQUIRE(pe_builder.Append(pe).ok());
+    REQUIRE(start.Append(100 * pe).ok());
+    REQUIRE(end.Append(100 * pe + 50).ok());
+    REQUIRE(duration.Append(50).ok());
+    REQUIRE(step.AppendNull().ok());
+    std::vector<std::shared_ptr<arrow::Array>> columns(5);
+    REQUIRE(pe_builder.Finish(&columns[0]).ok());
+    REQUIRE(start.Finish(&columns[1]).ok());
+    REQUIRE(end.Finish(&columns[2]).ok());
+    REQUIRE(duration.Finish(&columns[3]).ok());
+    REQUIRE(step.Finish(&columns[4]).ok());
+    writer.WriteBatch(arrow::RecordBatch::Make(schema, 1, columns));
+  }
+}
+
+// Starts the server on port 0 and connects a client to whichever port it
+// got. Init() already accepts calls; Serve() would only block.
+class Loopback {
+public:
+  explicit Loopback(const std::string &dir)
+      : server_(std::make_shared<const charmvz::TableCatalog>(dir)) {
+    auto location =
+        arrow::flight::Location::ForGrpcTcp("localhost", 0).ValueOrDie();
+    REQUIRE(server_.Init(arrow::flight::FlightServerOptions(location)).ok());
+    client_ = arrow::flight::FlightClient::Connect(
+                  arrow::flight::Location::ForGrpcTcp("localhost",
+                                                      server_.port())
+                      .ValueOrDie())
+                  .ValueOrDie();
+  }
+
+  ~Loopback() { (void)server_.Shutdown(); }
+
+  Loopback(const Loopback &) = delete;
+  auto operator=(const Loopback &) -> Loopback & = delete;
+
+  [[nodiscard]] auto client() -> arrow::flight::FlightClient & {
+    return *client_;
+  }
+
+private:
+  charmvz::TraceFlightServer server_;
+  std::unique_ptr<arrow::flight::FlightClient> client_;
+};
+
+} // namespace
+
+TEST_CASE("ListFlights names every table with its row count", "[flight]") {
+  TempTrace trace("");
+  write_idle(trace.out_dir());
+  Loopback loopback(trace.out_dir());
+
+  auto listing = loopback.client().ListFlights().ValueOrDie();
+  auto info = listing->Next().ValueOrDie();
+  REQUIRE(info != nullptr);
+  CHECK(info->descriptor().path == std::vector<std::string>{"idle_interval"});
+  CHECK(info->total_records() == 2);
+  CHECK(listing->Next().ValueOrDie() == nullptr);
+}
+
+TEST_CASE("DoGet streams only the filtered rows and columns", "[flight]") {
+  TempTrace trace("");
+  write_idle(trace.out_dir());
+  Loopback loopback(trace.out_dir());
+
+  // The ticket from GetFlightInfo is the one to redeem, as a client would.
+  auto info = loopback.client()
+                  .GetFlightInfo(arrow::flight::FlightDescriptor::Command(
+                      "table=idle_interval;columns=start_time_us;pe_id=1"))
+                  .ValueOrDie();
+  REQUIRE(info->endpoints().size() == 1);
+  auto stream =
+      loopback.client().DoGet(info->endpoints()[0].ticket).ValueOrDie();
+  const auto table = stream->ToTable().ValueOrDie();
+
+  REQUIRE(table->num_rows() == 1);
+  REQUIRE(table->num_columns() == 1);
+  CHECK(std::static_pointer_cast<arrow::Int64Array>(table->column(0)->chunk(0))
+            ->Value(0) == 100);
+}
+
+TEST_CASE("A bad ticket is an error, not an empty stream", "[flight]") {
+  TempTrace trace("");
+  write_idle(trace.out_dir());
+  Loopback loopback(trace.out_dir());
+
+  auto result = loopback.client().DoGet(
+      arrow::flight::Ticket{"table=idle_interval;ep_id=11"});
+  // gRPC may report the failure on the call or on the first read.
+  CHECK((!result.ok() || !(*result)->ToTable().ok()));
+}
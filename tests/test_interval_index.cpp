@@ -0,0 +1,194 @@
+// The interval index sidecars: each PE's spans sorted by start with a running
+// maximum end, and IntervalIndex finding and reading the rows of a window.
+
+#include "interval_index.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "table_scan.h"
+#include "table_writer.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::CapturingWriter;
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+// PE 0 runs a long execution with a short one nested in it, then a third,
+// and idles in between; PE 1 runs one execution.
+void add_logs(TempTrace &trace) {
+  trace.add_log(0, "2 0 11 100 1 0 64 90 7 0\n"
+                   "2 0 12 120 2 0 64 115 7 0\n"
+                   "3 0 12 130 2 0 64 0\n"
+                   "3 0 11 300 1 0 64 0\n"
+                   "14 300 0\n"
+                   "15 400 0\n"
+                   "2 0 11 400 3 0 64 390 7 0\n"
+                   "3 0 11 450 3 0 64 0\n");
+  trace.add_log(1, "2 0 12 150 4 1 64 140 7 0\n"
+                   "3 0 12 250 4 1 64 0\n");
+}
+
+void run(const TempTrace &trace, charmvz::OutputOptions options) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  options.interval_index = true;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+}
+
+auto rows(const std::vector<charmvz::IntervalHit> &hits) -> V {
+  V values;
+  for (const auto &hit : hits)
+    values.emplace_back(hit.row);
+  return values;
+}
+
+auto starts(const std::shared_ptr<arrow::Table> &table) -> V {
+  V values;
+  for (const auto &chunk : table->GetColumnByName("start_time_us")->chunks()) {
+    for (int64_t i = 0; i < chunk->length(); ++i) {
+      values.emplace_back(
+          std::static_pointer_cast<arrow::Int64Array>(chunk)->Value(i));
+    }
+  }
+  return values;
+}
+
+} // namespace
+
+TEST_CASE("The index carries the running maximum end in start order",
+          "[interval_index]") {
+  CapturingWriter writer;
+  const auto schema = charmvz::schema::interval_index("execution");
+  charmvz::IntervalIndexBuilder builder(writer, schema);
+  charmvz::IntervalIndexer indexer;
+  indexer.Add(50, 60, 1);
+  indexer.Add(0, 100, 0);
+  indexer.Add(70, 80, 2);
+  indexer.Drain(3, builder);
+  indexer.Add(5, 6, 3);
+  indexer.Drain(4, builder);
+  builder.Flush();
+  CHECK(builder.total_rows() == 4);
+
+  REQUIRE(writer.batches.size() == 1);
+  const auto &batch = *writer.batches.front();
+  auto column = [&](const std::string &name) {
+    const auto array = batch.GetColumnByName(name);
+    V values;
+    for (int64_t i = 0; i < array->length(); ++i) {
+      if (array->type_id() == arrow::Type::INT32) {
+        values.emplace_back(
+            std::static_pointer_cast<arrow::Int32Array>(array)->Value(i));
+      } else {
+        values.emplace_back(
+            std::static_pointer_cast<arrow::Int64Array>(array)->Value(i));
+      }
+    }
+    return values;
+  };
+  CHECK(column("pe_id") == V{3, 3, 3, 4});
+  CHECK(column("start_us") == V{0, 50, 70, 5});
+  CHECK(column("max_end_us") == V{100, 100, 100, 6});
+  CHECK(column("row_offset") == V{0, 1, 2, 3});
+}
+
+TEST_CASE("IntervalIndex finds the executions overlapping a window",
+          "[interval_index]") {
+  TempTrace trace(kSts);
+  add_logs(trace);
+  run(trace, {});
+
+  ParquetTable sidecar(trace.out_dir() + "/execution_index.parquet");
+  CHECK(sidecar.ints("pe_id") == V{0, 0, 0, 1});
+  CHECK(sidecar.ints("max_end_us") == V{300, 300, 450, 250});
+
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  const charmvz::IntervalIndex executions(catalog, "execution");
+  // The long execution still runs when the nested one is long over.
+  CHECK(rows(executions.Overlapping(0, 200, 410)) == V{0, 2});
+  CHECK(rows(executions.Overlapping(0, 125, 126)) == V{0, 1});
+  CHECK(rows(executions.Overlapping(0, 460, 500)).empty());
+  CHECK(rows(executions.Overlapping(1, 0, 1000)) == V{3});
+  CHECK(rows(executions.Overlapping(7, 0, 1000)).empty());
+
+  const auto running = executions.Read(0, 200, 410);
+  CHECK(starts(running) == V{100, 400});
+  CHECK(executions.Read(0, 460, 500)->num_rows() == 0);
+
+  const charmvz::IntervalIndex idle(catalog, "idle_interval");
+  CHECK(rows(idle.Overlapping(0, 350, 351)) == V{0});
+  CHECK(rows(idle.Overlapping(0, 100, 200)).empty());
+}
+
+TEST_CASE("The sidecar follows execution into pe_bucket parts",
+          "[interval_index]") {
+  TempTrace trace(kSts);
+  add_logs(trace);
+  charmvz::OutputOptions options;
+  options.partition_buckets = 2;
+  run(trace, options);
+
+  ParquetTable part(trace.out_dir() +
+                    "/execution_index/pe_bucket=1/part-0.parquet");
+  CHECK(part.ints("pe_id") == V{1});
+  CHECK(part.ints("row_offset") == V{0});
+
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  const charmvz::IntervalIndex executions(catalog, "execution");
+  CHECK(starts(executions.Read(1, 200, 210)) == V{150});
+  CHECK(starts(executions.Read(0, 200, 410)) == V{100, 400});
+}
+
+TEST_CASE("IntervalIndex reads Arrow IPC tables", "[interval_index]") {
+  TempTrace trace(kSts);
+  add_logs(trace);
+  charmvz::OutputOptions options;
+  options.format = charmvz::OutputFormat::ArrowIpc;
+  run(trace, options);
+
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  const charmvz::IntervalIndex executions(catalog, "execution");
+  CHECK(starts(executions.Read(0, 125, 126)) == V{100, 120});
+}
+
+TEST_CASE("IntervalIndex needs the sidecar", "[interval_index]") {
+  TempTrace trace(kSts);
+  add_logs(trace);
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, {});
+
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  CHECK_THROWS(charmvz::IntervalIndex(catalog, "execution"));
+}
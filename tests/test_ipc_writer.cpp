@@ -0,0 +1,182 @@
+#include "ipc_writer.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "output_writer.h"
+#include "rc_parser.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Removes the written IPC file on scope exit.
+class TempIpcPath {
+public:
+  TempIpcPath() {
+    path_ = std::filesystem::temp_directory_path() /
+            ("charmvz_ipc_test_" + std::to_string(counter_++) + ".arrow");
+  }
+
+  ~TempIpcPath() {
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+  }
+
+  TempIpcPath(const TempIpcPath &) = delete;
+  auto operator=(const TempIpcPath &) -> TempIpcPath & = delete;
+
+  [[nodiscard]] auto str() const -> std::string { return path_.string(); }
+
+private:
+  std::filesystem::path path_;
+  static inline int counter_ = 0;
+};
+
+// Memory-maps an IPC file and reads it whole, as a zero-copy consumer would.
+auto read_ipc(const std::string &path) -> std::shared_ptr<arrow::Table> {
+  auto file =
+      arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ)
+          .ValueOrDie();
+  auto reader = arrow::ipc::RecordBatchFileReader::Open(file).ValueOrDie();
+  return reader->ToTable().ValueOrDie();
+}
+
+void write_two_rows(charmvz::IpcWriter &writer,
+                    const std::shared_ptr<arrow::Schema> &schema) {
+  arrow::Int32Builder pe;
+  arrow::Int64Builder value;
+  REQUIRE(pe.Append(7).ok());
+  REQUIRE(value.AppendNull().ok());
+  REQUIRE(pe.Append(9).ok());
+  REQUIRE(value.Append(42).ok());
+  std::shared_ptr<arrow::Array> pe_array;
+  std::shared_ptr<arrow::Array> value_array;
+  REQUIRE(pe.Finish(&pe_array).ok());
+  REQUIRE(value.Finish(&value_array).ok());
+  writer.WriteBatch(arrow::RecordBatch::Make(schema, pe_array->length(),
+                                             {pe_array, value_array}));
+}
+
+} // namespace
+
+TEST_CASE("IpcWriter round-trips rows, types and schema metadata",
+          "[ipc_writer]") {
+  TempIpcPath out;
+
+  auto schema =
+      arrow::schema({arrow::field("pe_id", arrow::int32(), false),
+                     arrow::field("value", arrow::int64(), true)})
+          ->WithMetadata(std::make_shared<arrow::KeyValueMetadata>(
+              std::vector<std::string>{"papi_event_0"},
+              std::vector<std::string>{"PAPI_L2_TCM"}));
+  {
+    charmvz::IpcWriter writer(schema, out.str());
+    write_two_rows(writer, schema);
+  }
+
+  const auto table = read_ipc(out.str());
+  REQUIRE(table->num_rows() == 2);
+  CHECK(table->schema()->Equals(*schema, /*check_metadata=*/true));
+  const auto values =
+      std::static_pointer_cast<arrow::Int64Array>(table->column(1)->chunk(0));
+  CHECK(values->IsNull(0));
+  CHECK(values->Value(1) == 42);
+}
+
+TEST_CASE("IpcWriter with LZ4 reads back the same rows", "[ipc_writer]") {
+  TempIpcPath out;
+
+  auto schema = arrow::schema({arrow::field("pe_id", arrow::int32(), false),
+                               arrow::field("value", arrow::int64(), true)});
+  {
+    charmvz::IpcWriter writer(schema, out.str(), charmvz::IpcCompression::Lz4);
+    write_two_rows(writer, schema);
+  }
+
+  const auto table = read_ipc(out.str());
+  REQUIRE(table->num_rows() == 2);
+  const auto pes =
+      std::static_pointer_cast<arrow::Int32Array>(table->column(0)->chunk(0));
+  CHECK(pes->Value(0) == 7);
+  CHECK(pes->Value(1) == 9);
+}
+
+TEST_CASE("--format arrow writes every Stage 2 table as an IPC file",
+          "[ipc_writer][log_parser]") {
+  charmvz::test::TempTrace trace("PROJECTIONS_ID \n"
+                                 "VERSION 11.0\n"
+                                 "PROCESSORS 1\n"
+                                 "TOTAL_CHARES 1\n"
+                                 "CHARE 0 \"Array1D\" 1\n"
+                                 "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                                 "TOTAL_EVENTS 0\n"
+                                 "TOTAL_STATS 0\n"
+                                 "END\n");
+  trace.add_log(0, "2 0 11 100 1 0 64 900 7 0\n"
+                   "3 0 11 200 1 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.format = charmvz::OutputFormat::ArrowIpc;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(), -1,
+                        options);
+
+  const std::filesystem::path out = trace.out_dir();
+  for (const char *table : {"execution", "idle_interval", "chare_instance",
+                            "user_event", "user_stat", "memory_sample"}) {
+    CHECK(std::filesystem::exists(out / (std::string(table) + ".arrow")));
+    CHECK_FALSE(
+        std::filesystem::exists(out / (std::string(table) + ".parquet")));
+  }
+  const auto execution = read_ipc((out / "execution.arrow").string());
+  CHECK(execution->num_rows() == 1);
+  CHECK(execution->schema()->Equals(*charmvz::schema::execution()));
+}
+
+TEST_CASE("IpcWriter stream framing is readable batch by batch",
+          "[ipc_writer]") {
+  auto schema = arrow::schema({arrow::field("pe_id", arrow::int32(), false),
+                               arrow::field("value", arrow::int64(), true)});
+  auto sink = arrow::io::BufferOutputStream::Create().ValueOrDie();
+  charmvz::IpcWriter writer(schema, sink, charmvz::IpcFraming::Stream);
+  write_two_rows(writer, schema);
+
+  // Read before Close: a stream needs no footer, so the first batch is
+  // already complete for a consumer on the other end of a pipe.
+  auto reader = arrow::ipc::RecordBatchStreamReader::Open(
+                    std::make_shared<arrow::io::BufferReader>(
+                        sink->Finish().ValueOrDie()))
+                    .ValueOrDie();
+  CHECK(reader->schema()->Equals(*schema));
+  std::shared_ptr<arrow::RecordBatch> batch;
+  REQUIRE(reader->ReadNext(&batch).ok());
+  REQUIRE(batch != nullptr);
+  CHECK(batch->num_rows() == 2);
+}
+
+TEST_CASE("-o - writes no table but the streamed one", "[ipc_writer]") {
+  charmvz::OutputOptions options;
+  options.stream_table = "execution";
+  auto schema = arrow::schema({arrow::field("pe_id", arrow::int32(), false)});
+
+  auto other = charmvz::open_table_writer(charmvz::kStdoutPath, "message",
+                                          schema, options);
+  CHECK(dynamic_cast<charmvz::NullWriter *>(other.get()) != nullptr);
+  other->Close();
+  CHECK_FALSE(std::filesystem::exists(std::filesystem::path(
+      charmvz::kStdoutPath)));
+}
@@ -374,6 +374,45 @@ TEST_CASE("Repeated boundary brackets fold into one interval per step and PE",
   CHECK(steps.ints("end_time_us")[0] == 1800);
 }
 
+TEST_CASE("Rows carry the step their PE was in when they started",
+          "[log_parser][simulation_step]") {
+  // An execution and a send in step 0, an idle interval in step 1, and an
+  // execution, with a send inside it, after the last step.
+  TempTrace trace(kStsWithEvents);
+  trace.add_log(0, "98 4 1000 10 0 0\n"
+                   "2 0 11 1500 1 0 64 1490 0 0 0 0 0\n"
+                   "1 0 11 1600 2 0 64 0\n"
+                   "3 0 11 1700 1 0 64 0\n"
+                   "99 4 2000 11 0 0\n"
+                   "98 4 2000 12 0 1\n"
+                   "14 2500 0\n"
+                   "15 2600 0\n"
+                   "99 4 3000 13 0 1\n"
+                   "2 0 11 3500 3 0 64 3490 0 0 0 0 0\n"
+                   "1 0 11 3550 4 0 64 0\n"
+                   "3 0 11 3600 3 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.sorted = true;
+  const auto result = charmvz::process_logs(
+      trace.log_paths(), sts, rc, trace.out_dir(),
+      charmvz::find_user_event_id(sts, "SimulationStep"), options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+
+  using V = std::vector<std::optional<int64_t>>;
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  CHECK(exec.ints("step_id") == V{0, std::nullopt});
+  ParquetTable idle(trace.out_dir() + "/idle_interval.parquet");
+  CHECK(idle.ints("step_id") == V{1});
+  ParquetTable msg(trace.out_dir() + "/message.parquet");
+  CHECK(msg.ints("event") == V{2, 4});
+  CHECK(msg.ints("step_id") == V{0, std::nullopt});
+}
+
 TEST_CASE("Without a matching step event no timesteps are reconstructed",
           "[log_parser][simulation_step]") {
   // The user events are still materialized; only the step derivation is off.
@@ -424,3 +463,162 @@ TEST_CASE("User-event parsing leaves the execution stream intact",
   CHECK(idle.rows() == 2);
   CHECK(idle.ints("duration_us")[1] == 100);
 }
+
+TEST_CASE("Executions carry the message_id of the message they ran",
+          "[log_parser][message]") {
+  // PE 0 sends event 5, which PE 1 runs.
+  TempTrace trace(kStsWithEvents);
+  trace.add_log(0, "1 0 11 100 5 1 64 0\n");
+  trace.add_log(1, "2 0 11 200 5 0 64 150 0 0 0 0 0\n"
+                   "3 0 11 300 5 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  const auto result =
+      charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                            charmvz::NO_STEP_EVENT);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir());
+
+  using V = std::vector<std::optional<int64_t>>;
+  const int64_t id = charmvz::make_message_id(0, 5);
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  CHECK(exec.ints("message_id") == V{id});
+  ParquetTable msg(trace.out_dir() + "/message.parquet");
+  CHECK(msg.ints("message_id") == V{id});
+  CHECK(msg.ints("dst_pe") == V{1});
+
+  CHECK(charmvz::make_message_id(3, 7) == (int64_t{3} << 32 | 7));
+  CHECK(charmvz::make_message_id(1, 0) != charmvz::make_message_id(0, 1));
+}
+
+TEST_CASE("message_delivery has a row for every PE a message reached",
+          "[log_parser][message]") {
+  // PE 0 broadcasts event 5, which PEs 1 and 2 run, and multicasts event 6 to
+  // PEs 2 and 3. PE 2 runs 6 for two elements; PE 3 never runs it.
+  auto run = [](int32_t buckets) {
+    TempTrace trace(kStsWithEvents);
+    trace.add_log(0, "20 0 11 100 5 0 64 0 3\n"
+                     "21 0 11 150 6 0 64 0 2 2 3\n");
+    trace.add_log(1, "2 0 11 200 5 0 64 190 0 0 0 0 0\n"
+                     "3 0 11 210 5 0 64 0\n");
+    trace.add_log(2, "2 0 11 300 5 0 64 290 0 0 0 0 0\n"
+                     "3 0 11 310 5 0 64 0\n"
+                     "2 0 11 320 6 0 64 315 0 0 0 0 0\n"
+                     "3 0 11 330 6 0 64 0\n"
+                     "2 0 11 340 6 0 64 315 0 0 0 0 0\n"
+                     "3 0 11 350 6 0 64 0\n");
+    const auto sts = charmvz::parse_sts_file(trace.sts_path());
+    charmvz::RcData rc;
+    rc.global_start_time_us = 0;
+    rc.global_end_time_us = 0;
+    charmvz::OutputOptions options;
+    options.sorted = true;
+    options.partition_buckets = buckets;
+    const auto result =
+        charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                              charmvz::NO_STEP_EVENT, options);
+    charmvz::reconstruct_message_and_migration(result, sts, rc,
+                                               trace.out_dir(), options);
+
+    // PE 0's messages are all in bucket 0.
+    ParquetTable delivery(trace.out_dir() +
+                          (buckets > 0
+                               ? "/message_delivery/pe_bucket=0/part-0.parquet"
+                               : "/message_delivery.parquet"));
+    using V = std::vector<std::optional<int64_t>>;
+    const int64_t bcast = charmvz::make_message_id(0, 5);
+    const int64_t mcast = charmvz::make_message_id(0, 6);
+    CHECK(delivery.ints("message_id") == V{bcast, bcast, mcast, mcast});
+    CHECK(delivery.ints("dst_pe") == V{1, 2, 2, 3});
+    CHECK(delivery.ints("recv_time_us") == V{190, 290, 315, std::nullopt});
+    CHECK(delivery.ints("exec_start_time_us") ==
+          V{200, 300, 320, std::nullopt});
+    CHECK(delivery.ints("send_time_us") == V{100, 100, 150, 150});
+  };
+  SECTION("in one file") { run(0); }
+  // PEs 1 and 2 parse in different buckets, so the broadcast's receivers are
+  // merged from two shards.
+  SECTION("split in buckets") { run(2); }
+}
+
+TEST_CASE("A broadcast's message row names its first receiver",
+          "[log_parser][message]") {
+  // PE 0 broadcasts events 5 and 6. PE 2 runs 5 before PE 1 does, though PE
+  // 1's receipt is read first; PEs 1 and 2 start 6 at the same time.
+  auto run = [](int32_t buckets) {
+    TempTrace trace(kStsWithEvents);
+    trace.add_log(0, "20 0 11 100 5 0 64 0 3\n"
+                     "20 0 11 150 6 0 64 0 3\n");
+    trace.add_log(1, "2 0 11 300 5 0 64 290 0 0 0 0 0\n"
+                     "3 0 11 310 5 0 64 0\n"
+                     "2 0 11 400 6 0 64 390 0 0 0 0 0\n"
+                     "3 0 11 410 6 0 64 0\n");
+    trace.add_log(2, "2 0 11 200 5 0 64 190 0 0 0 0 0\n"
+                     "3 0 11 210 5 0 64 0\n"
+                     "2 0 11 400 6 0 64 395 0 0 0 0 0\n"
+                     "3 0 11 410 6 0 64 0\n");
+    const auto sts = charmvz::parse_sts_file(trace.sts_path());
+    charmvz::RcData rc;
+    rc.global_start_time_us = 0;
+    rc.global_end_time_us = 0;
+    charmvz::OutputOptions options;
+    options.sorted = true;
+    options.partition_buckets = buckets;
+    const auto result =
+        charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                              charmvz::NO_STEP_EVENT, options);
+    charmvz::reconstruct_message_and_migration(result, sts, rc,
+                                               trace.out_dir(), options);
+
+    ParquetTable msg(trace.out_dir() +
+                     (buckets > 0 ? "/message/pe_bucket=0/part-0.parquet"
+                                  : "/message.parquet"));
+    using V = std::vector<std::optional<int64_t>>;
+    CHECK(msg.ints("event") == V{5, 6});
+    CHECK(msg.ints("dst_pe") == V{2, 1});
+    CHECK(msg.ints("recv_time_us") == V{190, 390});
+    CHECK(msg.ints("exec_start_time_us") == V{200, 400});
+  };
+  SECTION("in one file") { run(0); }
+  // Each PE parses in a bucket of its own, so the receipts are merged from
+  // three shards.
+  SECTION("split in buckets") { run(3); }
+}
+
+TEST_CASE("Messages name the innermost execution that sent them",
+          "[log_parser][message]") {
+  // One send before any execution, then sends from an execution, from one
+  // nested in it, and from the outer one again once the inner has ended.
+  TempTrace trace(kStsWithEvents);
+  trace.add_log(0, "1 0 11 50 7 1 64 0\n"
+                   "2 0 11 100 1 0 64 90 0 0 0 0 0\n"
+                   "1 0 11 110 8 1 64 0\n"
+                   "2 0 12 120 2 0 64 115 0 0 0 0 0\n"
+                   "1 0 11 130 9 1 64 0\n"
+                   "3 0 12 140 2 0 64 0\n"
+                   "1 0 11 150 10 1 64 0\n"
+                   "3 0 11 160 1 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.sorted = true;
+  const auto result =
+      charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                            charmvz::NO_STEP_EVENT, options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+
+  using V = std::vector<std::optional<int64_t>>;
+  ParquetTable msg(trace.out_dir() + "/message.parquet");
+  CHECK(msg.ints("event") == V{7, 8, 9, 10});
+  CHECK(msg.ints("sender_event") == V{std::nullopt, 1, 2, 1});
+  CHECK(msg.ints("sender_ep_id") == V{std::nullopt, 11, 12, 11});
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  const auto instance = exec.ints("instance_id")[0];
+  REQUIRE(instance.has_value());
+  CHECK(msg.ints("sender_instance_id") ==
+        V{std::nullopt, instance, instance, instance});
+}
@@ -0,0 +1,154 @@
+// Memory accounting: what a table's pool counts, the run's and each stage's
+// peaks, builders flushing early once the run is over its threshold, and the
+// budget's thresholds over charged bytes.
+
+#include "memory_pool.h"
+#include "table_builder.h"
+#include "table_writer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Point {
+  int64_t time_us;
+};
+
+struct Note {
+  std::optional<std::string> text;
+};
+
+// Keeps every batch, and allocates from a pool of the test's choosing.
+class PooledWriter : public charmvz::TableWriter {
+public:
+  explicit PooledWriter(arrow::MemoryPool *pool) : pool_(pool) {}
+
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) override {
+    batches.push_back(std::move(batch));
+  }
+  void Close() override {}
+  [[nodiscard]] auto pool() const -> arrow::MemoryPool * override {
+    return pool_;
+  }
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+
+private:
+  arrow::MemoryPool *pool_;
+};
+
+} // namespace
+
+template <> struct charmvz::builders::RowDescriptor<Point> {
+  static constexpr auto columns = std::make_tuple(&Point::time_us);
+};
+
+template <> struct charmvz::builders::RowDescriptor<Note> {
+  static constexpr auto columns = std::make_tuple(&Note::text);
+};
+
+TEST_CASE("A table pool counts its bytes into the run and the stage",
+          "[memory_pool]") {
+  charmvz::MemoryAccounting accounting;
+  accounting.EnterStage("first");
+  auto *pool = accounting.pool("execution");
+  CHECK(accounting.pool("execution") == pool);
+
+  uint8_t *buffer = nullptr;
+  REQUIRE(pool->Allocate(4096, &buffer).ok());
+  REQUIRE(pool->Reallocate(4096, 8192, &buffer).ok());
+  CHECK(pool->bytes_allocated() == 8192);
+  CHECK(accounting.bytes_allocated() == 8192);
+  pool->Free(buffer, 8192);
+  CHECK(pool->bytes_allocated() == 0);
+  CHECK(pool->max_memory() == 8192);
+  CHECK(pool->num_allocations() == 1);
+
+  accounting.EnterStage("second");
+  REQUIRE(accounting.pool("message")->Allocate(100, &buffer).ok());
+  accounting.pool("message")->Free(buffer, 100);
+  const auto stages = accounting.stage_peaks();
+  REQUIRE(stages.size() == 2);
+  CHECK(stages[0].second == 8192);
+  CHECK(stages[1].second == 100);
+  CHECK(accounting.peak() == 8192);
+}
+
+TEST_CASE("Builders flush early while the run is over its threshold",
+          "[memory_pool]") {
+  auto &accounting = charmvz::memory_accounting();
+  auto *pool = accounting.pool("pressure_test");
+  PooledWriter writer(pool);
+  charmvz::builders::TableBuilder<Point> builder(
+      writer, arrow::schema({arrow::field("time_us", arrow::int64(), false)}));
+
+  accounting.set_flush_threshold(1);
+  for (int64_t i = 0; i < charmvz::builders::PRESSURE_CHECK_ROWS; ++i)
+    builder.Append({i});
+  accounting.set_flush_threshold(0);
+
+  REQUIRE(writer.batches.size() == 1);
+  CHECK(writer.batches[0]->num_rows() ==
+        charmvz::builders::PRESSURE_CHECK_ROWS);
+  CHECK(pool->early_flushes() == 1);
+  CHECK(builder.length() == 0);
+
+  // Without a threshold the builder waits for a full row group again.
+  for (int64_t i = 0; i < charmvz::builders::PRESSURE_CHECK_ROWS; ++i)
+    builder.Append({i});
+  CHECK(writer.batches.size() == 1);
+}
+
+TEST_CASE("A budget sets both thresholds and counts charged bytes",
+          "[memory_pool]") {
+  charmvz::MemoryAccounting accounting;
+  accounting.set_budget(1000);
+  CHECK(accounting.budget() == 1000);
+  CHECK(accounting.flush_threshold() == 750);
+
+  auto *map = accounting.pool("creation_map");
+  map->Charge(800);
+  CHECK(accounting.under_pressure());
+  CHECK_FALSE(accounting.over_spill_threshold());
+  map->Charge(100);
+  CHECK(accounting.over_spill_threshold());
+  map->Charge(-900);
+  CHECK(map->bytes_allocated() == 0);
+  CHECK(map->max_memory() == 900);
+  CHECK_FALSE(accounting.under_pressure());
+
+  accounting.set_budget(0);
+  map->Charge(1 << 20);
+  CHECK_FALSE(accounting.under_pressure());
+  CHECK_FALSE(accounting.over_spill_threshold());
+}
+
+TEST_CASE("A string column stages its characters in the table's pool",
+          "[memory_pool]") {
+  charmvz::MemoryAccounting accounting;
+  auto *pool = accounting.pool("user_event");
+  PooledWriter writer(pool);
+  charmvz::builders::TableBuilder<Note> builder(
+      writer, arrow::schema({arrow::field("text", arrow::utf8(), true)}));
+
+  const std::string text(1 << 16, 'x');
+  builder.Append({text});
+  builder.Append({std::nullopt});
+  builder.Append({"end"});
+  CHECK(pool->bytes_allocated() >= static_cast<int64_t>(text.size()));
+
+  builder.Flush();
+  REQUIRE(writer.batches.size() == 1);
+  const auto strings = std::static_pointer_cast<arrow::StringArray>(
+      writer.batches[0]->column(0));
+  CHECK(strings->GetString(0) == text);
+  CHECK(strings->IsNull(1));
+  CHECK(strings->GetString(2) == "end");
+}
@@ -0,0 +1,129 @@
+// PAPI counters: execution carries one papi_begin/end/delta column per counter
+// the trace declares -- none without PAPI, all of them past six -- and
+// papi_sample holds the same values one row per counter when asked for.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kStsHeader = "PROJECTIONS_ID \n"
+                            "VERSION 11.0\n"
+                            "PROCESSORS 1\n"
+                            "TOTAL_CHARES 1\n"
+                            "CHARE 0 \"Array1D\" 1\n"
+                            "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                            "TOTAL_EVENTS 0\n"
+                            "TOTAL_STATS 0\n";
+
+// Eight counters, the last left unnamed.
+auto sts_with_counters() -> std::string {
+  std::string sts = kStsHeader;
+  sts += "TOTAL_PAPI_EVENTS 8\n";
+  for (int i = 0; i < 7; ++i)
+    sts += "PAPI_EVENT " + std::to_string(i) + " PAPI_C" + std::to_string(i) +
+           "\n";
+  return sts + "END\n";
+}
+
+// One execution whose counter i reads 10 * i at the begin and 11 * i + 1 at
+// the end.
+auto execution_with_counters(int counters) -> std::string {
+  std::string begin = "2 0 11 100 1 0 64 900 7 0";
+  std::string end = "3 0 11 300 1 0 64 0";
+  for (int i = 0; i < counters; ++i) {
+    begin += " " + std::to_string(10 * i);
+    end += " " + std::to_string(11 * i + 1);
+  }
+  return begin + "\n" + end + "\n";
+}
+
+void run(const TempTrace &trace, const charmvz::OutputOptions &options = {}) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+}
+
+auto read_schema(const std::string &path) -> std::shared_ptr<arrow::Schema> {
+  auto infile = arrow::io::ReadableFile::Open(path).ValueOrDie();
+  auto reader = parquet::arrow::OpenFile(infile, arrow::default_memory_pool())
+                    .ValueOrDie();
+  std::shared_ptr<arrow::Schema> schema;
+  REQUIRE(reader->GetSchema(&schema).ok());
+  return schema;
+}
+
+} // namespace
+
+TEST_CASE("A trace without PAPI has no counter columns", "[papi]") {
+  TempTrace trace(std::string(kStsHeader) + "END\n");
+  trace.add_log(0, execution_with_counters(0));
+  run(trace);
+
+  const auto schema = read_schema(trace.out_dir() + "/execution.parquet");
+  for (const auto &name : schema->field_names())
+    CHECK(name.rfind("papi_", 0) == std::string::npos);
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  CHECK(exec.ints("wall_duration_us") == V{200});
+}
+
+TEST_CASE("Every declared counter gets its columns, past six", "[papi]") {
+  TempTrace trace(sts_with_counters());
+  trace.add_log(0, execution_with_counters(8));
+  run(trace);
+
+  const auto schema = read_schema(trace.out_dir() + "/execution.parquet");
+  CHECK(schema->GetFieldIndex("papi_delta_7") >= 0);
+  CHECK(schema->GetFieldIndex("papi_delta_8") == -1);
+  CHECK(schema->metadata()->Get("papi_event_6").ValueOr("") == "PAPI_C6");
+
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  CHECK(exec.ints("papi_begin_7") == V{70});
+  CHECK(exec.ints("papi_end_7") == V{78});
+  CHECK(exec.ints("papi_delta_7") == V{8});
+  CHECK(exec.ints("papi_delta_0") == V{1});
+}
+
+TEST_CASE("papi_sample holds one row per counter when asked for", "[papi]") {
+  TempTrace trace(sts_with_counters());
+  trace.add_log(0, execution_with_counters(8));
+
+  run(trace);
+  CHECK_FALSE(std::filesystem::exists(trace.out_dir() +
+                                      "/papi_sample.parquet"));
+
+  charmvz::OutputOptions options;
+  options.papi_samples = true;
+  run(trace, options);
+  ParquetTable samples(trace.out_dir() + "/papi_sample.parquet");
+  REQUIRE(samples.rows() == 8);
+  CHECK(samples.ints("counter_id") == V{0, 1, 2, 3, 4, 5, 6, 7});
+  CHECK(samples.ints("event") == V(8, 1));
+  const auto counters = samples.strings("counter");
+  CHECK(*counters[2] == "PAPI_C2");
+  CHECK_FALSE(counters[7].has_value());
+  CHECK(samples.ints("begin_value")[3] == 30);
+  CHECK(samples.ints("delta")[3] == 4);
+}
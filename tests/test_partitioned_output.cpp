@@ -0,0 +1,209 @@
+// --partition-buckets: execution, idle_interval and user_event written as
+// `<table>/pe_bucket=K/part-0.parquet` datasets, one writer per bucket, with a
+// `_metadata` summary beside the parts, and message split the same way by
+// sender in Stage 3.
+//
+// The buckets are parsed on separate threads, so besides the layout these pin
+// what the threads share: a chare instance seen in two buckets still gets one
+// id, the same one an unpartitioned run gives it, and Stage 3 still sees every
+// bucket's executions.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "reconstruction.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+
+#include <filesystem>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 3\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+auto execution(int event, const std::string &index, int start, int end)
+    -> std::string {
+  return "2 0 11 " + std::to_string(start) + " " + std::to_string(event) +
+         " 0 64 900 " + index + " 0\n" + "3 0 11 " + std::to_string(end) +
+         " " + std::to_string(event) + " 0 64 0\n";
+}
+
+auto idle(int start, int end) -> std::string {
+  return "14 " + std::to_string(start) + " 0\n15 " + std::to_string(end) +
+         " 0\n";
+}
+
+// Three PEs over two buckets: PEs 0 and 2 share bucket 0. Instance 7 runs on
+// PE 0 and then PE 1, so it is seen from both buckets.
+void build_trace(TempTrace &trace) {
+  trace.add_log(0, execution(1, "7", 100, 200) + idle(200, 250));
+  trace.add_log(1, execution(1, "7", 300, 400));
+  trace.add_log(2, execution(1, "8", 500, 600) + idle(600, 700));
+}
+
+auto creation(int event, int send) -> std::string {
+  return "1 0 11 " + std::to_string(send) + " " + std::to_string(event) +
+         " 0 64 0\n";
+}
+
+void run(const TempTrace &trace, int32_t buckets, bool sorted = false) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.partition_buckets = buckets;
+  options.sorted = sorted;
+  const auto result = charmvz::process_logs(trace.log_paths(), sts, rc,
+                                            trace.out_dir(), -1, options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+}
+
+auto pe_ids(const std::string &path) -> std::set<int64_t> {
+  ParquetTable table(path);
+  std::set<int64_t> pes;
+  for (const auto &pe : table.ints("pe_id"))
+    pes.insert(*pe);
+  return pes;
+}
+
+} // namespace
+
+TEST_CASE("Partitioned tables are split into one part per pe_bucket",
+          "[partitioned]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, 2);
+
+  const std::filesystem::path out = trace.out_dir();
+  CHECK_FALSE(std::filesystem::exists(out / "execution.parquet"));
+  CHECK(pe_ids((out / "execution/pe_bucket=0/part-0.parquet").string()) ==
+        std::set<int64_t>{0, 2});
+  CHECK(pe_ids((out / "execution/pe_bucket=1/part-0.parquet").string()) ==
+        std::set<int64_t>{1});
+  CHECK(pe_ids((out / "idle_interval/pe_bucket=0/part-0.parquet").string()) ==
+        std::set<int64_t>{0, 2});
+  CHECK(ParquetTable((out / "idle_interval/pe_bucket=1/part-0.parquet")
+                         .string())
+            .rows() == 0);
+  CHECK(std::filesystem::exists(out / "user_event/pe_bucket=1/part-0.parquet"));
+
+  // The tables that are not keyed by PE stay single files.
+  CHECK(std::filesystem::exists(out / "chare_instance.parquet"));
+  CHECK_FALSE(std::filesystem::exists(out / "message.parquet"));
+  CHECK(std::filesystem::exists(out / "message/pe_bucket=1/part-0.parquet"));
+}
+
+TEST_CASE("_metadata summarises every part's row groups", "[partitioned]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, 2);
+
+  auto infile = arrow::io::ReadableFile::Open(trace.out_dir() +
+                                              "/execution/_metadata")
+                    .ValueOrDie();
+  const auto summary = parquet::ReadMetaData(infile);
+  CHECK(summary->num_rows() == 3);
+  REQUIRE(summary->num_row_groups() == 2);
+  CHECK(summary->RowGroup(0)->ColumnChunk(0)->file_path() ==
+        "pe_bucket=0/part-0.parquet");
+  CHECK(summary->RowGroup(1)->ColumnChunk(0)->file_path() ==
+        "pe_bucket=1/part-0.parquet");
+}
+
+TEST_CASE("An instance seen in two buckets keeps one id", "[partitioned]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, 2);
+
+  ParquetTable instances(trace.out_dir() + "/chare_instance.parquet");
+  CHECK(instances.rows() == 2);
+
+  // The move from PE 0 to PE 1 crosses buckets, so it is only found if Stage 3
+  // receives both buckets' executions under the same instance id.
+  ParquetTable mig(trace.out_dir() + "/migration_episode.parquet");
+  REQUIRE(mig.rows() == 1);
+  CHECK(mig.ints("src_pe")[0] == 0);
+  CHECK(mig.ints("dst_pe")[0] == 1);
+}
+
+TEST_CASE("Instance ids do not depend on the buckets", "[partitioned]") {
+  TempTrace serial(kSts);
+  build_trace(serial);
+  run(serial, 0);
+  TempTrace partitioned(kSts);
+  build_trace(partitioned);
+  run(partitioned, 2);
+
+  ParquetTable expected(serial.out_dir() + "/chare_instance.parquet");
+  ParquetTable instances(partitioned.out_dir() + "/chare_instance.parquet");
+  CHECK(instances.ints("instance_id") == expected.ints("instance_id"));
+  CHECK(instances.ints("index_0") == expected.ints("index_0"));
+  const auto ids = instances.ints("instance_id");
+  const auto indices = instances.ints("index_0");
+  for (size_t i = 0; i < ids.size(); ++i) {
+    CHECK(*ids[i] == charmvz::make_instance_id(std::make_tuple(
+                         0, static_cast<int32_t>(*indices[i]), 0, 0, 0, 0,
+                         0)));
+  }
+}
+
+TEST_CASE("Stage 3 links each sender's messages in its own bucket",
+          "[partitioned]") {
+  // PE 2 sends out of time order; PE 0 receives event 5 from PE 2.
+  auto build = [](TempTrace &trace) {
+    trace.add_log(0, creation(1, 10) + creation(2, 20) +
+                         "2 0 11 500 5 2 64 450 7 0\n"
+                         "3 0 11 600 5 2 64 0\n");
+    trace.add_log(1, creation(3, 30));
+    trace.add_log(2, creation(5, 40) + creation(4, 5));
+  };
+  TempTrace single(kSts);
+  build(single);
+  run(single, 0, true);
+  TempTrace split(kSts);
+  build(split);
+  run(split, 2, true);
+
+  using V = std::vector<std::optional<int64_t>>;
+  ParquetTable bucket0(split.out_dir() + "/message/pe_bucket=0/part-0.parquet");
+  ParquetTable bucket1(split.out_dir() + "/message/pe_bucket=1/part-0.parquet");
+  CHECK(bucket0.ints("src_pe") == V{0, 0, 2, 2});
+  CHECK(bucket1.ints("src_pe") == V{1});
+  CHECK(bucket0.ints("send_time_us") == V{10, 20, 5, 40});
+  CHECK(bucket0.ints("dst_pe") ==
+        V{std::nullopt, std::nullopt, std::nullopt, 0});
+
+  // Ids come from the (src_pe, event) key, so the split has the same ones.
+  const auto id = charmvz::make_message_id;
+  ParquetTable whole(single.out_dir() + "/message.parquet");
+  CHECK(whole.ints("message_id") ==
+        V{id(0, 1), id(0, 2), id(1, 3), id(2, 4), id(2, 5)});
+  CHECK(bucket0.ints("message_id") ==
+        V{id(0, 1), id(0, 2), id(2, 4), id(2, 5)});
+  CHECK(bucket1.ints("message_id") == V{id(1, 3)});
+  CHECK(std::filesystem::exists(split.out_dir() + "/message/_metadata"));
+}
@@ -0,0 +1,169 @@
+// --sorted: execution ordered by (pe_id, start_time_us), message by
+// (src_pe, send_time_us), each declared in the file's sorting_columns.
+//
+// Neither order falls out of the parser for free. A log writes an execution
+// when it ends, so a nested execution lands ahead of the one around it; the
+// logs arrive in directory order, not PE order; and messages come out of a
+// hash map. These cases build a trace where each of the three would show.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "reconstruction.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+auto begin_processing(int event, int start) -> std::string {
+  return "2 0 11 " + std::to_string(start) + " " + std::to_string(event) +
+         " 0 64 900 7 0\n";
+}
+
+auto end_processing(int event, int end) -> std::string {
+  return "3 0 11 " + std::to_string(end) + " " + std::to_string(event) +
+         " 0 64 0\n";
+}
+
+auto creation(int event, int send) -> std::string {
+  return "1 0 11 " + std::to_string(send) + " " + std::to_string(event) +
+         " 1 64 0\n";
+}
+
+// PE 1's log is listed first. PE 0 runs one execution nested inside another,
+// then a third after both; PE 1 sends two messages out of time order.
+void build_trace(TempTrace &trace) {
+  trace.add_log(1, begin_processing(9, 50) + end_processing(9, 60) +
+                       creation(5, 30) + creation(6, 10));
+  trace.add_log(0, begin_processing(1, 100) + begin_processing(2, 150) +
+                       end_processing(2, 200) + end_processing(1, 300) +
+                       creation(7, 20) + begin_processing(3, 400) +
+                       end_processing(3, 500));
+}
+
+void run(const TempTrace &trace, const charmvz::OutputOptions &options) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  const auto result = charmvz::process_logs(trace.log_paths(), sts, rc,
+                                            trace.out_dir(), -1, options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+}
+
+auto sorting_columns(const std::string &path)
+    -> std::vector<parquet::SortingColumn> {
+  auto infile = arrow::io::ReadableFile::Open(path).ValueOrDie();
+  auto reader = parquet::arrow::OpenFile(infile, arrow::default_memory_pool())
+                    .ValueOrDie();
+  return reader->parquet_reader()->metadata()->RowGroup(0)->sorting_columns();
+}
+
+} // namespace
+
+TEST_CASE("Sorted execution is ordered by PE, then start time",
+          "[sorted]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, charmvz::OutputOptions{.sorted = true});
+
+  ParquetTable exec(trace.out_dir() + "/execution.parquet");
+  using V = std::vector<std::optional<int64_t>>;
+  CHECK(exec.ints("pe_id") == V{0, 0, 0, 1});
+  CHECK(exec.ints("start_time_us") == V{100, 150, 400, 50});
+  CHECK(exec.ints("end_time_us") == V{300, 200, 500, 60});
+}
+
+TEST_CASE("Sorted message is ordered by sender, then send time", "[sorted]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, charmvz::OutputOptions{.sorted = true});
+
+  ParquetTable msg(trace.out_dir() + "/message.parquet");
+  using V = std::vector<std::optional<int64_t>>;
+  CHECK(msg.ints("src_pe") == V{0, 1, 1});
+  CHECK(msg.ints("send_time_us") == V{20, 10, 30});
+  CHECK(msg.ints("message_id") ==
+        V{charmvz::make_message_id(0, 7), charmvz::make_message_id(1, 6),
+          charmvz::make_message_id(1, 5)});
+}
+
+TEST_CASE("Sorted message keeps sender order across linking threads",
+          "[sorted]") {
+  // A single file is linked on one thread per core, each over a range of
+  // senders; with sixteen senders the ranges meet several times.
+  constexpr int kPes = 16;
+  std::string sts = kSts;
+  sts.replace(sts.find("PROCESSORS 2"), 12,
+              "PROCESSORS " + std::to_string(kPes));
+  TempTrace trace(sts);
+  for (int pe = kPes - 1; pe >= 0; --pe)
+    trace.add_log(pe, creation(2, 40 + pe) + creation(1, 80 - pe));
+  run(trace, charmvz::OutputOptions{.sorted = true});
+
+  ParquetTable msg(trace.out_dir() + "/message.parquet");
+  using V = std::vector<std::optional<int64_t>>;
+  V src_pes;
+  V send_times;
+  for (int pe = 0; pe < kPes; ++pe) {
+    src_pes.insert(src_pes.end(), {pe, pe});
+    send_times.insert(send_times.end(), {40 + pe, 80 - pe});
+  }
+  CHECK(msg.ints("src_pe") == src_pes);
+  CHECK(msg.ints("send_time_us") == send_times);
+}
+
+TEST_CASE("Sorted files declare their order in sorting_columns", "[sorted]") {
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, charmvz::OutputOptions{.sorted = true});
+
+  const auto exec_schema = charmvz::schema::execution();
+  const auto exec_sort = sorting_columns(trace.out_dir() + "/execution.parquet");
+  REQUIRE(exec_sort.size() == 2);
+  CHECK(exec_sort[0].column_idx == exec_schema->GetFieldIndex("pe_id"));
+  CHECK(exec_sort[1].column_idx == exec_schema->GetFieldIndex("start_time_us"));
+  CHECK_FALSE(exec_sort[0].descending);
+
+  const auto msg_schema = charmvz::schema::message();
+  const auto msg_sort = sorting_columns(trace.out_dir() + "/message.parquet");
+  REQUIRE(msg_sort.size() == 2);
+  CHECK(msg_sort[0].column_idx == msg_schema->GetFieldIndex("src_pe"));
+  CHECK(msg_sort[1].column_idx == msg_schema->GetFieldIndex("send_time_us"));
+}
+
+TEST_CASE("Unsorted output declares no order", "[sorted]") {
+  // The default must not claim an order it does not keep: a reader that trusts
+  // sorting_columns would return wrong answers on merge or range queries.
+  TempTrace trace(kSts);
+  build_trace(trace);
+  run(trace, charmvz::OutputOptions{});
+
+  CHECK(sorting_columns(trace.out_dir() + "/execution.parquet").empty());
+  CHECK(sorting_columns(trace.out_dir() + "/message.parquet").empty());
+}
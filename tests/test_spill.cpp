@@ -0,0 +1,266 @@
+// The spill store: Stage 3's inputs survive the round trip to disk, each in
+// the partition Stage 3 expects, and the directory, the store's own, goes with
+// the store. And end to end: a parse that spills mid-way under --max-memory
+// links the same messages and finds the same migrations as one that does not.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "reconstruction.h"
+#include "spill.h"
+#include "sts_parser.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+auto spill_dir(const std::string &name) -> std::filesystem::path {
+  return std::filesystem::temp_directory_path() / ("charmvz_spill_" + name);
+}
+
+auto creation(int32_t src_pe, int64_t send_time_us) -> charmvz::CreationRecord {
+  charmvz::CreationRecord cr{};
+  cr.ep_id = 7;
+  cr.msg_idx = 2;
+  cr.msg_len = 128;
+  cr.send_time_us = send_time_us;
+  cr.enqueue_time_us = send_time_us + 1;
+  cr.broadcast_fanout = 1;
+  cr.src_pe = src_pe;
+  return cr;
+}
+
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using Rows = std::vector<std::vector<std::optional<int64_t>>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 2\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+// Two PEs taking turns: PE 0's execution i sends message i to PE 1, which
+// runs it and sends message i back for PE 0's next execution. The elements
+// of a 40-element array run on both PEs alternately, so each of their
+// executions is a migration. Far more map entries than the parser reads
+// between two budget checks.
+constexpr int kRounds = 3000;
+constexpr int kElements = 40;
+
+auto execution(int time, int event, int src_pe, int element, int sends)
+    -> std::string {
+  const auto t = [&](int offset) { return std::to_string(time + offset); };
+  return "2 0 11 " + t(0) + " " + std::to_string(event) + " " +
+         std::to_string(src_pe) + " 64 " + t(-1) + " " +
+         std::to_string(element) + " 0\n" + "1 0 11 " + t(1) + " " +
+         std::to_string(sends) + " 0 64 0\n" + "3 0 11 " + t(3) + " " +
+         std::to_string(event) + " 0 64 0\n";
+}
+
+void build_trace(TempTrace &trace) {
+  std::string pe0;
+  std::string pe1;
+  for (int i = 0; i < kRounds; ++i) {
+    // PE 0's first execution runs a message nothing sent.
+    const int received = i == 0 ? kRounds : i - 1;
+    pe0 += execution(20 * i + 10, received, 1, i % kElements, i);
+    pe1 += execution(20 * i + 15, i, 0, i % kElements, i);
+  }
+  trace.add_log(0, pe0);
+  trace.add_log(1, pe1);
+}
+
+// Converts the trace under a budget of `max_memory_bytes`, 0 for none, and
+// returns whether the parse spilled.
+auto convert(const TempTrace &trace, int64_t max_memory_bytes) -> bool {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.sorted = true;
+  options.max_memory_bytes = max_memory_bytes;
+  const auto result =
+      charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                            charmvz::NO_STEP_EVENT, options);
+  charmvz::reconstruct_message_and_migration(result, sts, rc, trace.out_dir(),
+                                             options);
+  return result.spill != nullptr;
+}
+
+// The rows of `table` over `columns`, in file order.
+auto rows(const TempTrace &trace, const std::string &table,
+          const std::vector<std::string> &columns) -> Rows {
+  ParquetTable file(trace.out_dir() + "/" + table + ".parquet");
+  Rows out(static_cast<size_t>(file.rows()));
+  for (const auto &column : columns) {
+    const auto values = file.ints(column);
+    for (size_t i = 0; i < values.size(); ++i)
+      out[i].push_back(values[i]);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("Spilled messages come back in their sender's partition",
+          "[spill]") {
+  std::filesystem::path dir;
+  {
+    charmvz::SpillStore store(spill_dir("messages"), 64);
+    dir = store.dir();
+    CHECK_FALSE(store.used());
+
+    charmvz::CreationMap creations;
+    creations[std::make_tuple(0, 1)] = creation(0, 10);
+    auto multicast = creation(63, 20);
+    multicast.dst_pes = {4, 5, 6};
+    creations[std::make_tuple(63, 2)] = multicast;
+    charmvz::BeginProcessingMap begins;
+    begins.Add(std::make_tuple(63, 2), {9, 25, 30});
+    begins.Add(std::make_tuple(63, 2), {10, 26, 31});
+
+    CHECK(store.Spill(creations) > 0);
+    CHECK(store.Spill(begins) > 0);
+    CHECK(store.used());
+    CHECK(dir.parent_path() == spill_dir("messages"));
+
+    // 64 PEs over 32 partitions: PE 0 is in the first, PE 63 the last.
+    charmvz::CreationMap first;
+    store.Load(0, first);
+    REQUIRE(first.size() == 1);
+    CHECK(first.at(std::make_tuple(0, 1)).send_time_us == 10);
+
+    charmvz::CreationMap last;
+    charmvz::BeginProcessingMap last_begins;
+    store.Load(charmvz::SpillStore::kPartitions - 1, last);
+    store.Load(charmvz::SpillStore::kPartitions - 1, last_begins);
+    REQUIRE(last.size() == 1);
+    const auto &loaded = last.at(std::make_tuple(63, 2));
+    CHECK(loaded.enqueue_time_us == 21);
+    CHECK(loaded.msg_len == 128);
+    CHECK(loaded.dst_pes == std::vector<int32_t>{4, 5, 6});
+    REQUIRE(last_begins.size() == 1);
+    CHECK(last_begins.receipts() == 2);
+    const auto *first_receipt = last_begins.Find(std::make_tuple(63, 2));
+    REQUIRE(first_receipt != nullptr);
+    CHECK(first_receipt->dst_pe == 9);
+    CHECK(first_receipt->exec_start_time_us == 30);
+
+    charmvz::CreationMap empty;
+    store.Load(1, empty);
+    CHECK(empty.empty());
+  }
+  CHECK_FALSE(std::filesystem::exists(dir));
+}
+
+TEST_CASE("A later spill replaces an earlier entry under the same key",
+          "[spill]") {
+  charmvz::SpillStore store(spill_dir("replace"), 1);
+  charmvz::CreationMap creations;
+  creations[std::make_tuple(0, 1)] = creation(0, 10);
+  store.Spill(creations);
+  creations[std::make_tuple(0, 1)] = creation(0, 99);
+  store.Spill(creations);
+
+  charmvz::CreationMap loaded;
+  store.Load(0, loaded);
+  REQUIRE(loaded.size() == 1);
+  CHECK(loaded.at(std::make_tuple(0, 1)).send_time_us == 99);
+}
+
+TEST_CASE("An instance's spilled locations stay in one partition",
+          "[spill]") {
+  charmvz::SpillStore store(spill_dir("locations"), 4);
+  const std::vector<charmvz::InstanceLocationRecord> first = {
+      {5, 1, 0, 0, 10}, {6, 1, 1, 0, 10}};
+  const std::vector<charmvz::InstanceLocationRecord> second = {
+      {5, 1, 2, 20, 30}};
+  store.Spill(first);
+  store.Spill(second);
+
+  std::vector<charmvz::InstanceLocationRecord> loaded;
+  store.Load(5 % charmvz::SpillStore::kPartitions, loaded);
+  REQUIRE(loaded.size() == 2);
+  CHECK(loaded[0].pe_id == 0);
+  CHECK(loaded[1].pe_id == 2);
+  CHECK(loaded[1].start_time_us == 20);
+}
+
+TEST_CASE("Stores sharing a parent never see each other's files", "[spill]") {
+  // As two runs streaming to stdout share the temporary directory, or a run
+  // finds the leftovers of one that was killed before cleaning up.
+  const auto parent = spill_dir("shared");
+  {
+    // Kept past its store, as a killed run leaves its files.
+    charmvz::SpillStore killed(parent, 1);
+    charmvz::CreationMap creations;
+    creations[std::make_tuple(0, 1)] = creation(0, 10);
+    killed.Spill(creations);
+    std::filesystem::copy(killed.dir(), parent / ".charmvz-spill");
+  }
+
+  charmvz::SpillStore first(parent, 1);
+  {
+    charmvz::SpillStore second(parent, 1);
+    CHECK(first.dir() != second.dir());
+    charmvz::CreationMap creations;
+    creations[std::make_tuple(0, 2)] = creation(0, 20);
+    second.Spill(creations);
+  }
+  CHECK(std::filesystem::exists(first.dir()));
+
+  charmvz::CreationMap loaded;
+  first.Load(0, loaded);
+  CHECK(loaded.empty());
+  std::filesystem::remove_all(parent);
+}
+
+TEST_CASE("A parse that spills writes what one in memory does", "[spill]") {
+  TempTrace in_memory(kSts);
+  build_trace(in_memory);
+  TempTrace spilled(kSts);
+  build_trace(spilled);
+  // A budget the maps outgrow within the parser's first check of it.
+  REQUIRE(convert(spilled, int64_t{64} << 10));
+  REQUIRE_FALSE(convert(in_memory, 0));
+
+  const std::vector<std::string> message = {
+      "message_id", "src_pe", "event", "send_time_us", "dst_pe",
+      "recv_time_us", "exec_start_time_us", "sender_event",
+      "sender_instance_id"};
+  const auto expected_messages = rows(in_memory, "message", message);
+  CHECK(expected_messages.size() == 2 * kRounds);
+  CHECK(rows(spilled, "message", message) == expected_messages);
+
+  const std::vector<std::string> delivery = {
+      "message_id", "dst_pe", "recv_time_us", "exec_start_time_us"};
+  CHECK(rows(spilled, "message_delivery", delivery) ==
+        rows(in_memory, "message_delivery", delivery));
+
+  // migration_id numbers migrations as Stage 3 meets them, which a spill
+  // changes; everything else about them must not.
+  const std::vector<std::string> migration = {
+      "instance_id", "src_pe", "dst_pe", "last_exec_end_src_us",
+      "first_exec_start_dst_us", "migration_seq"};
+  auto expected_migrations = rows(in_memory, "migration_episode", migration);
+  auto migrations = rows(spilled, "migration_episode", migration);
+  std::sort(expected_migrations.begin(), expected_migrations.end());
+  std::sort(migrations.begin(), migrations.end());
+  // Each element hops at each of its executions but its first.
+  CHECK(expected_migrations.size() == 2 * kRounds - kElements);
+  CHECK(migrations == expected_migrations);
+}
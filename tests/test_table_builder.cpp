@@ -0,0 +1,170 @@
+// TableBuilder: the columns a RowDescriptor yields, their nulls, where row
+// groups are cut, and the dictionary columns NameDictionary codes.
+
+#include "builders.h"
+#include "table_builder.h"
+#include "table_writer.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using charmvz::test::CapturingWriter;
+
+struct Sample {
+  int32_t id;
+  std::optional<int64_t> time_us;
+  std::string name;
+  bool flag;
+  int64_t base;
+};
+
+auto sample_schema(int group_width) -> std::shared_ptr<arrow::Schema> {
+  arrow::FieldVector fields = {arrow::field("id", arrow::int32(), false),
+                               arrow::field("time_us", arrow::int64(), true),
+                               arrow::field("name", arrow::utf8(), false),
+                               arrow::field("flag", arrow::boolean(), false)};
+  for (int i = 0; i < group_width; ++i)
+    fields.push_back(
+        arrow::field("plus_" + std::to_string(i), arrow::int64(), true));
+  return arrow::schema(fields);
+}
+
+} // namespace
+
+template <> struct charmvz::builders::RowDescriptor<Sample> {
+  static constexpr auto columns = std::make_tuple(
+      &Sample::id, &Sample::time_us, &Sample::name, &Sample::flag,
+      column_group([](const Sample &s, size_t i) -> std::optional<int64_t> {
+        if (i == 1)
+          return std::nullopt;
+        return s.base + static_cast<int64_t>(i);
+      }));
+};
+
+TEST_CASE("Staged rows reach Arrow with their values and nulls",
+          "[table_builder]") {
+  CapturingWriter writer;
+  charmvz::builders::TableBuilder<Sample> builder(writer, sample_schema(2), 2);
+  builder.Append({7, 100, "alpha", true, 10});
+  builder.Append({8, std::nullopt, "", false, 20});
+  CHECK(builder.length() == 2);
+  CHECK(writer.batches.empty());
+
+  builder.Flush();
+  CHECK(builder.length() == 0);
+  REQUIRE(writer.batches.size() == 1);
+  const auto &batch = *writer.batches[0];
+  REQUIRE(batch.num_rows() == 2);
+  REQUIRE(batch.num_columns() == 6);
+
+  const auto ids = std::static_pointer_cast<arrow::Int32Array>(batch.column(0));
+  CHECK(ids->Value(1) == 8);
+  const auto times =
+      std::static_pointer_cast<arrow::Int64Array>(batch.column(1));
+  CHECK(times->Value(0) == 100);
+  CHECK(times->IsNull(1));
+  const auto names =
+      std::static_pointer_cast<arrow::StringArray>(batch.column(2));
+  CHECK(names->GetString(0) == "alpha");
+  CHECK(names->GetString(1).empty());
+  const auto flags =
+      std::static_pointer_cast<arrow::BooleanArray>(batch.column(3));
+  CHECK(flags->Value(0));
+  CHECK_FALSE(flags->Value(1));
+
+  // The group's columns follow in order, each with its own validity.
+  const auto plus_0 =
+      std::static_pointer_cast<arrow::Int64Array>(batch.column(4));
+  CHECK(plus_0->Value(1) == 20);
+  CHECK(batch.column(5)->null_count() == 2);
+  CHECK(batch.column(0)->null_count() == 0);
+}
+
+TEST_CASE("A row group is cut every ROW_GROUP_SIZE rows", "[table_builder]") {
+  CapturingWriter writer;
+  charmvz::builders::TableBuilder<Sample> builder(writer, sample_schema(0));
+  for (int32_t i = 0; i < charmvz::builders::ROW_GROUP_SIZE + 3; ++i)
+    builder.Append({i, i, "x", false, 0});
+  REQUIRE(writer.batches.size() == 1);
+  CHECK(writer.batches[0]->num_rows() == charmvz::builders::ROW_GROUP_SIZE);
+
+  builder.Flush();
+  builder.Flush();
+  REQUIRE(writer.batches.size() == 2);
+  CHECK(writer.batches[1]->num_rows() == 3);
+  CHECK(std::static_pointer_cast<arrow::Int32Array>(
+            writer.batches[1]->column(0))
+            ->Value(0) == charmvz::builders::ROW_GROUP_SIZE);
+}
+
+TEST_CASE("A descriptor that does not fit the schema is rejected",
+          "[table_builder]") {
+  CapturingWriter writer;
+  using Builder = charmvz::builders::TableBuilder<Sample>;
+  CHECK_THROWS_AS(Builder(writer, sample_schema(2), 3), std::runtime_error);
+  CHECK_THROWS_AS(Builder(writer, sample_schema(0), 1), std::runtime_error);
+}
+
+namespace {
+
+struct Named {
+  int32_t id;
+  std::optional<charmvz::builders::DictionaryCode> name;
+};
+
+} // namespace
+
+template <> struct charmvz::builders::RowDescriptor<Named> {
+  static constexpr auto columns = std::make_tuple(&Named::id, &Named::name);
+};
+
+TEST_CASE("A dictionary column carries codes into one shared dictionary",
+          "[table_builder]") {
+  CapturingWriter writer;
+  const auto schema = arrow::schema(
+      {arrow::field("id", arrow::int32(), false),
+       arrow::field("name", arrow::dictionary(arrow::int32(), arrow::utf8()),
+                    true)});
+  std::unordered_map<int32_t, Sample> registered;
+  registered.emplace(9, Sample{9, std::nullopt, "late", false, 0});
+  registered.emplace(2, Sample{2, std::nullopt, "early", false, 0});
+  const charmvz::builders::NameDictionary names(registered);
+  REQUIRE(names.code(2)->code == 0);
+  REQUIRE(names.code(9)->code == 1);
+  CHECK_FALSE(names.code(5).has_value());
+
+  using Builder = charmvz::builders::TableBuilder<Named>;
+  CHECK_THROWS_AS(Builder(writer, schema), std::runtime_error);
+  CHECK_THROWS_AS(Builder(writer, schema, 0, {names.values(), names.values()}),
+                  std::runtime_error);
+
+  Builder builder(writer, schema, 0, {names.values()});
+  builder.Append({0, names.code(9)});
+  builder.Append({1, names.code(5)});
+  builder.Flush();
+  builder.Append({2, names.code(2)});
+  builder.Flush();
+  REQUIRE(writer.batches.size() == 2);
+
+  const auto first = std::static_pointer_cast<arrow::DictionaryArray>(
+      writer.batches[0]->column(1));
+  CHECK(first->GetValueIndex(0) == 1);
+  CHECK(first->IsNull(1));
+  const auto second = std::static_pointer_cast<arrow::DictionaryArray>(
+      writer.batches[1]->column(1));
+  CHECK(second->GetValueIndex(0) == 0);
+  CHECK(second->dictionary() == first->dictionary());
+  CHECK(std::static_pointer_cast<arrow::StringArray>(second->dictionary())
+            ->GetString(0) == "early");
+}
@@ -0,0 +1,218 @@
+// The reads behind `charmvz serve`: which files of an output directory become
+// tables, which Parquet row groups the statistics rule out, and which rows
+// and columns survive a ScanRequest's filters.
+
+#include "ipc_writer.h"
+#include "parquet_writer.h"
+#include "schema.h"
+#include "table_scan.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+auto interval_schema() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema({arrow::field("pe_id", arrow::int32(), false),
+                        arrow::field("ep_id", arrow::int32(), false),
+                        arrow::field("start_time_us", arrow::int64(), false),
+                        arrow::field("end_time_us", arrow::int64(), true)});
+}
+
+// Writes one batch, which ParquetWriter turns into one row group.
+void write_rows(charmvz::TableWriter &writer, int32_t pe,
+                const std::vector<int32_t> &eps,
+                const std::vector<int64_t> &starts, const V &ends) {
+  arrow::Int32Builder pe_builder;
+  arrow::Int32Builder ep_builder;
+  arrow::Int64Builder start_builder;
+  arrow::Int64Builder end_builder;
+  for (size_t i = 0; i < eps.size(); ++i) {
+    REQUIRE(pe_builder.Append(pe).ok());
+    REQUIRE(ep_builder.Append(eps[i]).ok());
+    REQUIRE(start_builder.Append(starts[i]).ok());
+    REQUIRE((ends[i] ? end_builder.Append(*ends[i]) : end_builder.AppendNull())
+                .ok());
+  }
+  std::vector<std::shared_ptr<arrow::Array>> columns(4);
+  REQUIRE(pe_builder.Finish(&columns[0]).ok());
+  REQUIRE(ep_builder.Finish(&columns[1]).ok());
+  REQUIRE(start_builder.Finish(&columns[2]).ok());
+  REQUIRE(end_builder.Finish(&columns[3]).ok());
+  writer.WriteBatch(arrow::RecordBatch::Make(
+      interval_schema(), static_cast<int64_t>(eps.size()), columns));
+}
+
+// PE 0's rows in one row group and PE 1's in the next. PE 1's last interval
+// is still open.
+void write_execution(const std::string &dir) {
+  charmvz::ParquetWriter writer(interval_schema(), dir + "/execution.parquet");
+  write_rows(writer, 0, {11, 12}, {100, 200}, {150, 250});
+  write_rows(writer, 1, {11, 12, 11}, {300, 400, 500},
+             {350, 450, std::nullopt});
+}
+
+auto ints(const std::shared_ptr<arrow::Table> &table, const std::string &name)
+    -> V {
+  auto chunked = table->GetColumnByName(name);
+  REQUIRE(chunked != nullptr);
+  V values;
+  for (const auto &chunk : chunked->chunks()) {
+    for (int64_t i = 0; i < chunk->length(); ++i) {
+      if (chunk->IsNull(i)) {
+        values.emplace_back(std::nullopt);
+      } else if (chunk->type_id() == arrow::Type::INT32) {
+        values.emplace_back(
+            std::static_pointer_cast<arrow::Int32Array>(chunk)->Value(i));
+      } else {
+        values.emplace_back(
+            std::static_pointer_cast<arrow::Int64Array>(chunk)->Value(i));
+      }
+    }
+  }
+  return values;
+}
+
+auto scan(const charmvz::TableCatalog &catalog,
+          const charmvz::ScanRequest &request)
+    -> std::shared_ptr<arrow::Table> {
+  return catalog.Scan(request)->ToTable().ValueOrDie();
+}
+
+} // namespace
+
+TEST_CASE("Scan requests round-trip through their ticket text", "[scan]") {
+  charmvz::ScanRequest request;
+  request.table = "execution";
+  request.columns = {"pe_id", "ep_id"};
+  request.pe_ids = {0, 3};
+  request.ep_ids = {11};
+  request.end_us = 500;
+
+  const auto text = charmvz::encode_scan_request(request);
+  CHECK(text == "table=execution;columns=pe_id,ep_id;pe_id=0,3;ep_id=11;"
+                "time_us=,500");
+  const auto decoded = charmvz::decode_scan_request(text);
+  CHECK(decoded.table == request.table);
+  CHECK(decoded.columns == request.columns);
+  CHECK(decoded.pe_ids == request.pe_ids);
+  CHECK(decoded.ep_ids == request.ep_ids);
+  CHECK_FALSE(decoded.begin_us.has_value());
+  CHECK(decoded.end_us == 500);
+
+  CHECK_THROWS_AS(charmvz::decode_scan_request("table=execution;pe_id=x"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(charmvz::decode_scan_request("pe_id=1"), std::runtime_error);
+}
+
+TEST_CASE("A PE filter skips row groups by their statistics", "[scan]") {
+  TempTrace trace("");
+  write_execution(trace.out_dir());
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  REQUIRE(catalog.table("execution").num_rows == 5);
+
+  charmvz::ScanRequest request;
+  request.table = "execution";
+  request.columns = {"ep_id", "start_time_us"};
+  request.pe_ids = {1};
+  request.ep_ids = {11};
+  auto scanner = catalog.Scan(request);
+  const auto table = scanner->ToTable().ValueOrDie();
+
+  CHECK(scanner->row_groups_skipped() == 1);
+  CHECK(scanner->row_groups_read() == 1);
+  // Only the requested columns come back, though pe_id was read to filter.
+  CHECK(table->schema()->field_names() ==
+        std::vector<std::string>{"ep_id", "start_time_us"});
+  CHECK(ints(table, "start_time_us") == V{300, 500});
+}
+
+TEST_CASE("A time range keeps overlapping and still-open intervals",
+          "[scan]") {
+  TempTrace trace("");
+  write_execution(trace.out_dir());
+  const charmvz::TableCatalog catalog(trace.out_dir());
+
+  charmvz::ScanRequest request;
+  request.table = "execution";
+  request.begin_us = 420;
+  request.end_us = 10000;
+  auto scanner = catalog.Scan(request);
+  const auto table = scanner->ToTable().ValueOrDie();
+
+  // PE 0's row group ends at 250, so its max end rules it out. The row ending
+  // at 450 overlaps; the open one reaches the range regardless of its end.
+  CHECK(scanner->row_groups_skipped() == 1);
+  CHECK(ints(table, "start_time_us") == V{400, 500});
+  CHECK(ints(table, "end_time_us") == V{450, std::nullopt});
+}
+
+TEST_CASE("A scan rejects columns and filters the table does not have",
+          "[scan]") {
+  TempTrace trace("");
+  write_execution(trace.out_dir());
+  {
+    charmvz::ParquetWriter writer(charmvz::schema::memory_sample(),
+                                  trace.out_dir() + "/memory_sample.parquet");
+  }
+  const charmvz::TableCatalog catalog(trace.out_dir());
+
+  charmvz::ScanRequest request;
+  request.table = "execution";
+  request.columns = {"no_such_column"};
+  CHECK_THROWS_AS(catalog.Scan(request), std::runtime_error);
+
+  request.columns.clear();
+  request.table = "no_such_table";
+  CHECK_THROWS_AS(catalog.Scan(request), std::runtime_error);
+
+  // memory_sample has no entry method, so an ep_id filter cannot apply.
+  request.table = "memory_sample";
+  request.ep_ids = {11};
+  CHECK_THROWS_AS(catalog.Scan(request), std::runtime_error);
+}
+
+TEST_CASE("The catalog serves Arrow IPC files and partitioned datasets",
+          "[scan]") {
+  TempTrace trace("");
+  const std::filesystem::path out = trace.out_dir();
+  {
+    charmvz::IpcWriter writer(interval_schema(),
+                              (out / "idle_interval.arrow").string());
+    write_rows(writer, 2, {0, 0}, {10, 20}, {15, 25});
+  }
+  for (int bucket : {0, 1}) {
+    const auto dir =
+        out / "user_event" / ("pe_bucket=" + std::to_string(bucket));
+    std::filesystem::create_directories(dir);
+    charmvz::ParquetWriter writer(interval_schema(),
+                                  (dir / "part-0.parquet").string());
+    write_rows(writer, bucket, {0}, {bucket * 100}, {std::nullopt});
+  }
+
+  const charmvz::TableCatalog catalog(trace.out_dir());
+  CHECK(catalog.tables().size() == 2);
+  CHECK(catalog.table("user_event").files.size() == 2);
+  CHECK(catalog.table("user_event").num_rows == 2);
+
+  charmvz::ScanRequest request;
+  request.table = "idle_interval";
+  request.begin_us = 18;
+  CHECK(ints(scan(catalog, request), "start_time_us") == V{20});
+
+  request.table = "user_event";
+  request.begin_us.reset();
+  request.pe_ids = {1};
+  CHECK(ints(scan(catalog, request), "pe_id") == V{1});
+}
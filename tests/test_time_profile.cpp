@@ -0,0 +1,108 @@
+// time_profile: each PE's busy time per entry method and its idle time per
+// bin, with spans split exactly at the bin edges they cross.
+
+#include "builders.h"
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "table_writer.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::CapturingWriter;
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 1\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+void run(const TempTrace &trace, const charmvz::OutputOptions &options) {
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+}
+
+} // namespace
+
+TEST_CASE("A span is split exactly at every bin edge it crosses",
+          "[time_profile]") {
+  CapturingWriter writer;
+  const auto schema = charmvz::schema::time_profile(100);
+  charmvz::builders::TimeProfileBuilder builder(writer, schema);
+  charmvz::builders::TimeBinner bins(100);
+  bins.AddBusy(11, 50, 320);
+  bins.AddIdle(320, 400);
+  bins.AddBusy(12, -30, 10);
+  bins.Drain(3, builder);
+  builder.Flush();
+
+  REQUIRE(writer.batches.size() == 1);
+  const auto &batch = *writer.batches[0];
+  const auto column = [&](const std::string &name) {
+    const auto array = std::static_pointer_cast<arrow::Int64Array>(
+        batch.GetColumnByName(name));
+    V values;
+    for (int64_t i = 0; i < array->length(); ++i) {
+      values.push_back(array->IsNull(i) ? std::nullopt
+                                        : std::optional(array->Value(i)));
+    }
+    return values;
+  };
+  CHECK(column("bin_start_us") == V{-100, 0, 0, 100, 200, 300, 300});
+  CHECK(column("busy_us") ==
+        V{30, 50, 10, 100, 100, std::nullopt, 20});
+  CHECK(column("idle_us") == V{std::nullopt, std::nullopt, std::nullopt,
+                               std::nullopt, std::nullopt, 80,
+                               std::nullopt});
+}
+
+TEST_CASE("time_profile is written only with a bin width", "[time_profile]") {
+  TempTrace trace(kSts);
+  trace.add_log(0, "2 0 11 100 1 0 64 90 7 0\n"
+                   "3 0 11 250 1 0 64 0\n"
+                   "14 250 0\n"
+                   "15 420 0\n"
+                   "2 0 12 420 2 0 64 400 7 0\n"
+                   "3 0 12 450 2 0 64 0\n");
+
+  run(trace, {});
+  CHECK_FALSE(std::filesystem::exists(trace.out_dir() +
+                                      "/time_profile.parquet"));
+
+  charmvz::OutputOptions options;
+  options.time_bin_us = 200;
+  run(trace, options);
+  ParquetTable profile(trace.out_dir() + "/time_profile.parquet");
+  CHECK(profile.ints("bin_start_us") == V{0, 200, 200, 400, 400});
+  CHECK(profile.ints("pe_id") == V{0, 0, 0, 0, 0});
+  CHECK(profile.ints("ep_id") == V{11, std::nullopt, 11, std::nullopt, 12});
+  CHECK(profile.ints("busy_us") ==
+        V{100, std::nullopt, 50, std::nullopt, 30});
+  CHECK(profile.ints("idle_us") ==
+        V{std::nullopt, 150, std::nullopt, 20, std::nullopt});
+}
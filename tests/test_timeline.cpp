@@ -0,0 +1,166 @@
+// The timeline pyramid: executions at least a pixel long are kept and cut at
+// tile edges, shorter ones merge per pixel under their dominant entry method,
+// and each level is written under timeline/level=K/.
+
+#include "log_parser.h"
+#include "output_options.h"
+#include "rc_parser.h"
+#include "schema.h"
+#include "sts_parser.h"
+#include "table_writer.h"
+#include "timeline.h"
+#include "trace_fixture.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arrow/api.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using charmvz::test::CapturingWriter;
+using charmvz::test::ParquetTable;
+using charmvz::test::TempTrace;
+using V = std::vector<std::optional<int64_t>>;
+
+// One level's segments, as the pyramid appends them.
+class Level {
+public:
+  Level(const charmvz::TimelinePyramid &pyramid, int32_t level)
+      : schema_(charmvz::schema::timeline_level(level, pyramid.pixel_us(level),
+                                                pyramid.tile_us(level))),
+        builder_(writer_, schema_) {}
+
+  auto builder() -> charmvz::TimelineBuilder * { return &builder_; }
+
+  auto ints(const std::string &name) -> V {
+    builder_.Flush();
+    V values;
+    for (const auto &batch : writer_.batches) {
+      const auto column = batch->GetColumnByName(name);
+      for (int64_t i = 0; i < column->length(); ++i) {
+        if (column->type()->id() == arrow::Type::INT32) {
+          values.emplace_back(
+              std::static_pointer_cast<arrow::Int32Array>(column)->Value(i));
+        } else {
+          values.emplace_back(
+              std::static_pointer_cast<arrow::Int64Array>(column)->Value(i));
+        }
+      }
+    }
+    return values;
+  }
+
+private:
+  CapturingWriter writer_;
+  std::shared_ptr<arrow::Schema> schema_;
+  charmvz::TimelineBuilder builder_;
+};
+
+constexpr auto kSts = "PROJECTIONS_ID \n"
+                      "VERSION 11.0\n"
+                      "PROCESSORS 1\n"
+                      "TOTAL_CHARES 1\n"
+                      "CHARE 0 \"Array1D\" 1\n"
+                      "ENTRY CHARE 11 \"one(dummyMsg*)\" 0 0\n"
+                      "ENTRY CHARE 12 \"two(dummyMsg*)\" 0 0\n"
+                      "TOTAL_EVENTS 0\n"
+                      "TOTAL_STATS 0\n"
+                      "END\n";
+
+} // namespace
+
+TEST_CASE("Short executions merge per pixel under the busiest entry method",
+          "[timeline]") {
+  // Level 0 has 10 us pixels and 10240 us tiles; level 1, 40 us and 40960.
+  charmvz::TimelinePyramid pyramid(2, 10);
+  CHECK(pyramid.pixel_us(1) == 40);
+  CHECK(pyramid.tile_us(0) == 10 * charmvz::TimelinePyramid::kTilePixels);
+
+  pyramid.Add(11, 0, 3);
+  pyramid.Add(12, 3, 9);
+  pyramid.Add(11, 18, 22);
+  pyramid.Add(12, 10230, 10260);
+
+  Level fine(pyramid, 0);
+  Level coarse(pyramid, 1);
+  pyramid.Drain(4, {fine.builder(), coarse.builder()});
+
+  // Level 0: three merged pixels, the third holding only the tail of an
+  // execution begun in the second, then the long execution cut at the edge
+  // between tiles 0 and 1.
+  CHECK(fine.ints("tile") == V{0, 0, 0, 0, 1});
+  CHECK(fine.ints("start_us") == V{0, 10, 20, 10230, 10240});
+  CHECK(fine.ints("end_us") == V{10, 20, 30, 10240, 10260});
+  CHECK(fine.ints("ep_id") == V{12, 11, 11, 12, 12});
+  CHECK(fine.ints("busy_us") == V{9, 2, 2, 10, 20});
+  CHECK(fine.ints("execution_count") == V{2, 1, 0, 1, 1});
+
+  // Level 1: everything is shorter than a 40 us pixel.
+  CHECK(coarse.ints("start_us") == V{0, 10200, 10240});
+  CHECK(coarse.ints("busy_us") == V{13, 10, 20});
+  CHECK(coarse.ints("ep_id") == V{11, 12, 12});
+  CHECK(coarse.ints("pe_id") == V{4, 4, 4});
+}
+
+TEST_CASE("An execution nested in another is drawn as the outer one only",
+          "[timeline]") {
+  charmvz::TimelinePyramid pyramid(2, 10);
+  // Added as the parser finds them, inner first since it ends first: a
+  // sub-pixel call and a long one inside long executions, and a sub-pixel
+  // call inside an execution shorter than a level 1 pixel.
+  pyramid.Add(12, 10, 12);
+  pyramid.Add(11, 0, 50);
+  pyramid.Add(12, 120, 150);
+  pyramid.Add(11, 100, 200);
+  pyramid.Add(12, 305, 325);
+  pyramid.Add(11, 300, 330);
+
+  Level fine(pyramid, 0);
+  Level coarse(pyramid, 1);
+  pyramid.Drain(0, {fine.builder(), coarse.builder()});
+
+  CHECK(fine.ints("start_us") == V{0, 100, 300});
+  CHECK(fine.ints("end_us") == V{50, 200, 330});
+  CHECK(fine.ints("ep_id") == V{11, 11, 11});
+  CHECK(fine.ints("busy_us") == V{50, 100, 30});
+
+  // The last outer execution merges into two 40 us pixels, busy only for
+  // its own 30 us.
+  CHECK(coarse.ints("start_us") == V{0, 100, 280, 320});
+  CHECK(coarse.ints("ep_id") == V{11, 11, 11, 11});
+  CHECK(coarse.ints("busy_us") == V{50, 100, 20, 10});
+  CHECK(coarse.ints("execution_count") == V{1, 1, 1, 0});
+}
+
+TEST_CASE("Each timeline level is written to its own directory",
+          "[timeline]") {
+  TempTrace trace(kSts);
+  trace.add_log(0, "2 0 11 100 1 0 64 90 7 0\n"
+                   "3 0 11 250 1 0 64 0\n"
+                   "2 0 12 260 2 0 64 255 7 0\n"
+                   "3 0 12 262 2 0 64 0\n");
+  const auto sts = charmvz::parse_sts_file(trace.sts_path());
+  charmvz::RcData rc;
+  rc.global_start_time_us = 0;
+  rc.global_end_time_us = 0;
+  charmvz::OutputOptions options;
+  options.timeline_levels = 3;
+  options.timeline_pixel_us = 100;
+  charmvz::process_logs(trace.log_paths(), sts, rc, trace.out_dir(),
+                        charmvz::NO_STEP_EVENT, options);
+
+  ParquetTable level0(trace.out_dir() + "/timeline/level=0/part-0.parquet");
+  CHECK(level0.ints("start_us") == V{100, 200});
+  CHECK(level0.ints("busy_us") == V{150, 2});
+  ParquetTable level2(trace.out_dir() + "/timeline/level=2/part-0.parquet");
+  CHECK(level2.ints("start_us") == V{0});
+  CHECK(level2.ints("busy_us") == V{152});
+  CHECK(level2.ints("execution_count") == V{2});
+  CHECK_FALSE(std::filesystem::exists(trace.out_dir() + "/timeline/level=3"));
+}
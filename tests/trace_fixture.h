@@ -1,9 +1,12 @@
 #pragma once
 
 // Shared fixtures for the tests that drive the pipeline end to end: a
-// throwaway trace directory to write records into, and a reader that asserts
+// throwaway trace directory to write records into, a reader that asserts
 // against the Parquet file that was actually produced rather than an in-memory
-// intermediate.
+// intermediate, and a writer that keeps a builder's batches for tests that
+// drive one directly.
+
+#include "table_writer.h"
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -108,6 +111,9 @@ public:
         if (chunk->type_id() == arrow::Type::INT32) {
           values.emplace_back(
               std::static_pointer_cast<arrow::Int32Array>(chunk)->Value(i));
+        } else if (chunk->type_id() == arrow::Type::UINT16) {
+          values.emplace_back(
+              std::static_pointer_cast<arrow::UInt16Array>(chunk)->Value(i));
         } else {
           values.emplace_back(
               std::static_pointer_cast<arrow::Int64Array>(chunk)->Value(i));
@@ -141,12 +147,22 @@ public:
     REQUIRE(chunked != nullptr);
     std::vector<std::optional<std::string>> values;
     for (const auto &chunk : chunked->chunks()) {
-      auto array = std::static_pointer_cast<arrow::StringArray>(chunk);
-      for (int64_t i = 0; i < array->length(); ++i) {
-        if (array->IsNull(i)) {
+      // A dictionary column is read through its codes.
+      std::shared_ptr<arrow::DictionaryArray> codes;
+      std::shared_ptr<arrow::StringArray> array;
+      if (chunk->type_id() == arrow::Type::DICTIONARY) {
+        codes = std::static_pointer_cast<arrow::DictionaryArray>(chunk);
+        array =
+            std::static_pointer_cast<arrow::StringArray>(codes->dictionary());
+      } else {
+        array = std::static_pointer_cast<arrow::StringArray>(chunk);
+      }
+      for (int64_t i = 0; i < chunk->length(); ++i) {
+        if (chunk->IsNull(i)) {
           values.emplace_back(std::nullopt);
         } else {
-          values.emplace_back(array->GetString(i));
+          values.emplace_back(
+              array->GetString(codes ? codes->GetValueIndex(i) : i));
         }
       }
     }
@@ -157,4 +173,15 @@ private:
   std::shared_ptr<arrow::Table> table_;
 };
 
+// Keeps every batch it is handed.
+class CapturingWriter : public charmvz::TableWriter {
+public:
+  void WriteBatch(std::shared_ptr<arrow::RecordBatch> batch) override {
+    batches.push_back(std::move(batch));
+  }
+  void Close() override {}
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+};
+
 } // namespace charmvz::test